@@ -4,29 +4,44 @@
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
-#include <wiringPi.h>
-#include <arpa/inet.h>
-#include <sys/socket.h>
+#include <time.h>
 #include <math.h>
+#include "protocol.h"
+#include "dht_sensor.h"
+#include "dht_aggregate.h"
+#include "transport.h"
 
-#define MAX_TIME 85 // 안정적으로 데이터를 읽기 위해 타이밍 85로 정의
 #define PIN 2          // PIN number for DHT11
 
+// 측정 설정
+#define DHT_SAMPLE_MS 2000 // 기본 측정 간격 (DHT11_SAMPLE_MS로 변경, 최소 1초)
+#define DHT_REPORT_MS 20000 // 기본 주기 전송 간격 (DHT11_REPORT_MS로 변경)
+#define DHT_EWMA_ALPHA 0.2f // 변화 감지 기준선 EWMA 가중치
+#define DHT_CHANGE_TEMP 1.5f // 바로 보낼 온도 변화 기준 (DHT11_CHANGE_C로 변경, 0이면 끔)
+#define DHT_CHANGE_HUMIDITY 8.0f // 바로 보낼 습도 변화 기준 (DHT11_CHANGE_RH로 변경, 0이면 끔)
+
 // 서버 정보 정의
 #define SERVER_ADDRESS "192.168.45.8"
 #define SERVER_PORT 8080
+#define NODE_ID 1 // 서버에 보고할 노드 ID
+#define SITE_ID 1 // 노드가 설치된 현장 ID
+#define ZONE_ID 1 // 현장 내 구역 ID
+#define SPOOL_PATH "dht11.spool" // 연결이 끊긴 동안의 측정을 보관할 파일
+#define SPOOL_BYTES (1 << 20) // spool 크기 (약 4만 개 프레임)
 
 // 변수 정의
-int data[5] = {0, 0, 0, 0, 0};
-float sum_temp = 0.0;
-float sum_humidity = 0.0;
-int read_times = 0;
-int sample_count = 0;
+static struct dht_sensor sensor; // DHT11 센서 (DHT11_TRACE 지정 시 에지도 기록)
+static struct dht_aggregate aggregate; // 최근 측정 창과 전송 시점 판단
+static int sample_ms = DHT_SAMPLE_MS; // 측정 간격 (서버가 측정 속도를 지시하면 바뀜)
+static int default_sample_ms = DHT_SAMPLE_MS; // 설정된 측정 간격
+static uint32_t default_report_ms = DHT_REPORT_MS; // 설정된 주기 전송 간격
+uint32_t send_seq = 0; // 전송 프레임 시퀀스 번호
 
 // 함수 선언
-void read_data();
-void send_average(int sock);
+int read_data(struct dht_reading *reading);
+void send_summary(struct transport *link, const struct dht_summary *summary, int emit, uint64_t timestamp_ms);
 void *server_thread(void *arg);
+static void apply_control(const struct proto_control *control);
 
 int main(void)
 {
@@ -34,13 +49,30 @@ int main(void)
 
     printf("Temperature and Humidity Check through DHT11 Sensor\n");
 
-    // wiringpu initialize & 실패 시 에러 메시지 출력
-    if (wiringPiSetupGpio() == -1)
+    // DHT11 데이터 라인 요청 & 실패 시 에러 메시지 출력
+    if (dht_sensor_open(&sensor, PIN, getenv("DHT11_TRACE")) == -1)
     {
-        perror("WiringPi initialization failed\n");
+        perror("GPIO initialization failed\n");
         return -1;
     }
 
+    // 측정 간격과 전송 기준 설정
+    const char* env = getenv("DHT11_SAMPLE_MS");
+    if (env != NULL && atoi(env) >= 1000)
+    {
+        sample_ms = atoi(env);
+    }
+    env = getenv("DHT11_REPORT_MS");
+    uint32_t report_ms = (env != NULL && atoi(env) > 0) ? (uint32_t)atoi(env) : DHT_REPORT_MS;
+    default_sample_ms = sample_ms;
+    default_report_ms = report_ms;
+    env = getenv("DHT11_CHANGE_C");
+    float change_temp = env != NULL ? (float)atof(env) : DHT_CHANGE_TEMP;
+    env = getenv("DHT11_CHANGE_RH");
+    float change_humidity = env != NULL ? (float)atof(env) : DHT_CHANGE_HUMIDITY;
+    dht_aggregate_init(&aggregate, report_ms, DHT_EWMA_ALPHA, change_temp, change_humidity);
+    printf("Sampling every %d ms, reporting every %u ms or on change >= %.1f C / %.1f %%\n", sample_ms, report_ms, change_temp, change_humidity);
+
     // 센서 데이터와 서버 연결을 위한 스레드 생성 & 실패 시 에러 메세지 출력
     if (pthread_create(&thr_id, NULL, server_thread, NULL) != 0)
     {
@@ -56,194 +88,106 @@ int main(void)
 // 서버 연결을 위한 thread 생성
 void *server_thread(void *arg)
 {
-    struct sockaddr_in server_addr;
-    int sock;
-
-    // 소켓 생성
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-    // 실패 시 에러 메세지 출력
-    if (sock == -1)
-    {
-        perror("Socket creation error\n");
-        return NULL;
-    }
+    struct transport link;
 
-    // server_add 0으로 초기화
-    memset(&server_addr, 0, sizeof(server_addr));
-
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = inet_addr(SERVER_ADDRESS);
-    server_addr.sin_port = htons(SERVER_PORT);
-
-    // 서버에 연결 & 실패 시 에러 메세지 출력
-    if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1)
+    // 서버 연결 준비 (처음 연결에 실패해도 측정은 계속하고 spool에 쌓아 두었다가 재연결 후 전송)
+    if (transport_open(&link, SERVER_ADDRESS, SERVER_PORT, NODE_ID, PROTO_TEMP, SITE_ID, ZONE_ID, SPOOL_PATH, SPOOL_BYTES) == -1)
     {
-        perror("Server connection failed");
-        close(sock);
         return NULL;
     }
 
-    // 성공 시 연결 성공 메세지 출력
-    printf("Connected to server\n");
-
-    // 서버로 20초 간격으로 측정 데이터 평균 send
+    // 측정 간격마다 읽어 집계기에 넣고, 주기가 되었거나 값이 빠르게 변했을 때만 send
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
     while (1)
     {
-        send_average(sock);
-        delay(2000);
-    }
-
-    close(sock);
-    return NULL;
-}
-
-// 센서로부터 데이터 read
-void read_data()
-{
-    int state = HIGH;
-    int count = 0;
-    int bit_index = 0;
-
-    memset(data, 0, sizeof(data)); // 데이터를 받아 올 array 초기화
-
-    pinMode(PIN, OUTPUT); // set the pin to output mode - 파이의 핀 사용 준비
-
-    // DHT11은 PIN을 LOW로 설정하고 18ms동안 유지시 이를 데이터 요청 신호로 인식
-    digitalWrite(PIN, LOW); // 데이터를 받기 위해 pin을 low로 설정
-    delay(18);              // state를 low로 18초간 유지
-
-    // PIN을 HIGH로 설정하고 40ms동안 유지시켜 센서가 데이터를 준비할 수 있는 시간을 제공
-    digitalWrite(PIN, HIGH); // 핀 high로 설정 - 데이터 요청 신호 종료
-    delayMicroseconds(40);   // 센서가 준비될 때까지 40ms 대기
-    pinMode(PIN, INPUT);     // 센서로 부터 데이터를 받기 위한 준비가 되었음을 PIN을 input으로 설정
-
-    // 데이터 읽기
-    for (int i = 0; i < MAX_TIME; i++)
-    {
-        count = 0;
-        // 각 상태에 대한 count 세기
-        while (digitalRead(PIN) == state)
+        struct dht_reading reading;
+        if (read_data(&reading) == DHT_OK)
         {
-            count++;
-            delayMicroseconds(1);
-            // 무한루프 탈출 
-            if (count == 255)
+            struct dht_summary summary;
+            int emit = dht_aggregate_push(&aggregate, reading.temperature, reading.humidity, proto_monotonic_ms(), &summary); // 전송 주기는 단조 시계로 셈
+            if (emit != DHT_EMIT_NONE)
             {
-                break;
+                send_summary(&link, &summary, emit, proto_now_ms());
             }
         }
-
-        // pin의 현재 상태 저장
-        state = digitalRead(PIN);
-
-        // 무한루프 탈출
-        if (count == 255)
+        transport_poll(&link); // 연결이 끊겨 있으면 재연결 시도
+        struct proto_control control;
+        if (transport_control(&link, &control))
         {
-            break;
+            apply_control(&control); // 서버가 현장 WBGT에 맞춰 측정 속도를 바꿈
         }
 
-        /* 
-        처음 4번은 연결상태 확인하는 handshake부분 - 무시
-        DHT11 센서의 각 비트는 HIGH, LOW 상태 변화 페어로 전달
-        HIGH의 상태 길이는 비트 값을 나타냄(26-28ms:0, 70ms:1)
-        => LOW 상태 이후 HIGH 상태 길이 측정하여 비트 값 결정함
-        */
-        if ((i >= 4) && (i % 2 == 0))
+        // 측정에 걸린 시간(재시도 포함)과 무관하게 일정한 간격 유지 (밀렸으면 지금부터 다시 셈)
+        next.tv_sec += sample_ms / 1000;
+        next.tv_nsec += (long)(sample_ms % 1000) * 1000000L;
+        if (next.tv_nsec >= 1000000000L)
         {
-            int bit_pos = (bit_index / 8);       // byte position - 현재 비트가 어느 바이트에 위치하는지
-            int bit_shift = 7 - (bit_index % 8); // bit shift position - 바이트 내에서의 비트의 위치.
-
-            // 비트 값 결정 후 바이트와 위치에 저장 , HIGH 상태가 16ms보다 길면 1, 짧으면 0으로 결정
-            int bit_value;
-
-            // count에 따라 bit_value 결정
-            if (count > 50)
-            {
-                bit_value = 1; 
-            }
-            else
-            {
-                bit_value = 0; 
-            }
-
-            // 결정된 비트 값을 바이트 내 올바른 위치로 이동
-            int shifted_bit = bit_value << bit_shift;
-
-            // data 배열에서 현재 비트를 저장할 바이트 값 get
-            int current_byte = data[bit_pos];
-
-            // 이동된 비트 값을 현재 바이트 값과 결합
-            current_byte |= shifted_bit;
-
-            // 결합된 결과 data에 다시 저장
-            data[bit_pos] = current_byte;
-
-            // 옆으로 index 이동
-            bit_index++;
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+        {
+            next = now;
         }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
     }
 
-    // 체크섬 확인 및 데이터 출력
-    if ((bit_index >= 40) && (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)))
-    {
-        float humidity = (float)data[0] + (float)data[1] * 0.1;
-        float temperature = (float)data[2] + (float)data[3] * 0.1;
-
-        // 평균 출력을 위해 humidity,temp. 더하기
-        sum_humidity += humidity;
-        sum_temp += temperature;
-
-        // valid 한 데이터가 들어온 것에 대한 times 추가
-        read_times++;
+    transport_close(&link);
+    return NULL;
+}
 
-        printf("Humidity = %.1f%% Temperature = %.1f°C\n", humidity, temperature);
+// 센서로부터 데이터 read
+int read_data(struct dht_reading *reading)
+{
+    int status = dht_sensor_read(&sensor, reading);
+    if (status == DHT_OK)
+    {
+        printf("Humidity = %.1f%% Temperature = %.1f°C\n", reading->humidity, reading->temperature);
     }
     else
     {
         printf("Invalid data. skip! \n");
     }
+    return status;
 }
 
-// 평균 계산 및 data send to server
-void send_average(int sock)
+// 집계 결과를 server로 send (주기 전송이면 창 평균, 빠른 변화면 방금 측정값)
+void send_summary(struct transport *link, const struct dht_summary *summary, int emit, uint64_t timestamp_ms)
 {
-    char message[100];
+    uint8_t frame[PROTO_MAX_FRAME];
 
-    read_data();
-    sample_count++;
+    // 메세지 출력
+    printf("%s: Temperature = %.1f°C (min %.1f, max %.1f, ewma %.1f), Humidity = %.1f%% (min %.1f, max %.1f, ewma %.1f), %u samples\n",
+           emit == DHT_EMIT_CHANGE ? "Rapid change" : "Window average",
+           summary->temperature, summary->temp_min, summary->temp_max, summary->temp_ewma,
+           summary->humidity, summary->humidity_min, summary->humidity_max, summary->humidity_ewma, summary->count);
 
-    // 측정 횟수가 10번이 되되면 메세지 출력
-    if (sample_count == 10)
-    {
-        // valid한 값이 측정되었을 때만 평균 계산
-        if (read_times > 0)
-        {
-            // 평균 계산
-            float avg_humidity = sum_humidity / read_times;
-            float avg_temp = sum_temp / read_times;
+    // 바이너리 프레임으로 인코딩
+    size_t frame_len = proto_encode_temp(frame, sizeof(frame), NODE_ID, send_seq++, timestamp_ms, summary->temperature, summary->humidity);
 
-            // 메세지 출력
-            printf("Average Temperature and Humidity are calculated!\n");
-            printf("Average Temperature = %.1f°C, Average Humidity = %.1f%%\n", avg_temp, avg_humidity);
-
-            // message에 저장
-            snprintf(message, sizeof(message), "%.1f %.1f", avg_temp, avg_humidity);
+    // 서버에 전달 (연결이 없으면 spool에 저장, 저장도 못 하면 메세지 출력)
+    if (transport_send(link, frame, frame_len) == -1)
+    {
+        printf("Transmission failed, reading dropped\n");
+    }
 
-            // 서버에 전달 실패시 메세지 출력
-            if (send(sock, message, strlen(message), 0) == -1)
-            {
-                perror("Transmission failed");
-            }
-        }
-        // valid한 데이터가 센서로부터 얻지 못했을 때 오류 메세지 출력
-        else
-        {
-            printf("No valid data to calculate averages\n");
-        }
-        // 반복해서 데이터를 읽고자 변수 초기화
-        sample_count = 0;
-        sum_humidity = 0.0;
-        sum_temp = 0.0;
-        read_times = 0;
+    // 빠른 변화는 경보 판단에 쓰이므로 묶음 대기 없이 바로 보냄
+    if (emit == DHT_EMIT_CHANGE)
+    {
+        transport_flush(link);
     }
-}
\ No newline at end of file
+}
+
+// 서버의 측정 속도 지시를 적용하는 함수 (간격이 0이면 설정된 기본값으로 되돌림)
+static void apply_control(const struct proto_control *control)
+{
+    int ms = control->sample_us ? (int)(control->sample_us / 1000) : default_sample_ms;
+    sample_ms = ms < 1000 ? 1000 : ms; // DHT11 최소 측정 간격
+    uint32_t report_ms = control->report_ms ? control->report_ms : default_report_ms;
+    dht_aggregate_set_report(&aggregate, report_ms, proto_monotonic_ms());
+    printf("Server requested %s rate: sampling every %d ms, reporting every %u ms\n",
+           control->level == PROTO_RATE_FAST ? "fast" : control->level == PROTO_RATE_RELAXED ? "relaxed" : "normal", sample_ms, report_ms);
+}
@@ -0,0 +1,190 @@
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <linux/types.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "protocol.h"
+#include "adc.h"
+
+#define ADC_RETRIES 3 // 전송 실패 시 재시도 횟수
+#define ADC_RETRY_US 1000 // 첫 재시도 대기 시간 (재시도마다 두 배)
+
+// SPI 설정
+static uint8_t MODE = 0; // SPI 모드 설정
+static uint8_t BITS = 8; // 전송 비트 수 설정
+static uint32_t CLOCK = 1000000; // SPI 클럭 속도 설정
+static uint16_t DELAY = 5; // 전송 딜레이 설정
+
+// 흑구 온도계 서미스터 설정
+#define NTC_R0 10000.0 // 25C에서의 저항
+#define NTC_BETA 3950.0 // B 상수
+#define NTC_SERIES 10000.0 // 분압 저항
+
+// SPI 장치를 준비하는 함수
+static int prepare(int fd)
+{
+    if (ioctl(fd, SPI_IOC_WR_MODE, &MODE) == -1) // SPI 모드 설정
+    {
+        perror("Can't set MODE");
+        return -1;
+    }
+    if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &BITS) == -1) // 전송 비트 수 설정
+    {
+        perror("Can't set number of BITS");
+        return -1;
+    }
+    if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &CLOCK) == -1) // SPI 클럭 속도 설정
+    {
+        perror("Can't set write CLOCK");
+        return -1;
+    }
+    if (ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &CLOCK) == -1) // SPI 읽기 클럭 속도 설정
+    {
+        perror("Can't set read CLOCK");
+        return -1;
+    }
+    return 0;
+}
+
+// 단일 입력 모드 + 채널 번호 제어 비트
+static uint8_t control_bits(uint8_t channel)
+{
+    return 0x8 | ((channel & 7) << 4);
+}
+
+// SPI 장치 열기 함수
+int adc_open(struct adc_device* dev, const char* path)
+{
+    memset(dev, 0, sizeof(*dev));
+    snprintf(dev->path, sizeof(dev->path), "%s", path);
+    dev->channels[0].channel = 0;
+    dev->channels[0].kind = PROTO_ANALOG_LIGHT;
+    dev->count = 1;
+
+    dev->fd = open(dev->path, O_RDWR);
+    if (dev->fd < 0)
+    {
+        perror("Device open error");
+        return -1;
+    }
+    if (prepare(dev->fd) == -1)
+    {
+        close(dev->fd);
+        dev->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// 채널 설정 문자열을 해석하는 함수 (예: "0:light,1:light,2:globe")
+int adc_parse_channels(struct adc_device* dev, const char* spec)
+{
+    int count = 0;
+    char buf[128];
+    struct adc_channel parsed[ADC_CHANNELS];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char* tok = strtok(buf, ","); tok != NULL && count < ADC_CHANNELS; tok = strtok(NULL, ","))
+    {
+        unsigned int ch;
+        char kind[16];
+        if (sscanf(tok, "%u:%15s", &ch, kind) != 2 || ch >= ADC_CHANNELS)
+        {
+            fprintf(stderr, "Ignoring channel spec '%s'\n", tok);
+            continue;
+        }
+        parsed[count].channel = ch;
+        parsed[count].kind = (strcmp(kind, "globe") == 0) ? PROTO_ANALOG_GLOBE : PROTO_ANALOG_LIGHT;
+        count++;
+    }
+    if (count > 0)
+    {
+        memcpy(dev->channels, parsed, count * sizeof(parsed[0]));
+        dev->count = count;
+    }
+    return count;
+}
+
+// 설정된 모든 채널을 한 번의 SPI_IOC_MESSAGE(N) 전송으로 읽는 함수 (성공 시 0, 실패 시 -1)
+static int scan_once(const struct adc_device* dev, int* values)
+{
+    uint8_t tx[ADC_CHANNELS][3]; // 채널별 전송 버퍼
+    uint8_t rx[ADC_CHANNELS][3]; // 채널별 수신 버퍼
+    struct spi_ioc_transfer tr[ADC_CHANNELS]; // 채널별 전송 구조체
+
+    memset(tr, 0, sizeof(tr));
+    for (int i = 0; i < dev->count; i++)
+    {
+        tx[i][0] = 1; // 시작 비트
+        tx[i][1] = control_bits(dev->channels[i].channel);
+        tx[i][2] = 0;
+        tr[i].tx_buf = (unsigned long)tx[i];
+        tr[i].rx_buf = (unsigned long)rx[i];
+        tr[i].len = sizeof(tx[i]);
+        tr[i].delay_usecs = DELAY;
+        tr[i].speed_hz = CLOCK;
+        tr[i].bits_per_word = BITS;
+        tr[i].cs_change = (i < dev->count - 1); // 변환마다 CS를 올렸다 내려야 MCP3008이 새 변환을 시작함
+    }
+
+    if (ioctl(dev->fd, SPI_IOC_MESSAGE(dev->count), tr) < 0)
+    {
+        return -1;
+    }
+    for (int i = 0; i < dev->count; i++)
+    {
+        values[i] = ((rx[i][1] << 8) & 0x300) | (rx[i][2] & 0xFF); // 10비트 결과
+    }
+    return 0;
+}
+
+// 채널 스캔 함수 (실패하면 간격을 늘려 가며 재시도하고, 끝내 실패하면 장치를 다시 열고 -1 반환)
+int adc_scan(struct adc_device* dev, int* values)
+{
+    int wait_us = ADC_RETRY_US;
+    for (int attempt = 0; attempt <= ADC_RETRIES; attempt++)
+    {
+        if (dev->fd >= 0 && scan_once(dev, values) == 0)
+        {
+            return 0;
+        }
+        perror("SPI scan failed, retrying");
+        usleep(wait_us);
+        wait_us *= 2;
+    }
+
+    // 장치가 사라졌다 돌아온 경우 대비
+    if (dev->fd >= 0)
+    {
+        close(dev->fd);
+    }
+    dev->fd = open(dev->path, O_RDWR);
+    if (dev->fd < 0 || prepare(dev->fd) == -1)
+    {
+        perror("Device reopen failed");
+    }
+    return -1;
+}
+
+// ADC 값을 흑구 온도(C)로 바꾸는 함수
+float adc_globe_temperature(int adc)
+{
+    if (adc <= 0 || adc >= ADC_MAX)
+    {
+        return NAN; // 단선 또는 단락
+    }
+    double r = NTC_SERIES * adc / (ADC_MAX - adc); // 서미스터 저항
+    return (float)(1.0 / (1.0 / 298.15 + log(r / NTC_R0) / NTC_BETA) - 273.15);
+}
+
+// SPI 장치 닫기 함수
+void adc_close(struct adc_device* dev)
+{
+    if (dev->fd >= 0)
+    {
+        close(dev->fd);
+        dev->fd = -1;
+    }
+}
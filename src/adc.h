@@ -0,0 +1,47 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+
+/*
+ * MCP3008 SPI ADC 읽기
+ * 설정된 모든 채널을 SPI_IOC_MESSAGE(N) 한 번으로 읽고 (채널마다 CS를 올렸다 내려 새 변환 시작),
+ * 전송이 실패하면 간격을 두 배씩 늘려 ADC_RETRIES번 재시도한 뒤 장치를 다시 엶
+ * 채널 설정은 "0:light,1:light,2:globe"처럼 지정 (기본은 0번 조도 채널 하나)
+ * 흑구 채널은 NTC 10k(B=3950) 서미스터 + 10k 분압 저항 (서미스터가 GND 쪽)
+ */
+#define ADC_CHANNELS 8 // MCP3008 채널 수
+#define ADC_MAX 1023 // 10비트 ADC 최대값
+
+// 스캔할 채널
+struct adc_channel
+{
+    uint8_t channel; // ADC 채널 번호
+    uint8_t kind; // 채널 종류 (enum proto_analog_kind)
+};
+
+// SPI 장치와 채널 설정
+struct adc_device
+{
+    int fd; // SPI 장치 파일 (-1이면 다시 열어야 함)
+    char path[64]; // SPI 장치 경로
+    struct adc_channel channels[ADC_CHANNELS]; // 스캔할 채널
+    int count; // 채널 수
+};
+
+// SPI 장치 열기 (채널은 0번 조도 하나로 초기화, 실패 시 -1)
+int adc_open(struct adc_device* dev, const char* path);
+
+// 채널 설정 문자열 해석 (잘못된 항목은 건너뜀, 해석된 채널 수 반환, 0이면 기존 설정 유지)
+int adc_parse_channels(struct adc_device* dev, const char* spec);
+
+// 모든 채널을 한 번 읽기 (values는 설정 순서, 재시도 후에도 실패하면 장치를 다시 열고 -1)
+int adc_scan(struct adc_device* dev, int* values);
+
+// ADC 값을 흑구 온도(C)로 변환 (단선/단락이면 NAN)
+float adc_globe_temperature(int adc);
+
+// SPI 장치 닫기
+void adc_close(struct adc_device* dev);
+
+#endif
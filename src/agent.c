@@ -0,0 +1,746 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "protocol.h"
+#include "gpio.h"
+#include "dht_sensor.h"
+#include "dht_aggregate.h"
+#include "adc.h"
+#include "light_filter.h"
+#include "transport.h"
+
+/*
+ * 여러 센서를 한 프로세스, 한 쓰레드, 한 서버 연결로 다루는 노드 에이전트
+ * AGENT_SENSORS 환경 변수로 켤 센서를 고름 (예: "dht,light,pir", 기본은 모두)
+ * 모든 대기는 하나의 epoll로 모음
+ *  - DHT11: timerfd로 측정 시각/시작 신호/응답 시간 초과를 재고, 응답 에지는 GPIO 라인 fd로 받음
+ *  - ADC: 스캔 주기 timerfd마다 모든 채널을 한 번에 읽어 채널별 필터에 넣음
+ *  - PIR: GPIO 라인 fd로 에지를 받고, heartbeat는 timerfd
+ *  - 연결 확인과 측정 속도 지시 수신은 POLL_MS 주기 timerfd
+ * 센서마다 기존 클라이언트와 같은 노드로 HELLO를 보내고(AGENT_NODE_ID부터 차례로), 연결 하나와 spool 하나를 함께 씀
+ * 센서별 설정은 기존 클라이언트와 같은 환경 변수 사용 (DHT11_SAMPLE_MS, LIGHT_CHANNELS, LIGHT_SAMPLE_HZ 등)
+ */
+
+#define DHT_PIN 2 // DHT11 데이터 핀
+#define PIR_PIN 20 // PIR 센서 핀
+#define DEVICE "/dev/spidev0.0" // SPI 장치 파일 경로
+
+// 측정 설정 (기존 클라이언트와 같은 기본값)
+#define DHT_SAMPLE_MS 2000 // 기본 DHT11 측정 간격
+#define DHT_REPORT_MS 20000 // 기본 DHT11 주기 전송 간격
+#define DHT_EWMA_ALPHA 0.2f // 변화 감지 기준선 EWMA 가중치
+#define DHT_CHANGE_TEMP 1.5f // 바로 보낼 온도 변화 기준
+#define DHT_CHANGE_HUMIDITY 8.0f // 바로 보낼 습도 변화 기준
+#define ADC_SAMPLE_HZ 500 // 기본 ADC 스캔 주파수
+#define ADC_OUTPUT_MS 1000 // 기본 조도 출력 주기
+#define PIR_HEARTBEAT_MS 10000 // 상태 변화가 없을 때 현재 상태를 보내는 주기
+#define EVENT_BATCH 16 // 한 번에 읽을 최대 에지 이벤트 수
+#define POLL_MS 20 // 재연결과 측정 속도 지시를 확인하는 주기
+#define MAX_EVENTS 8 // epoll_wait 한 번에 처리할 최대 이벤트 수
+
+// 서버 정보 정의
+#define SERVER_ADDRESS "192.168.45.8"
+#define SERVER_PORT 8080
+#define NODE_ID 10 // 첫 센서의 노드 ID (AGENT_NODE_ID로 변경, 켠 센서 순서대로 1씩 증가)
+#define SITE_ID 1 // 노드가 설치된 현장 ID
+#define ZONE_ID 1 // 현장 내 구역 ID
+#define SPOOL_PATH "agent.spool" // 연결이 끊긴 동안의 측정을 보관할 파일
+#define SPOOL_BYTES (1 << 20) // spool 크기
+
+// epoll 이벤트 출처
+enum agent_source
+{
+    SRC_DHT_TIMER, // DHT11 측정 단계 타이머
+    SRC_DHT_LINE, // DHT11 응답 에지
+    SRC_ADC_TIMER, // ADC 스캔 주기
+    SRC_PIR_LINE, // PIR 에지
+    SRC_PIR_TIMER, // PIR heartbeat
+    SRC_POLL_TIMER // 연결 확인 주기
+};
+
+// DHT11 측정 단계
+enum dht_phase
+{
+    DHT_IDLE, // 다음 측정 시각을 기다림
+    DHT_STARTING, // 시작 신호(LOW)를 유지하는 중
+    DHT_LISTENING, // 응답 에지를 모으는 중
+    DHT_BACKOFF // 실패 후 재시도를 기다림
+};
+
+// DHT11 상태
+struct dht_task
+{
+    int enabled; // 켜져 있는지 여부
+    uint32_t node_id; // 보고할 노드 ID
+    uint32_t seq; // 전송 프레임 시퀀스 번호
+    struct dht_sensor sensor; // 센서
+    struct dht_aggregate aggregate; // 측정 창과 전송 시점 판단
+    int timer; // 단계 타이머 (timerfd)
+    int phase; // 측정 단계 (enum dht_phase)
+    int attempt; // 이번 측정의 시도 횟수
+    int sample_ms; // 측정 간격 (서버가 측정 속도를 지시하면 바뀜)
+    int default_sample_ms; // 설정된 측정 간격
+    uint32_t default_report_ms; // 설정된 주기 전송 간격
+    struct timespec next; // 다음 측정 시각 (CLOCK_MONOTONIC)
+};
+
+// ADC(조도/흑구) 상태
+struct adc_task
+{
+    int enabled; // 켜져 있는지 여부
+    uint32_t node_id; // 보고할 노드 ID
+    uint32_t seq; // 전송 프레임 시퀀스 번호
+    struct adc_device adc; // MCP3008
+    struct light_filter filters[ADC_CHANNELS]; // 채널별 이상값 제거 + 데시메이션 필터
+    int timer; // 스캔 주기 타이머 (timerfd)
+    int sample_hz; // 스캔 주파수
+    int default_sample_hz; // 설정된 스캔 주파수
+    int output_ms; // 출력 주기
+    int default_output_ms; // 설정된 출력 주기
+    uint64_t missed; // 이벤트 루프가 밀려 건너뛴 스캔 수
+    uint64_t failures; // 재시도 후에도 실패한 스캔 수
+};
+
+// PIR 상태
+struct pir_task
+{
+    int enabled; // 켜져 있는지 여부
+    uint32_t node_id; // 보고할 노드 ID
+    uint32_t seq; // 전송 프레임 시퀀스 번호
+    struct gpio_lines line; // PIR 입력 라인
+    int state; // 마지막으로 보낸 상태
+    int timer; // heartbeat 타이머 (timerfd)
+};
+
+// 변수 정의
+static struct dht_task dht;
+static struct adc_task light;
+static struct pir_task pir;
+static struct transport server; // 모든 센서가 함께 쓰는 서버 연결
+static int epoll_fd = -1;
+
+// 함수 선언
+static int parse_sensors(const char *spec);
+static int open_dht(void);
+static int open_adc(void);
+static int open_pir(void);
+static int watch(int fd, uint32_t source);
+static int make_timer(void);
+static void arm_at(int timer, const struct timespec *at);
+static void arm_in(int timer, long ms);
+static void arm_every(int timer, long interval_ns);
+static uint64_t expirations(int timer);
+static void dht_timer(void);
+static void dht_edges(void);
+static void dht_complete(void);
+static void adc_timer(void);
+static void reset_filters(void);
+static void retune_filters(int hz);
+static void pir_edges(void);
+static void pir_send(int state, uint8_t kind, uint64_t timestamp_ms);
+static void poll_server(void);
+static void apply_control(uint32_t node_id, const struct proto_control *control);
+
+int main(void)
+{
+    printf("Multi-sensor agent\n");
+
+    // 켤 센서 정하기
+    const char *spec = getenv("AGENT_SENSORS");
+    if (parse_sensors(spec != NULL ? spec : "dht,light,pir") == 0)
+    {
+        fprintf(stderr, "No sensors enabled (AGENT_SENSORS=dht,light,pir)\n");
+        return 1;
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+    {
+        perror("epoll_create1 failed");
+        return 1;
+    }
+
+    // 센서 준비 (실패한 센서는 끄고 나머지로 계속)
+    if (dht.enabled && open_dht() == -1)
+    {
+        dht.enabled = 0;
+    }
+    if (light.enabled && open_adc() == -1)
+    {
+        light.enabled = 0;
+    }
+    if (pir.enabled && open_pir() == -1)
+    {
+        pir.enabled = 0;
+    }
+    if (!dht.enabled && !light.enabled && !pir.enabled)
+    {
+        fprintf(stderr, "No sensor could be opened\n");
+        return 1;
+    }
+
+    // 켠 센서마다 노드를 하나씩 두고 연결 하나로 보냄 (첫 센서로 연결을 열고 나머지를 더함)
+    const char *env = getenv("AGENT_NODE_ID");
+    uint32_t node_id = (env != NULL && atoi(env) > 0) ? (uint32_t)atoi(env) : NODE_ID;
+    struct
+    {
+        int enabled;
+        uint32_t *node_id;
+        uint8_t type;
+    } nodes[] = {{dht.enabled, &dht.node_id, PROTO_TEMP}, {light.enabled, &light.node_id, PROTO_LIGHT}, {pir.enabled, &pir.node_id, PROTO_PIR}};
+    int opened = 0;
+    for (size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); i++)
+    {
+        if (!nodes[i].enabled)
+        {
+            continue;
+        }
+        *nodes[i].node_id = node_id++;
+        if (!opened)
+        {
+            if (transport_open(&server, SERVER_ADDRESS, SERVER_PORT, *nodes[i].node_id, nodes[i].type, SITE_ID, ZONE_ID, SPOOL_PATH, SPOOL_BYTES) == -1)
+            {
+                return 1;
+            }
+            opened = 1;
+        }
+        else
+        {
+            transport_add_node(&server, *nodes[i].node_id, nodes[i].type);
+        }
+    }
+    int poll_timer = make_timer();
+    if (poll_timer == -1 || watch(poll_timer, SRC_POLL_TIMER) == -1)
+    {
+        return 1;
+    }
+    arm_every(poll_timer, POLL_MS * 1000000L);
+    if (pir.enabled)
+    {
+        pir_send(pir.state, PROTO_PIR_HEARTBEAT, proto_now_ms()); // 서버가 시작 상태를 알 수 있도록 바로 보냄
+    }
+
+    // 이벤트 루프 (센서와 연결 모두 이 쓰레드 하나에서 처리)
+    while (1)
+    {
+        struct epoll_event events[MAX_EVENTS];
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("epoll_wait failed");
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            switch (events[i].data.u32)
+            {
+            case SRC_DHT_TIMER:
+                dht_timer();
+                break;
+            case SRC_DHT_LINE:
+                dht_edges();
+                break;
+            case SRC_ADC_TIMER:
+                adc_timer();
+                break;
+            case SRC_PIR_LINE:
+                pir_edges();
+                break;
+            case SRC_PIR_TIMER:
+                if (expirations(pir.timer) > 0)
+                {
+                    pir_send(pir.state, PROTO_PIR_HEARTBEAT, proto_now_ms()); // 변화가 없으면 현재 상태만 알림
+                }
+                break;
+            case SRC_POLL_TIMER:
+                if (expirations(poll_timer) > 0)
+                {
+                    poll_server();
+                }
+                break;
+            }
+        }
+    }
+
+    transport_close(&server);
+    if (dht.enabled)
+    {
+        dht_sensor_close(&dht.sensor);
+    }
+    if (light.enabled)
+    {
+        adc_close(&light.adc);
+    }
+    if (pir.enabled)
+    {
+        gpio_release(&pir.line);
+    }
+    return 0;
+}
+
+// 센서 목록 해석 함수 (켠 센서 수 반환)
+static int parse_sensors(const char *spec)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ", "); tok != NULL; tok = strtok(NULL, ", "))
+    {
+        if (strcmp(tok, "dht") == 0)
+        {
+            dht.enabled = 1;
+        }
+        else if (strcmp(tok, "light") == 0 || strcmp(tok, "adc") == 0)
+        {
+            light.enabled = 1;
+        }
+        else if (strcmp(tok, "pir") == 0)
+        {
+            pir.enabled = 1;
+        }
+        else
+        {
+            fprintf(stderr, "Ignoring unknown sensor '%s'\n", tok);
+        }
+    }
+    return dht.enabled + light.enabled + pir.enabled;
+}
+
+// DHT11 준비 함수
+static int open_dht(void)
+{
+    if (dht_sensor_open(&dht.sensor, DHT_PIN, getenv("DHT11_TRACE")) == -1)
+    {
+        perror("DHT11 GPIO initialization failed");
+        return -1;
+    }
+    const char *env = getenv("DHT11_SAMPLE_MS");
+    dht.sample_ms = (env != NULL && atoi(env) >= 1000) ? atoi(env) : DHT_SAMPLE_MS;
+    dht.default_sample_ms = dht.sample_ms;
+    env = getenv("DHT11_REPORT_MS");
+    dht.default_report_ms = (env != NULL && atoi(env) > 0) ? (uint32_t)atoi(env) : DHT_REPORT_MS;
+    env = getenv("DHT11_CHANGE_C");
+    float change_temp = env != NULL ? (float)atof(env) : DHT_CHANGE_TEMP;
+    env = getenv("DHT11_CHANGE_RH");
+    float change_humidity = env != NULL ? (float)atof(env) : DHT_CHANGE_HUMIDITY;
+    dht_aggregate_init(&dht.aggregate, dht.default_report_ms, DHT_EWMA_ALPHA, change_temp, change_humidity);
+
+    // 첫 측정은 바로 시작
+    dht.timer = make_timer();
+    if (dht.timer == -1 || watch(dht.timer, SRC_DHT_TIMER) == -1 || watch(dht.sensor.line.fd, SRC_DHT_LINE) == -1)
+    {
+        dht_sensor_close(&dht.sensor);
+        return -1;
+    }
+    dht.phase = DHT_IDLE;
+    clock_gettime(CLOCK_MONOTONIC, &dht.next);
+    arm_at(dht.timer, &dht.next);
+    printf("DHT11: sampling every %d ms, reporting every %u ms or on change >= %.1f C / %.1f %%\n", dht.sample_ms, dht.default_report_ms, change_temp, change_humidity);
+    return 0;
+}
+
+// ADC 준비 함수
+static int open_adc(void)
+{
+    if (adc_open(&light.adc, DEVICE) == -1)
+    {
+        return -1;
+    }
+    const char *env = getenv("LIGHT_CHANNELS"); // 스캔할 채널 설정
+    if (env != NULL)
+    {
+        adc_parse_channels(&light.adc, env);
+    }
+    env = getenv("LIGHT_SAMPLE_HZ");
+    light.sample_hz = (env != NULL && atoi(env) > 0) ? atoi(env) : ADC_SAMPLE_HZ;
+    light.default_sample_hz = light.sample_hz;
+    env = getenv("LIGHT_OUTPUT_MS");
+    light.output_ms = (env != NULL && atoi(env) > 0) ? atoi(env) : ADC_OUTPUT_MS;
+    light.default_output_ms = light.output_ms;
+
+    light.timer = make_timer();
+    if (light.timer == -1 || watch(light.timer, SRC_ADC_TIMER) == -1)
+    {
+        adc_close(&light.adc);
+        return -1;
+    }
+    reset_filters();
+    return 0;
+}
+
+// PIR 준비 함수
+static int open_pir(void)
+{
+    unsigned int pin = PIR_PIN;
+    if (gpio_request(&pir.line, GPIO_CHIP, &pin, 1, GPIO_INPUT | GPIO_EDGE_BOTH, 0, "agent-pir") == -1)
+    {
+        perror("PIR GPIO initialization failed");
+        return -1;
+    }
+    pir.state = gpio_read(&pir.line, 0); // 시작 상태
+    pir.timer = make_timer();
+    if (pir.timer == -1 || watch(pir.timer, SRC_PIR_TIMER) == -1 || watch(pir.line.fd, SRC_PIR_LINE) == -1)
+    {
+        gpio_release(&pir.line);
+        return -1;
+    }
+    printf("PIR: heartbeat every %d ms\n", PIR_HEARTBEAT_MS);
+    return 0;
+}
+
+// fd를 epoll에 등록하는 함수 (source는 이벤트 출처)
+static int watch(int fd, uint32_t source)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = source;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        perror("epoll_ctl failed");
+        return -1;
+    }
+    return 0;
+}
+
+// 타이머 생성 함수 (CLOCK_MONOTONIC, 논블로킹)
+static int make_timer(void)
+{
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer == -1)
+    {
+        perror("timerfd_create failed");
+    }
+    return timer;
+}
+
+// 절대 시각에 한 번 울리도록 설정하는 함수 (지난 시각이면 바로 울림)
+static void arm_at(int timer, const struct timespec *at)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value = *at;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+    {
+        spec.it_value.tv_nsec = 1; // 0은 타이머 해제라서 가장 이른 시각으로
+    }
+    timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+// ms 뒤에 한 번 울리도록 설정하는 함수
+static void arm_in(int timer, long ms)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    if (ms <= 0)
+    {
+        spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timer, 0, &spec, NULL);
+}
+
+// 일정한 간격으로 울리도록 설정하는 함수 (다시 설정하면 지금부터 다시 셈)
+static void arm_every(int timer, long interval_ns)
+{
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ns / 1000000000L;
+    spec.it_interval.tv_nsec = interval_ns % 1000000000L;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer, 0, &spec, NULL);
+}
+
+// 타이머가 울린 횟수를 읽는 함수 (울리지 않았으면 0)
+static uint64_t expirations(int timer)
+{
+    uint64_t count;
+    if (read(timer, &count, sizeof(count)) != sizeof(count))
+    {
+        return 0;
+    }
+    return count;
+}
+
+// DHT11 단계 타이머 처리 함수 (측정 시각 -> 시작 신호 -> 응답 수집 -> 디코드)
+static void dht_timer(void)
+{
+    if (expirations(dht.timer) == 0)
+    {
+        return;
+    }
+    switch (dht.phase)
+    {
+    case DHT_IDLE:
+        dht.attempt = 0;
+        // fall through
+    case DHT_BACKOFF:
+        dht_sensor_start(&dht.sensor);
+        dht.phase = DHT_STARTING;
+        arm_in(dht.timer, DHT_START_MS);
+        break;
+    case DHT_STARTING:
+        dht_sensor_listen(&dht.sensor);
+        dht.phase = DHT_LISTENING;
+        arm_in(dht.timer, DHT_RESPONSE_TIMEOUT_MS);
+        break;
+    case DHT_LISTENING:
+        dht_complete(); // 응답 시간이 지남
+        break;
+    }
+}
+
+// DHT11 응답 에지 처리 함수 (에지 시각은 커널이 기록하므로 늦게 읽어도 디코드에 영향 없음)
+static void dht_edges(void)
+{
+    if (dht.phase != DHT_LISTENING)
+    {
+        struct gpio_event stale[EVENT_BATCH];
+        gpio_read_events(&dht.sensor.line, stale, EVENT_BATCH); // 측정 중이 아닐 때의 에지는 버림
+        return;
+    }
+    dht_sensor_collect(&dht.sensor);
+    if (dht.sensor.count >= DHT_MAX_EDGES)
+    {
+        dht_complete(); // 버퍼가 찼으면 시간 초과를 기다리지 않음
+    }
+}
+
+// DHT11 측정 마무리 함수 (성공하면 집계기에 넣고 다음 측정 시각을, 실패하면 재시도 시각을 예약)
+static void dht_complete(void)
+{
+    struct dht_reading reading;
+    int status = dht_sensor_finish(&dht.sensor, &reading);
+    if (status != DHT_OK)
+    {
+        dht.attempt++;
+        printf("DHT11 read failed (%s, %zu edges), attempt %d/%d\n", dht_status_name(status), dht.sensor.count, dht.attempt, DHT_RETRIES);
+        if (dht.attempt < DHT_RETRIES)
+        {
+            dht.phase = DHT_BACKOFF;
+            arm_in(dht.timer, DHT_RETRY_DELAY_MS);
+            return;
+        }
+    }
+    else
+    {
+        uint64_t now_ms = proto_now_ms(); // 프레임 시각 (전송 주기는 단조 시계로 셈)
+        struct dht_summary summary;
+        int emit = dht_aggregate_push(&dht.aggregate, reading.temperature, reading.humidity, proto_monotonic_ms(), &summary);
+        if (emit != DHT_EMIT_NONE)
+        {
+            uint8_t frame[PROTO_MAX_FRAME];
+            printf("%s: Temperature = %.1f°C (min %.1f, max %.1f), Humidity = %.1f%% (min %.1f, max %.1f), %u samples\n",
+                   emit == DHT_EMIT_CHANGE ? "Rapid change" : "Window average",
+                   summary.temperature, summary.temp_min, summary.temp_max, summary.humidity, summary.humidity_min, summary.humidity_max, summary.count);
+            size_t frame_len = proto_encode_temp(frame, sizeof(frame), dht.node_id, dht.seq++, now_ms, summary.temperature, summary.humidity);
+            if (transport_send(&server, frame, frame_len) == -1)
+            {
+                printf("Transmission failed, reading dropped\n");
+            }
+            if (emit == DHT_EMIT_CHANGE)
+            {
+                transport_flush(&server); // 빠른 변화는 경보 판단에 쓰이므로 바로 보냄
+            }
+        }
+    }
+
+    // 측정에 걸린 시간(재시도 포함)과 무관하게 일정한 간격 유지 (밀렸으면 지금부터 다시 셈)
+    struct timespec now;
+    dht.next.tv_sec += dht.sample_ms / 1000;
+    dht.next.tv_nsec += (long)(dht.sample_ms % 1000) * 1000000L;
+    if (dht.next.tv_nsec >= 1000000000L)
+    {
+        dht.next.tv_sec++;
+        dht.next.tv_nsec -= 1000000000L;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > dht.next.tv_sec || (now.tv_sec == dht.next.tv_sec && now.tv_nsec > dht.next.tv_nsec))
+    {
+        dht.next = now;
+    }
+    dht.phase = DHT_IDLE;
+    arm_at(dht.timer, &dht.next);
+}
+
+// ADC 스캔 주기 처리 함수 (모든 채널을 한 번에 읽어 필터에 넣고, 출력이 나온 채널을 한 프레임으로 보냄)
+static void adc_timer(void)
+{
+    uint64_t count = expirations(light.timer);
+    if (count == 0)
+    {
+        return;
+    }
+    light.missed += count - 1; // 루프가 다른 센서를 처리하느라 밀린 스캔은 몰아서 하지 않음
+
+    int values[ADC_CHANNELS];
+    if (adc_scan(&light.adc, values) == -1)
+    {
+        light.failures++;
+        return;
+    }
+    struct proto_analog readings[ADC_CHANNELS];
+    int outputs = 0;
+    for (int i = 0; i < light.adc.count; i++)
+    {
+        float average;
+        if (!light_filter_push(&light.filters[i], (uint16_t)values[i], &average))
+        {
+            continue; // 아직 출력 주기가 아님
+        }
+        if (light.adc.channels[i].kind == PROTO_ANALOG_GLOBE)
+        {
+            average = adc_globe_temperature((int)(average + 0.5f)); // 흑구 온도는 필터를 거친 ADC 값으로 변환
+            if (isnan(average))
+            {
+                printf("Globe sensor on channel %d disconnected\n", light.adc.channels[i].channel);
+                continue;
+            }
+            printf("Globe Temperature: %.1f C\n", average);
+        }
+        else
+        {
+            printf("Light Sensor Value: %.1f (%llu outliers rejected)\n", average, (unsigned long long)light.filters[i].rejected);
+        }
+        readings[outputs].channel = light.adc.channels[i].channel;
+        readings[outputs].kind = light.adc.channels[i].kind;
+        readings[outputs].value = average;
+        outputs++;
+    }
+    if (outputs == 0)
+    {
+        return;
+    }
+
+    uint8_t frame[PROTO_MAX_FRAME];
+    size_t frame_len = proto_encode_analog(frame, sizeof(frame), light.node_id, light.seq++, proto_now_ms(), readings, outputs);
+    if (transport_send(&server, frame, frame_len) == -1)
+    {
+        printf("Send failed, reading dropped\n");
+    }
+    if (light.missed > 0 || light.failures > 0)
+    {
+        printf("Scans missed: %llu, failed: %llu\n", (unsigned long long)light.missed, (unsigned long long)light.failures);
+    }
+}
+
+// 현재 스캔 주파수와 출력 주기로 필터와 스캔 타이머를 다시 시작하는 함수
+static void reset_filters(void)
+{
+    uint32_t decimation = (uint32_t)((long)light.sample_hz * light.output_ms / 1000); // 출력 1개당 스캔 수
+    for (int i = 0; i < light.adc.count; i++)
+    {
+        light_filter_init(&light.filters[i], decimation);
+    }
+    arm_every(light.timer, 1000000000L / light.sample_hz);
+    printf("ADC: sampling %d channel(s) at %d Hz, sending every %d ms (decimation %u)\n", light.adc.count, light.sample_hz, light.output_ms, light.filters[0].decimation);
+}
+
+// 측정 속도 지시에 맞춰 스캔 주기와 데시메이션 비율만 바꾸는 함수 (필터 상태는 유지해 조도 값이 끊기지 않음)
+static void retune_filters(int hz)
+{
+    if (hz != light.sample_hz)
+    {
+        light.sample_hz = hz;
+        arm_every(light.timer, 1000000000L / light.sample_hz); // 스캔 주기가 바뀐 경우에만 타이머를 다시 설정
+    }
+    uint32_t decimation = (uint32_t)((long)light.sample_hz * light.output_ms / 1000); // 출력 1개당 스캔 수
+    int changed = 0;
+    for (int i = 0; i < light.adc.count; i++)
+    {
+        changed |= light_filter_set_decimation(&light.filters[i], decimation);
+    }
+    if (changed)
+    {
+        printf("ADC: sampling at %d Hz, sending every %d ms (decimation %u)\n", light.sample_hz, light.output_ms, light.filters[0].decimation);
+    }
+}
+
+// 커널 에지 시각(CLOCK_MONOTONIC ns)을 프레임 시각(ms)으로 바꾸는 함수
+static uint64_t event_time_ms(uint64_t timestamp_ns)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    uint64_t age_ms = now_ns > timestamp_ns ? (now_ns - timestamp_ns) / 1000000 : 0; // 에지 이후 지난 시간
+    return proto_now_ms() - age_ms;
+}
+
+// PIR 에지 처리 함수 (상태가 바뀐 에지만 에지 시각과 함께 보냄)
+static void pir_edges(void)
+{
+    struct gpio_event events[EVENT_BATCH];
+    int n = gpio_read_events(&pir.line, events, EVENT_BATCH);
+    int sent = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (events[i].value == pir.state)
+        {
+            continue; // 같은 상태로의 에지 (이미 보낸 상태)
+        }
+        printf("Motion %s\n", events[i].value ? "started" : "ended");
+        pir_send(events[i].value, PROTO_PIR_EDGE, event_time_ms(events[i].timestamp_ns));
+        sent = 1;
+    }
+    if (sent)
+    {
+        transport_flush(&server); // 모션 변화는 알람 확인에 쓰이므로 묶음 대기 없이 바로 보냄
+    }
+}
+
+// PIR 상태 전송 함수 (보낼 때마다 heartbeat는 뒤로 미룸)
+static void pir_send(int state, uint8_t kind, uint64_t timestamp_ms)
+{
+    uint8_t frame[PROTO_MAX_FRAME];
+    pir.state = state;
+    size_t frame_len = proto_encode_pir_event(frame, sizeof(frame), pir.node_id, pir.seq++, timestamp_ms, state, kind);
+    if (transport_send(&server, frame, frame_len) == -1)
+    {
+        printf("send failed, event dropped\n");
+    }
+    arm_every(pir.timer, PIR_HEARTBEAT_MS * 1000000L);
+}
+
+// 연결 확인 및 측정 속도 지시 수신 함수
+static void poll_server(void)
+{
+    struct proto_control controls[TRANSPORT_NODES];
+    uint32_t node_ids[TRANSPORT_NODES];
+    transport_poll(&server); // 연결이 끊겨 있으면 재연결 시도, 시간이 다 된 묶음 전송
+    int count = transport_controls(&server, controls, node_ids, TRANSPORT_NODES);
+    for (int i = 0; i < count; i++)
+    {
+        apply_control(node_ids[i], &controls[i]); // 서버가 현장 WBGT에 맞춰 센서별 측정 속도를 바꿈
+    }
+}
+
+// 서버의 측정 속도 지시를 해당 센서에 적용하는 함수 (간격이 0이면 설정된 기본값으로 되돌림)
+static void apply_control(uint32_t node_id, const struct proto_control *control)
+{
+    const char *level = control->level == PROTO_RATE_FAST ? "fast" : control->level == PROTO_RATE_RELAXED ? "relaxed" : "normal";
+    if (dht.enabled && node_id == dht.node_id)
+    {
+        int ms = control->sample_us ? (int)(control->sample_us / 1000) : dht.default_sample_ms;
+        dht.sample_ms = ms < 1000 ? 1000 : ms; // DHT11 최소 측정 간격
+        uint32_t report_ms = control->report_ms ? control->report_ms : dht.default_report_ms;
+        dht_aggregate_set_report(&dht.aggregate, report_ms, proto_monotonic_ms());
+        printf("Server requested %s rate for DHT11: sampling every %d ms, reporting every %u ms\n", level, dht.sample_ms, report_ms);
+    }
+    else if (light.enabled && node_id == light.node_id)
+    {
+        int hz = control->sample_us ? (int)(1000000 / control->sample_us) : light.default_sample_hz;
+        hz = hz > 0 ? hz : 1;
+        light.output_ms = control->report_ms ? (int)control->report_ms : light.default_output_ms;
+        printf("Server requested %s rate for ADC\n", level);
+        retune_filters(hz);
+    }
+}
@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <time.h>
+#include "alert.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+#include "pipeline.h"
+
+// 알람 설정
+#define ALERT_TICK_MS 10 // 타이머 휠 1 tick (사이렌 주파수 변경 주기와 같음)
+#define ALERT_MIN_MS 4000 // 확인과 관계없이 최소로 울리는 시간
+#define ALERT_ESCALATE_MS 30000 // 확인되지 않으면 단계를 올리는 주기
+#define ALERT_ESCALATE_DELTA 2.0f // 울리는 중 WBGT가 이만큼 더 오르면 즉시 단계 상승
+#define ALERT_MAX_LEVEL 3 // 최대 알람 단계
+#define ALERT_BUCKETS 1024 // 알람 해시 버킷 수 (2의 거듭제곱)
+#define ALERT_QUEUE_SIZE 1024 // 요청을 보내는 쓰레드별 큐 크기
+
+// 사이렌 설정
+#define MIN_FREQ 200 // 주파수의 최소값
+#define MAX_FREQ 1000 // 주파수의 최대값
+#define FREQ_STEP 10 // tick 마다 주파수를 바꾸는 단위 (단계가 오를수록 배수로 빨라짐)
+
+// 요청 종류
+enum alert_op
+{
+    ALERT_RAISE, // WBGT 초과
+    ALERT_ACK // 작업자 확인
+};
+
+// 스케줄러 쓰레드로 전달되는 요청
+struct alert_request
+{
+    int op; // 요청 종류 (enum alert_op)
+    uint16_t site_id; // 현장 ID
+    uint16_t zone_id; // 구역 ID
+    float wbgt; // 초과한 WBGT 값
+    uint64_t request_ns; // 요청 시각 (계측용)
+};
+
+// 현장/구역별 진행 중인 알람
+struct alert_entry
+{
+    uint16_t site_id; // 현장 ID
+    uint16_t zone_id; // 구역 ID
+    float wbgt; // 지금까지의 최고 WBGT
+    int level; // 알람 단계 (1부터)
+    int acked; // 작업자가 확인했는지 여부
+    int min_elapsed; // 최소 울림 시간이 지났는지 여부
+    uint64_t start_ns; // 알람 시작 시각 (계측용)
+    struct wheel_timer min_timer; // 최소 울림 시간 타이머
+    struct wheel_timer escalate_timer; // 단계 상승 타이머
+    struct alert_entry* next; // 같은 버킷의 다음 알람
+};
+
+// 요청 큐 (수신 쓰레드마다 락 없는 링, 알람 스케줄러 쓰레드만 꺼내 씀)
+static struct pipeline_stage requests;
+
+// 아래 상태는 알람 스케줄러 쓰레드만 접근
+static struct alert_actuators act; // 부저와 경고등
+static struct timer_wheel wheel; // 알람 타이머 휠
+static struct alert_entry* buckets[ALERT_BUCKETS]; // 진행 중인 알람 해시
+static int active_count = 0; // 진행 중인 알람 수
+static int siren_level = 1; // 사이렌 속도 (진행 중인 알람의 최고 단계)
+static int siren_freq = MIN_FREQ; // 현재 사이렌 주파수
+static int siren_dir = 1; // 주파수 변화 방향
+static uint64_t siren_tick = 0; // 마지막으로 주파수를 바꾼 tick
+
+static void* alert_thread(void* arg); // 알람 스케줄러 쓰레드 함수
+
+// 단조 시계 기준 현재 시각 (ms)
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 단조 시계 기준 현재 tick을 구하는 함수
+static uint64_t now_tick(void)
+{
+    return now_ms() / ALERT_TICK_MS;
+}
+
+// 현장/구역을 해시 버킷 번호로 바꾸는 함수
+static size_t bucket_of(uint16_t site_id, uint16_t zone_id)
+{
+    uint32_t key = ((uint32_t)site_id << 16) | zone_id;
+    return (key * 2654435761u) >> 22 & (ALERT_BUCKETS - 1);
+}
+
+// 진행 중인 알람을 찾는 함수
+static struct alert_entry* find_entry(uint16_t site_id, uint16_t zone_id)
+{
+    for (struct alert_entry* e = buckets[bucket_of(site_id, zone_id)]; e != NULL; e = e->next)
+    {
+        if (e->site_id == site_id && e->zone_id == zone_id)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// 알람을 끝내고 정리하는 함수
+static void stop_entry(struct alert_entry* entry)
+{
+    wheel_cancel(&wheel, &entry->min_timer);
+    wheel_cancel(&wheel, &entry->escalate_timer);
+
+    // 해시에서 제거
+    struct alert_entry** pp = &buckets[bucket_of(entry->site_id, entry->zone_id)];
+    while (*pp != entry)
+    {
+        pp = &(*pp)->next;
+    }
+    *pp = entry->next;
+
+    printf("Alert stopped at site %u zone %u\n", entry->site_id, entry->zone_id);
+    metrics_record(METRIC_ALERT_DURATION, metrics_now_ns() - entry->start_ns);
+    free(entry);
+
+    // 마지막 알람이 끝나면 부저와 경고등 끄기
+    if (--active_count == 0)
+    {
+        act.tone(0);
+        act.led(0);
+        siren_level = 1;
+    }
+}
+
+// 알람 단계를 올리는 함수
+static void escalate(struct alert_entry* entry)
+{
+    if (entry->level < ALERT_MAX_LEVEL)
+    {
+        entry->level++;
+        if (entry->level > siren_level)
+        {
+            siren_level = entry->level;
+        }
+        printf("Alert escalated to level %d at site %u zone %u (WBGT %.1f)\n", entry->level, entry->site_id, entry->zone_id, entry->wbgt);
+    }
+}
+
+// 최소 울림 시간 타이머 만료 시 호출되는 함수
+static void on_min_elapsed(struct wheel_timer* timer)
+{
+    struct alert_entry* entry = (struct alert_entry*)((char*)timer - offsetof(struct alert_entry, min_timer));
+    entry->min_elapsed = 1;
+    if (entry->acked)
+    {
+        stop_entry(entry); // 최소 시간 안에 확인된 알람은 지금 종료
+    }
+}
+
+// 단계 상승 타이머 만료 시 호출되는 함수
+static void on_escalate(struct wheel_timer* timer)
+{
+    struct alert_entry* entry = (struct alert_entry*)((char*)timer - offsetof(struct alert_entry, escalate_timer));
+    escalate(entry);
+    wheel_add(&wheel, &entry->escalate_timer, ALERT_ESCALATE_MS / ALERT_TICK_MS);
+}
+
+// WBGT 초과 요청을 처리하는 함수
+static void handle_raise(const struct alert_request* req)
+{
+    struct alert_entry* entry = find_entry(req->site_id, req->zone_id);
+
+    if (entry == NULL)
+    {
+        entry = calloc(1, sizeof(*entry));
+        if (entry == NULL)
+        {
+            perror("alert calloc failed");
+            return;
+        }
+        entry->site_id = req->site_id;
+        entry->zone_id = req->zone_id;
+        entry->wbgt = req->wbgt;
+        entry->level = 1;
+        wheel_timer_init(&entry->min_timer, on_min_elapsed);
+        wheel_timer_init(&entry->escalate_timer, on_escalate);
+        wheel_add(&wheel, &entry->min_timer, ALERT_MIN_MS / ALERT_TICK_MS);
+        wheel_add(&wheel, &entry->escalate_timer, ALERT_ESCALATE_MS / ALERT_TICK_MS);
+
+        size_t b = bucket_of(req->site_id, req->zone_id);
+        entry->next = buckets[b];
+        buckets[b] = entry;
+
+        printf("Alert started at site %u zone %u (WBGT %.1f)\n", req->site_id, req->zone_id, req->wbgt);
+
+        // 첫 알람이면 경고등 켜기
+        if (active_count++ == 0)
+        {
+            act.led(1);
+        }
+        entry->start_ns = metrics_now_ns();
+        metrics_record(METRIC_WBGT_TO_ALERT, entry->start_ns - req->request_ns);
+        metrics_count(METRIC_ALERTS_STARTED);
+        return;
+    }
+
+    // 이미 울리는 중인 알람은 새로 만들지 않음
+    if (entry->acked)
+    {
+        // 확인 후 최소 시간 안에 다시 초과하면 확인을 취소하고 처음부터 다시 울림
+        entry->acked = 0;
+        entry->min_elapsed = 0;
+        wheel_add(&wheel, &entry->min_timer, ALERT_MIN_MS / ALERT_TICK_MS);
+        wheel_add(&wheel, &entry->escalate_timer, ALERT_ESCALATE_MS / ALERT_TICK_MS);
+    }
+    if (req->wbgt >= entry->wbgt + ALERT_ESCALATE_DELTA)
+    {
+        entry->wbgt = req->wbgt;
+        escalate(entry); // 울리는 중 더 더워지면 즉시 단계 상승
+    }
+}
+
+// 확인 요청을 한 알람에 적용하는 함수
+static void ack_entry(struct alert_entry* entry)
+{
+    if (entry->acked)
+    {
+        return;
+    }
+    entry->acked = 1;
+    wheel_cancel(&wheel, &entry->escalate_timer);
+    if (entry->min_elapsed)
+    {
+        stop_entry(entry);
+    }
+}
+
+// 작업자 확인 요청을 처리하는 함수
+static void handle_ack(const struct alert_request* req)
+{
+    if (req->zone_id != 0)
+    {
+        struct alert_entry* entry = find_entry(req->site_id, req->zone_id);
+        if (entry != NULL)
+        {
+            ack_entry(entry);
+        }
+        return;
+    }
+
+    // 구역 0은 현장 전체 알람에 적용
+    for (size_t b = 0; b < ALERT_BUCKETS; b++)
+    {
+        struct alert_entry* e = buckets[b];
+        while (e != NULL)
+        {
+            struct alert_entry* next = e->next; // ack_entry가 e를 해제할 수 있음
+            if (e->site_id == req->site_id)
+            {
+                ack_entry(e);
+            }
+            e = next;
+        }
+    }
+}
+
+// 사이렌 주파수를 한 단계 바꾸는 함수
+static void siren_step(void)
+{
+    siren_freq += siren_dir * FREQ_STEP * siren_level;
+    if (siren_freq >= MAX_FREQ)
+    {
+        siren_freq = MAX_FREQ;
+        siren_dir = -1;
+    }
+    else if (siren_freq <= MIN_FREQ)
+    {
+        siren_freq = MIN_FREQ;
+        siren_dir = 1;
+    }
+    act.tone(siren_freq);
+}
+
+// 요청을 큐에 넣는 함수 (막히지 않음, 큐가 가득 차면 버리고 wbgt_stage_dropped_total에 셈)
+static void enqueue(int op, uint16_t site_id, uint16_t zone_id, float wbgt)
+{
+    struct alert_request req = {.op = op, .site_id = site_id, .zone_id = zone_id, .wbgt = wbgt, .request_ns = metrics_now_ns()};
+    pipeline_push(&requests, &req);
+}
+
+// 큐에서 꺼낸 요청 하나를 처리하는 함수
+static void handle_request(void* item, void* arg)
+{
+    const struct alert_request* req = item;
+    (void)arg;
+    if (req->op == ALERT_RAISE)
+    {
+        handle_raise(req);
+    }
+    else
+    {
+        handle_ack(req);
+    }
+}
+
+// WBGT 초과 알림 함수
+void alert_raise(uint16_t site_id, uint16_t zone_id, float wbgt)
+{
+    enqueue(ALERT_RAISE, site_id, zone_id, wbgt);
+}
+
+// 작업자 확인 함수
+void alert_ack(uint16_t site_id, uint16_t zone_id)
+{
+    enqueue(ALERT_ACK, site_id, zone_id, 0.0f);
+}
+
+// 알람 스케줄러 쓰레드 시작 함수
+int alert_start(const struct alert_actuators* actuators)
+{
+    pthread_t tid;
+
+    act = *actuators;
+    wheel_init(&wheel, now_tick());
+    if (pipeline_init(&requests, "alert", sizeof(struct alert_request), ALERT_QUEUE_SIZE) == -1)
+    {
+        return -1;
+    }
+
+    if (pthread_create(&tid, NULL, alert_thread, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+// 알람 스케줄러 쓰레드 함수
+static void* alert_thread(void* arg)
+{
+    (void)arg;
+
+    while (1)
+    {
+        pipeline_drain(&requests, handle_request, NULL, ALERT_QUEUE_SIZE);
+
+        // 경과한 시간만큼 타이머 처리 후 사이렌 진행
+        uint64_t tick = now_tick();
+        wheel_advance(&wheel, tick);
+        if (active_count > 0 && tick != siren_tick)
+        {
+            siren_tick = tick;
+            siren_step();
+        }
+
+        if (active_count == 0 && wheel.count == 0)
+        {
+            pipeline_wait(&requests, -1); // 할 일이 없으면 요청이 올 때까지 대기
+        }
+        else
+        {
+            pipeline_wait(&requests, (int)(ALERT_TICK_MS - now_ms() % ALERT_TICK_MS)); // 다음 tick까지 대기 (요청이 오면 바로 깨어남)
+        }
+    }
+    return NULL;
+}
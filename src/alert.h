@@ -0,0 +1,22 @@
+#ifndef ALERT_H
+#define ALERT_H
+
+#include <stdint.h>
+
+// 알람 장치 제어 함수 (알람 스케줄러 쓰레드에서만 호출됨)
+struct alert_actuators
+{
+    void (*tone)(int freq); // 부저 주파수 설정 (0이면 소리 끔)
+    void (*led)(int on); // 경고등 켜기/끄기
+};
+
+// 알람 스케줄러 쓰레드 시작
+int alert_start(const struct alert_actuators* actuators);
+
+// 현장/구역의 WBGT 초과 알림 (이미 울리는 중이면 중복 제거 또는 단계 상승)
+void alert_raise(uint16_t site_id, uint16_t zone_id, float wbgt);
+
+// 작업자 확인 (PIR 감지) - zone_id가 0이면 현장 전체
+void alert_ack(uint16_t site_id, uint16_t zone_id);
+
+#endif
@@ -0,0 +1,221 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "capture.h"
+#include "metrics.h"
+#include "pipeline.h"
+#include "protocol.h"
+
+#define CAPTURE_QUEUE_SIZE 4096 // 수신 쓰레드별 기록 큐 크기
+#define CAPTURE_DRAIN_BATCH 256 // 기록 쓰레드가 생산자마다 한 번에 쓸 최대 레코드 수
+
+// 기록 큐 항목
+struct capture_item
+{
+    struct capture_header header; // 레코드 머리
+    uint8_t payload[CAPTURE_MAX_PAYLOAD]; // payload
+};
+
+static struct pipeline_stage stage; // 기록 큐
+static FILE* out = NULL; // 기록 파일 (기록 쓰레드만 씀)
+static uint64_t start_ns = 0; // 기록 시작 단조 시각
+static uint64_t start_ms = 0; // 기록 시작 시각 (Unix epoch ms)
+
+// 레코드 하나를 파일에 쓰는 함수 (기록 쓰레드)
+static void write_one(void* item, void* arg)
+{
+    const struct capture_item* rec = item;
+    (void)arg;
+    fwrite(&rec->header, sizeof(rec->header), 1, out);
+    fwrite(rec->payload, 1, rec->header.len, out);
+}
+
+// 기록 쓰레드 함수 (쌓인 레코드를 쓰고, 할 일이 없을 때만 파일로 내보냄)
+static void* capture_thread(void* arg)
+{
+    (void)arg;
+    while (1)
+    {
+        if (pipeline_drain(&stage, write_one, NULL, CAPTURE_DRAIN_BATCH) == 0)
+        {
+            fflush(out);
+            pipeline_wait(&stage, -1);
+        }
+    }
+    return NULL;
+}
+
+// 기록 시작 함수
+int capture_open(const char* path)
+{
+    pthread_t tid;
+    struct capture_file_header header;
+
+    out = fopen(path, "wb");
+    if (out == NULL)
+    {
+        perror("Capture file open failed");
+        return -1;
+    }
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.start_ms = start_ms = proto_now_ms();
+    start_ns = metrics_now_ns();
+    if (fwrite(&header, sizeof(header), 1, out) != 1 || pipeline_init(&stage, "capture", sizeof(struct capture_item), CAPTURE_QUEUE_SIZE) == -1)
+    {
+        fclose(out);
+        out = NULL;
+        return -1;
+    }
+    if (pthread_create(&tid, NULL, capture_thread, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        fclose(out);
+        out = NULL;
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+// 기록 중인지 여부 반환 함수
+int capture_enabled(void)
+{
+    return out != NULL;
+}
+
+// 기록 기준 현재 시각 반환 함수
+uint64_t capture_now_ms(void)
+{
+    return start_ms + (metrics_now_ns() - start_ns) / 1000000;
+}
+
+// 레코드 기록 함수
+void capture_add(uint32_t conn_id, uint32_t node_id, uint8_t kind, uint8_t mode, const void* payload, size_t len)
+{
+    struct capture_item item;
+    if (out == NULL)
+    {
+        return;
+    }
+    if (len > CAPTURE_MAX_PAYLOAD)
+    {
+        len = CAPTURE_MAX_PAYLOAD;
+    }
+    memset(&item.header, 0, sizeof(item.header));
+    item.header.offset_ns = metrics_now_ns() - start_ns;
+    item.header.conn_id = conn_id;
+    item.header.node_id = node_id;
+    item.header.kind = kind;
+    item.header.mode = mode;
+    item.header.len = (uint16_t)len;
+    memcpy(item.payload, payload, len);
+    pipeline_push(&stage, &item);
+}
+
+// 레코드를 시각순으로 정렬하는 비교 함수 (같은 시각이면 파일 순서 유지)
+static int compare_records(const void* a, const void* b)
+{
+    const struct capture_record* x = a;
+    const struct capture_record* y = b;
+    if (x->header.offset_ns != y->header.offset_ns)
+    {
+        return x->header.offset_ns < y->header.offset_ns ? -1 : 1;
+    }
+    return x->payload < y->payload ? -1 : (x->payload > y->payload);
+}
+
+// 기록 파일 읽기 함수
+int capture_load(const char* path, struct capture_log* log)
+{
+    struct stat st;
+    memset(log, 0, sizeof(*log));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror("Capture file open failed");
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(struct capture_file_header))
+    {
+        fprintf(stderr, "Capture file is too short\n");
+        close(fd);
+        return -1;
+    }
+    log->map_len = st.st_size;
+    log->map = mmap(NULL, log->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (log->map == MAP_FAILED)
+    {
+        perror("Capture file mmap failed");
+        log->map = NULL;
+        return -1;
+    }
+
+    const struct capture_file_header* header = log->map;
+    if (memcmp(header->magic, CAPTURE_MAGIC, sizeof(header->magic)) != 0 || header->version != CAPTURE_VERSION)
+    {
+        fprintf(stderr, "Not a capture file (or unsupported version)\n");
+        capture_free(log);
+        return -1;
+    }
+    log->start_ms = header->start_ms;
+
+    // 레코드 수를 세고 위치를 모음 (기록 중 종료되어 잘린 마지막 레코드는 버림)
+    const uint8_t* base = log->map;
+    size_t capacity = 1024;
+    log->records = malloc(capacity * sizeof(*log->records));
+    for (size_t pos = sizeof(*header); log->records != NULL && pos + sizeof(struct capture_header) <= log->map_len;)
+    {
+        struct capture_header h;
+        memcpy(&h, base + pos, sizeof(h));
+        if (h.len > CAPTURE_MAX_PAYLOAD || pos + sizeof(h) + h.len > log->map_len)
+        {
+            fprintf(stderr, "Capture file truncated after %zu records\n", log->count);
+            break;
+        }
+        if (log->count == capacity)
+        {
+            capacity *= 2;
+            struct capture_record* grown = realloc(log->records, capacity * sizeof(*log->records));
+            if (grown == NULL)
+            {
+                break;
+            }
+            log->records = grown;
+        }
+        log->records[log->count].header = h;
+        log->records[log->count].payload = base + pos + sizeof(h);
+        log->count++;
+        pos += sizeof(h) + h.len;
+    }
+    if (log->records == NULL)
+    {
+        perror("malloc failed");
+        capture_free(log);
+        return -1;
+    }
+    qsort(log->records, log->count, sizeof(*log->records), compare_records);
+    return 0;
+}
+
+// 읽어 들인 기록 해제 함수
+void capture_free(struct capture_log* log)
+{
+    free(log->records);
+    if (log->map != NULL)
+    {
+        munmap(log->map, log->map_len);
+    }
+    memset(log, 0, sizeof(*log));
+}
@@ -0,0 +1,93 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 수신 스트림 기록 파일 (재현 및 성능 측정용)
+ * 파일 머리 뒤에 레코드가 이어짐: 고정 크기 머리(struct capture_header) + payload
+ * - CAPTURE_FRAME: 받은 바이너리 프레임 원본
+ * - CAPTURE_TEXT: 받은 텍스트 메시지 (종료 문자 없음)
+ * - CAPTURE_DECISION: 그때 내린 WBGT 판정 (struct capture_decision, 재생 결과 검증용)
+ * 시각은 기록 시작부터의 단조 시계 ns, 레코드는 수신 쓰레드별 순서로 기록되므로 읽을 때 시각순으로 정렬함
+ * 기록은 수신 쓰레드마다 락 없는 큐(pipeline.h)에 넣고 별도 쓰레드가 파일에 씀 (가득 차면 버림)
+ */
+#define CAPTURE_MAGIC "WCAP" // 파일 식별자
+#define CAPTURE_VERSION 2 // 파일 형식 버전 (2: 판정에 측정점 시각 추가)
+#define CAPTURE_MAX_PAYLOAD 300 // 레코드 payload 최대 크기 (최대 프레임보다 큼, 더 긴 텍스트는 잘림)
+
+// 레코드 종류
+enum capture_kind
+{
+    CAPTURE_FRAME = 1, // 바이너리 프레임
+    CAPTURE_TEXT = 2, // 텍스트 메시지
+    CAPTURE_DECISION = 3 // WBGT 판정
+};
+
+// 파일 머리
+struct capture_file_header
+{
+    char magic[4]; // CAPTURE_MAGIC
+    uint32_t version; // CAPTURE_VERSION
+    uint64_t start_ms; // 기록 시작 시각 (Unix epoch ms, 재생 시 서버 시계 기준)
+};
+
+// 레코드 머리
+struct capture_header
+{
+    uint64_t offset_ns; // 기록 시작부터의 시간
+    uint32_t conn_id; // 메시지를 받은 연결 번호 (재생 시 같은 번호끼리 연결 상태를 공유)
+    uint32_t node_id; // 기록 당시 연결에 등록된 노드 ID (등록 전이면 0)
+    uint8_t kind; // 레코드 종류 (enum capture_kind)
+    uint8_t mode; // 연결 형식 (서버의 enum conn_mode)
+    uint16_t len; // payload 길이
+    uint32_t reserved;
+};
+
+// 판정 레코드 payload
+struct capture_decision
+{
+    uint16_t site_id; // 현장 ID
+    uint16_t zone_id; // 구역 ID
+    float wbgt; // 계산한 WBGT
+    int32_t decision; // 0 임계치 이하, 1 알람 요청
+    uint64_t tick_ms; // 판정한 측정점 시각 (융합 tick, 엣지 보고는 수신 시각, 재생 판정과 짝을 맞추는 키)
+};
+
+// 읽어 들인 레코드 (payload는 mmap한 파일을 가리킴)
+struct capture_record
+{
+    struct capture_header header; // 레코드 머리
+    const uint8_t* payload; // payload
+};
+
+// 읽어 들인 기록 파일
+struct capture_log
+{
+    uint64_t start_ms; // 기록 시작 시각
+    size_t count; // 레코드 수
+    struct capture_record* records; // 시각순으로 정렬된 레코드
+    void* map; // mmap한 파일
+    size_t map_len; // mmap 크기
+};
+
+// 기록 시작 (파일을 새로 만들고 기록 쓰레드 시작)
+int capture_open(const char* path);
+
+// 기록 중인지 여부
+int capture_enabled(void);
+
+// 기록 기준 현재 시각 (기록 시작 시각 + 단조 경과 시간, 재생 시계와 같은 기준)
+uint64_t capture_now_ms(void);
+
+// 레코드 하나 기록 (막히지 않음)
+void capture_add(uint32_t conn_id, uint32_t node_id, uint8_t kind, uint8_t mode, const void* payload, size_t len);
+
+// 기록 파일 읽기 (손상된 꼬리는 버림)
+int capture_load(const char* path, struct capture_log* log);
+
+// 읽어 들인 기록 해제
+void capture_free(struct capture_log* log);
+
+#endif
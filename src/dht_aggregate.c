@@ -0,0 +1,142 @@
+#include <string.h>
+#include <math.h>
+#include "dht_aggregate.h"
+
+// 집계기 초기화 함수
+void dht_aggregate_init(struct dht_aggregate* agg, uint32_t report_ms, float alpha, float change_temp, float change_humidity)
+{
+    memset(agg, 0, sizeof(*agg));
+    if (alpha <= 0.0f || alpha > 1.0f)
+    {
+        alpha = 0.2f;
+    }
+    agg->alpha = alpha;
+    agg->change_temp = change_temp;
+    agg->change_humidity = change_humidity;
+    agg->report_ms = report_ms;
+}
+
+// 주기 전송 간격 변경 함수
+void dht_aggregate_set_report(struct dht_aggregate* agg, uint32_t report_ms, uint64_t now_ms)
+{
+    agg->report_ms = report_ms;
+    if (agg->samples > 0 && now_ms + report_ms < agg->next_report_ms)
+    {
+        agg->next_report_ms = now_ms + report_ms;
+    }
+}
+
+// 창에 샘플 하나를 넣는 함수 (index는 샘플 번호)
+static void series_push(struct dht_series* s, uint32_t index, float value)
+{
+    // 창을 벗어난 샘플은 최소/최대 후보에서 제거 (가장 오래된 후보가 항상 맨 앞)
+    if (s->min_count > 0 && s->min_queue[s->min_head] + DHT_WINDOW <= index)
+    {
+        s->min_head = (s->min_head + 1) % DHT_WINDOW;
+        s->min_count--;
+    }
+    if (s->max_count > 0 && s->max_queue[s->max_head] + DHT_WINDOW <= index)
+    {
+        s->max_head = (s->max_head + 1) % DHT_WINDOW;
+        s->max_count--;
+    }
+
+    // 링에서 가장 오래된 샘플을 새 샘플로 바꾸고 합계 갱신
+    uint32_t slot = index % DHT_WINDOW;
+    if (index >= DHT_WINDOW)
+    {
+        s->sum -= s->values[slot];
+    }
+    s->values[slot] = value;
+    s->sum += value;
+
+    // 새 샘플보다 크거나 같은 최소 후보는 창에서 먼저 빠지므로 다시 최소가 될 수 없음
+    while (s->min_count > 0 && s->values[s->min_queue[(s->min_head + s->min_count - 1) % DHT_WINDOW] % DHT_WINDOW] >= value)
+    {
+        s->min_count--;
+    }
+    s->min_queue[(s->min_head + s->min_count) % DHT_WINDOW] = index;
+    s->min_count++;
+
+    // 최대 후보도 같은 방식
+    while (s->max_count > 0 && s->values[s->max_queue[(s->max_head + s->max_count - 1) % DHT_WINDOW] % DHT_WINDOW] <= value)
+    {
+        s->max_count--;
+    }
+    s->max_queue[(s->max_head + s->max_count) % DHT_WINDOW] = index;
+    s->max_count++;
+}
+
+// 창의 최소값
+static float series_min(const struct dht_series* s)
+{
+    return s->values[s->min_queue[s->min_head] % DHT_WINDOW];
+}
+
+// 창의 최대값
+static float series_max(const struct dht_series* s)
+{
+    return s->values[s->max_queue[s->max_head] % DHT_WINDOW];
+}
+
+// 집계 결과 채우기 (보낼 값은 호출한 쪽에서 정함)
+static void fill_summary(const struct dht_aggregate* agg, struct dht_summary* out)
+{
+    out->count = agg->samples < DHT_WINDOW ? agg->samples : DHT_WINDOW;
+    out->temperature = (float)(agg->temp.sum / out->count);
+    out->humidity = (float)(agg->humidity.sum / out->count);
+    out->temp_min = series_min(&agg->temp);
+    out->temp_max = series_max(&agg->temp);
+    out->temp_ewma = agg->temp.ewma;
+    out->humidity_min = series_min(&agg->humidity);
+    out->humidity_max = series_max(&agg->humidity);
+    out->humidity_ewma = agg->humidity.ewma;
+}
+
+// 샘플 입력 함수
+int dht_aggregate_push(struct dht_aggregate* agg, float temperature, float humidity, uint64_t now_ms, struct dht_summary* out)
+{
+    uint32_t index = agg->samples++;
+    series_push(&agg->temp, index, temperature);
+    series_push(&agg->humidity, index, humidity);
+
+    // 첫 샘플은 EWMA의 시작값이 되고 첫 주기 전송 시각을 정함
+    if (index == 0)
+    {
+        agg->temp.ewma = temperature;
+        agg->humidity.ewma = humidity;
+        agg->next_report_ms = now_ms + agg->report_ms;
+        return DHT_EMIT_NONE;
+    }
+
+    // 기준선(EWMA)에서 크게 벗어나면 바로 보냄
+    int changed = (agg->change_temp > 0.0f && fabsf(temperature - agg->temp.ewma) >= agg->change_temp) ||
+                  (agg->change_humidity > 0.0f && fabsf(humidity - agg->humidity.ewma) >= agg->change_humidity);
+    if (changed)
+    {
+        // 방금 샘플을 새 기준선으로 삼고, 방금 보냈으므로 주기 전송은 뒤로 미룸
+        agg->temp.ewma = temperature;
+        agg->humidity.ewma = humidity;
+        agg->next_report_ms = now_ms + agg->report_ms;
+        agg->changes++;
+        fill_summary(agg, out);
+        out->temperature = temperature;
+        out->humidity = humidity;
+        return DHT_EMIT_CHANGE;
+    }
+    agg->temp.ewma += agg->alpha * (temperature - agg->temp.ewma);
+    agg->humidity.ewma += agg->alpha * (humidity - agg->humidity.ewma);
+
+    // 주기 전송 (오래 멈춰 있었으면 밀린 주기는 건너뜀)
+    if (now_ms < agg->next_report_ms)
+    {
+        return DHT_EMIT_NONE;
+    }
+    agg->next_report_ms += agg->report_ms;
+    if (agg->next_report_ms <= now_ms)
+    {
+        agg->next_report_ms = now_ms + agg->report_ms;
+    }
+    fill_summary(agg, out);
+    return DHT_EMIT_PERIODIC;
+}
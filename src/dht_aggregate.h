@@ -0,0 +1,72 @@
+#ifndef DHT_AGGREGATE_H
+#define DHT_AGGREGATE_H
+
+#include <stdint.h>
+
+/*
+ * DHT11 측정값 스트리밍 집계기
+ * 최근 DHT_WINDOW개 샘플을 고정 크기 링에 두고 샘플마다 O(1)로 다음 값을 갱신함
+ *  - 평균: 링에 들어오고 나가는 값으로 합계를 갱신
+ *  - 최소/최대: 단조 큐(창 안에서 더 나중에 들어온 더 작은/큰 값에 밀린 샘플은 버림), 분할 상환 O(1)
+ *  - EWMA: 느린 변화를 따라가는 기준선 (dht_aggregate_init의 alpha)
+ * 전송 시점
+ *  - 정해진 주기(report_ms)마다 창 평균을 보냄
+ *  - 새 샘플이 EWMA에서 기준값(change_temp/change_humidity) 이상 벗어나면 주기를 기다리지 않고 그 샘플을 바로 보냄
+ *    (EWMA가 천천히 따라가므로 빠른 변화만 걸림, 보낸 뒤에는 EWMA를 그 샘플로 다시 맞춰 같은 변화로 반복 전송하지 않음)
+ */
+#define DHT_WINDOW 10 // 창 크기 (기존 10회 평균과 같음)
+
+// 전송 이유
+enum dht_emit
+{
+    DHT_EMIT_NONE = 0, // 보내지 않음
+    DHT_EMIT_PERIODIC = 1, // 주기 전송 (창 평균)
+    DHT_EMIT_CHANGE = 2 // 빠른 변화 (방금 샘플)
+};
+
+// 값 하나(온도 또는 습도)의 창 통계
+struct dht_series
+{
+    float values[DHT_WINDOW]; // 창 안의 샘플 (링)
+    double sum; // 창 안의 합계
+    uint32_t min_queue[DHT_WINDOW]; // 최소값 후보의 샘플 번호 (값이 증가하는 순서)
+    uint32_t max_queue[DHT_WINDOW]; // 최대값 후보의 샘플 번호 (값이 감소하는 순서)
+    uint32_t min_head, min_count; // 최소 큐의 시작 위치와 개수
+    uint32_t max_head, max_count; // 최대 큐의 시작 위치와 개수
+    float ewma; // 지수 이동 평균
+};
+
+// 집계 결과
+struct dht_summary
+{
+    float temperature; // 보낼 온도 (주기 전송이면 창 평균, 변화 전송이면 방금 샘플)
+    float humidity; // 보낼 습도
+    float temp_min, temp_max, temp_ewma; // 창 안의 온도 최소/최대와 EWMA
+    float humidity_min, humidity_max, humidity_ewma; // 창 안의 습도 최소/최대와 EWMA
+    uint32_t count; // 창 안의 샘플 수
+};
+
+// 집계기 상태
+struct dht_aggregate
+{
+    struct dht_series temp; // 온도
+    struct dht_series humidity; // 습도
+    uint32_t samples; // 지금까지 받은 샘플 수 (다음 샘플 번호)
+    float alpha; // EWMA 가중치 (0 ~ 1, 클수록 빨리 따라감)
+    float change_temp; // 바로 보낼 온도 변화 기준 (C)
+    float change_humidity; // 바로 보낼 습도 변화 기준 (%)
+    uint32_t report_ms; // 주기 전송 간격
+    uint64_t next_report_ms; // 다음 주기 전송 시각 (단조 시계, 첫 샘플 기준으로 정함)
+    uint64_t changes; // 빠른 변화로 보낸 횟수
+};
+
+// 집계기 초기화
+void dht_aggregate_init(struct dht_aggregate* agg, uint32_t report_ms, float alpha, float change_temp, float change_humidity);
+
+// 주기 전송 간격 변경 (더 짧아지면 다음 전송도 그만큼 앞당김, now_ms는 dht_aggregate_push와 같은 단조 시계)
+void dht_aggregate_set_report(struct dht_aggregate* agg, uint32_t report_ms, uint64_t now_ms);
+
+// 샘플 하나 입력 (now_ms는 전송 주기를 셀 단조 시계 시각, 프레임 시각은 호출한 쪽에서 따로 정함, 보내야 하면 *out을 채우고 enum dht_emit 반환)
+int dht_aggregate_push(struct dht_aggregate* agg, float temperature, float humidity, uint64_t now_ms, struct dht_summary* out);
+
+#endif
@@ -0,0 +1,96 @@
+#include "dht_decode.h"
+
+#define MAX_HIGH_NS 150000 // 비트 HIGH 구간 최대 길이 (규격 70us에 여유)
+#define MAX_LOW_NS 150000 // 비트 LOW 구간 최대 길이 (규격 50us에 여유)
+#define MIN_SPREAD_NS 20000 // 0과 1이 섞여 있다고 볼 최소 길이 차이
+
+// 에지 목록 디코드 함수
+int dht_decode(const struct gpio_event* edges, size_t count, struct dht_reading* out)
+{
+    uint32_t high[DHT_MAX_EDGES]; // HIGH 구간 길이 (ns)
+    uint64_t low_sum = 0; // 비트 LOW 구간 길이 합
+    size_t highs = 0, lows = 0;
+
+    // HIGH 구간(상승 -> 하강)과 LOW 구간(하강 -> 상승) 길이 측정
+    for (size_t i = 1; i < count && highs < DHT_MAX_EDGES; i++)
+    {
+        uint64_t width = edges[i].timestamp_ns - edges[i - 1].timestamp_ns;
+        if (edges[i - 1].value == 1 && edges[i].value == 0)
+        {
+            high[highs++] = width > UINT32_MAX ? UINT32_MAX : (uint32_t)width;
+        }
+        else if (edges[i - 1].value == 0 && edges[i].value == 1 && highs > 0 && width <= MAX_LOW_NS)
+        {
+            low_sum += width; // 응답 시작(80us) 이후의 LOW 구간만 비트 LOW로 봄
+            lows++;
+        }
+    }
+    if (highs < DHT_BITS)
+    {
+        return DHT_TOO_FEW_EDGES;
+    }
+
+    // 마지막 40개가 데이터 비트
+    const uint32_t* bits = high + highs - DHT_BITS;
+    uint32_t min = UINT32_MAX, max = 0;
+    for (int i = 0; i < DHT_BITS; i++)
+    {
+        if (bits[i] > MAX_HIGH_NS)
+        {
+            return DHT_BAD_TIMING;
+        }
+        min = bits[i] < min ? bits[i] : min;
+        max = bits[i] > max ? bits[i] : max;
+    }
+
+    // 비트 판정 기준 결정
+    uint32_t threshold;
+    if (max - min >= MIN_SPREAD_NS)
+    {
+        threshold = (min + max) / 2; // 0과 1이 모두 있으면 두 길이의 중간
+    }
+    else if (lows > 0)
+    {
+        threshold = low_sum / lows; // 모두 같은 값이면 LOW 구간(50us)과 비교
+    }
+    else
+    {
+        return DHT_BAD_TIMING;
+    }
+
+    // 비트를 바이트로 조립
+    for (int i = 0; i < 5; i++)
+    {
+        out->raw[i] = 0;
+    }
+    for (int i = 0; i < DHT_BITS; i++)
+    {
+        out->raw[i / 8] |= (bits[i] > threshold) << (7 - i % 8);
+    }
+
+    if (out->raw[4] != ((out->raw[0] + out->raw[1] + out->raw[2] + out->raw[3]) & 0xFF))
+    {
+        return DHT_BAD_CHECKSUM;
+    }
+    out->humidity = out->raw[0] + out->raw[1] * 0.1f;
+    out->temperature = out->raw[2] + out->raw[3] * 0.1f;
+    return DHT_OK;
+}
+
+// 결과 코드 설명 반환 함수
+const char* dht_status_name(int status)
+{
+    switch (status)
+    {
+    case DHT_OK:
+        return "ok";
+    case DHT_TOO_FEW_EDGES:
+        return "too few edges";
+    case DHT_BAD_TIMING:
+        return "bad timing";
+    case DHT_BAD_CHECKSUM:
+        return "bad checksum";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DHT_DECODE_H
+#define DHT_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gpio.h"
+
+/*
+ * DHT11 응답 디코더
+ * 커널이 시각을 기록한 에지 목록만으로 40비트를 복원하는 순수 함수라서
+ * 기록해 둔 에지 파일을 다른 PC에서 그대로 재생하거나 벤치마크할 수 있음
+ *
+ * DHT11 응답: 80us LOW, 80us HIGH 후 비트마다 50us LOW + HIGH(0: 26~28us, 1: 70us)
+ * HIGH 구간(상승 -> 하강 에지) 길이 중 마지막 40개를 비트로 사용하므로 앞부분 에지를 놓쳐도 됨
+ * 비트 판정 기준은 고정값이 아니라 이번 응답의 HIGH 길이 분포(짧은 쪽과 긴 쪽의 중간)로 정하고,
+ * 모든 비트가 같은 값이라 분포가 한쪽뿐이면 같은 응답의 LOW 구간 평균(약 50us)을 기준으로 삼음
+ */
+#define DHT_MAX_EDGES 128 // 한 번의 응답에서 기록할 최대 에지 수 (정상 응답은 약 84개)
+#define DHT_BITS 40 // 응답 비트 수
+
+// 디코드 결과
+enum dht_status
+{
+    DHT_OK = 0, // 성공
+    DHT_TOO_FEW_EDGES = -1, // 에지가 부족함 (응답 없음 또는 중간에 끊김)
+    DHT_BAD_TIMING = -2, // 펄스 길이가 규격을 벗어남
+    DHT_BAD_CHECKSUM = -3 // 체크섬 불일치
+};
+
+// 디코드된 측정값
+struct dht_reading
+{
+    uint8_t raw[5]; // 습도 정수, 습도 소수, 온도 정수, 온도 소수, 체크섬
+    float humidity; // 습도 (%)
+    float temperature; // 온도 (C)
+};
+
+// 에지 목록을 디코드 (edges는 시간 순서, 반환값은 enum dht_status)
+int dht_decode(const struct gpio_event* edges, size_t count, struct dht_reading* out);
+
+// 결과 코드 설명
+const char* dht_status_name(int status);
+
+#endif
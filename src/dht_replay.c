@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dht_decode.h"
+#include "dht_sensor.h"
+
+#define LINE_SIZE 8192 // 기록 파일 한 줄 최대 길이
+#define BENCH_ROUNDS 1000 // 벤치마크 반복 횟수
+#define REPLAY_PIN 2 // 가짜 backend에서 쓸 데이터 라인 번호 (실제 GPIO는 건드리지 않음)
+
+// 기록 파일 한 줄을 에지 목록으로 바꾸는 함수
+static size_t parse_line(char* line, struct gpio_event* edges)
+{
+    size_t count = 0;
+    for (char* tok = strtok(line, " \n"); tok != NULL && count < DHT_MAX_EDGES; tok = strtok(NULL, " \n"))
+    {
+        int value;
+        unsigned long long ts;
+        if (sscanf(tok, "%d:%llu", &value, &ts) == 2)
+        {
+            edges[count].offset = 0;
+            edges[count].value = value;
+            edges[count].timestamp_ns = ts;
+            count++;
+        }
+    }
+    return count;
+}
+
+// 기록된 에지를 가짜 GPIO backend에 주입해 dht_sensor 수집 경로로 디코드하는 함수
+// (시작 신호, 에지 감지 전환, 이벤트 읽기까지 실제 측정과 같은 순서로 거침)
+static int sensor_decode(struct dht_sensor* sensor, const struct gpio_event* edges, size_t count, struct dht_reading* reading)
+{
+    dht_sensor_start(sensor);
+    if (count > 0)
+    {
+        gpio_fake_inject(&sensor->line, 0, !edges[0].value, 0); // 에지 감지 전이므로 이벤트 없이 첫 에지 직전 값으로 맞춤
+    }
+    dht_sensor_listen(sensor);
+    for (size_t i = 0; i < count; i++)
+    {
+        gpio_fake_inject(&sensor->line, 0, edges[i].value, edges[i].timestamp_ns);
+    }
+    while (gpio_wait_event(&sensor->line, 0) > 0 && dht_sensor_collect(sensor) > 0)
+    {
+    }
+    return dht_sensor_finish(sensor, reading);
+}
+
+// DHT11 에지 기록 재생 도구 (DHT11_TRACE로 저장한 파일을 디코드하고 속도를 측정)
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+    FILE* f = fopen(argv[1], "r");
+    if (f == NULL)
+    {
+        perror("Trace file open failed");
+        return 1;
+    }
+
+    static struct gpio_event edges[4096][DHT_MAX_EDGES]; // 벤치마크용으로 모두 메모리에 보관
+    static size_t counts[4096];
+    static char line[LINE_SIZE];
+    int results[4] = {0, 0, 0, 0}; // 결과 코드별 개수
+    size_t traces = 0;
+    size_t sensor_mismatch = 0; // 수집 경로를 거친 결과가 직접 디코드와 다른 기록 수
+
+    // 수집 경로는 가짜 backend로 재생 (GPIO가 없는 PC에서도 동작)
+    struct dht_sensor sensor;
+    gpio_set_backend(&gpio_fake_ops);
+    if (dht_sensor_open(&sensor, REPLAY_PIN, NULL) == -1)
+    {
+        fprintf(stderr, "Fake GPIO backend initialization failed\n");
+        fclose(f);
+        return 1;
+    }
+
+    while (traces < 4096 && fgets(line, sizeof(line), f) != NULL)
+    {
+        struct dht_reading reading;
+        counts[traces] = parse_line(line, edges[traces]);
+        int status = dht_decode(edges[traces], counts[traces], &reading);
+        results[-status]++;
+
+        // 같은 기록을 수집 경로로 디코드해 결과 비교
+        struct dht_reading via_sensor;
+        int sensor_status = sensor_decode(&sensor, edges[traces], counts[traces], &via_sensor);
+        if (sensor_status != status || (status == DHT_OK && memcmp(via_sensor.raw, reading.raw, sizeof(reading.raw)) != 0))
+        {
+            printf("%zu: sensor path gave %s\n", traces, dht_status_name(sensor_status));
+            sensor_mismatch++;
+        }
+        if (status == DHT_OK)
+        {
+            printf("%zu: humidity %.1f%%, temperature %.1fC\n", traces, reading.humidity, reading.temperature);
+        }
+        else
+        {
+            printf("%zu: %s (%zu edges)\n", traces, dht_status_name(status), counts[traces]);
+        }
+        traces++;
+    }
+    fclose(f);
+    dht_sensor_close(&sensor);
+    if (traces == 0)
+    {
+        return 0;
+    }
+
+    // 디코드 속도 측정
+    struct timespec t0, t1;
+    struct dht_reading reading;
+    volatile int sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (size_t i = 0; i < traces; i++)
+        {
+            sink += dht_decode(edges[i], counts[i], &reading);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)BENCH_ROUNDS * traces);
+
+    printf("%zu traces: %d ok, %d too few edges, %d bad timing, %d bad checksum; %.0f ns per decode\n", traces, results[0], results[1], results[2], results[3], ns);
+    printf("Sensor path (fake GPIO backend): %zu of %zu traces decoded the same\n", traces - sensor_mismatch, traces);
+    return sensor_mismatch == 0 ? 0 : 2;
+}
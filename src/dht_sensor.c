@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include "dht_sensor.h"
+
+// 데이터 라인 요청 함수
+int dht_sensor_open(struct dht_sensor* sensor, unsigned int pin, const char* trace_path)
+{
+    sensor->trace = NULL;
+    sensor->count = 0;
+    if (gpio_request(&sensor->line, GPIO_CHIP, &pin, 1, GPIO_INPUT, DHT_MAX_EDGES, "dht11") == -1)
+    {
+        return -1;
+    }
+
+    // 기록된 에지를 나중에 dht_replay로 재생할 수 있도록 저장
+    if (trace_path != NULL && (sensor->trace = fopen(trace_path, "a")) == NULL)
+    {
+        perror("Trace file open failed");
+    }
+    return 0;
+}
+
+// 시작 신호 함수
+void dht_sensor_start(struct dht_sensor* sensor)
+{
+    struct gpio_event stale[16];
+
+    // 이전 측정에서 남은 이벤트 비우기
+    while (gpio_wait_event(&sensor->line, 0) > 0 && gpio_read_events(&sensor->line, stale, 16) > 0)
+    {
+    }
+    sensor->count = 0;
+
+    // DHT11은 PIN을 LOW로 18ms 유지하면 데이터 요청 신호로 인식
+    gpio_reconfigure(&sensor->line, GPIO_OUTPUT);
+    gpio_write(&sensor->line, 0, 0);
+}
+
+// 에지 수집 시작 함수
+void dht_sensor_listen(struct dht_sensor* sensor)
+{
+    // 라인을 놓으면 풀업으로 HIGH가 되고 센서가 응답하므로 바로 입력 + 양쪽 에지 감지로 전환
+    // (이후 에지 시각은 커널이 인터럽트에서 기록하므로 이 쓰레드의 스케줄링 지연과 무관함)
+    gpio_reconfigure(&sensor->line, GPIO_INPUT | GPIO_EDGE_BOTH);
+}
+
+// 도착한 에지를 읽는 함수
+int dht_sensor_collect(struct dht_sensor* sensor)
+{
+    if (sensor->count >= DHT_MAX_EDGES)
+    {
+        return 0;
+    }
+    int n = gpio_read_events(&sensor->line, sensor->edges + sensor->count, DHT_MAX_EDGES - sensor->count);
+    if (n <= 0)
+    {
+        return 0;
+    }
+    sensor->count += n;
+    return n;
+}
+
+// 센서 응답 에지를 수집하는 함수 (대기 중에는 CPU를 쓰지 않음, 수집한 에지 수 반환)
+static size_t capture_edges(struct dht_sensor* sensor)
+{
+    dht_sensor_start(sensor);
+    usleep(DHT_START_MS * 1000);
+    dht_sensor_listen(sensor);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (sensor->count < DHT_MAX_EDGES)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+
+        // 비트 에지를 다 받았으면 짧게만 기다려 응답이 끝났는지 확인
+        int timeout_ms = (sensor->count >= 2 * DHT_BITS) ? 1 : DHT_RESPONSE_TIMEOUT_MS - elapsed_ms;
+        if (timeout_ms <= 0 || gpio_wait_event(&sensor->line, timeout_ms) <= 0 || dht_sensor_collect(sensor) == 0)
+        {
+            break;
+        }
+    }
+    return sensor->count;
+}
+
+// 수집한 에지를 기록 파일에 남기는 함수 (한 줄에 한 번의 응답, "값:시각ns" 목록)
+static void record_trace(struct dht_sensor* sensor, const struct gpio_event* edges, size_t count)
+{
+    if (sensor->trace == NULL)
+    {
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        fprintf(sensor->trace, "%s%d:%llu", i ? " " : "", edges[i].value, (unsigned long long)edges[i].timestamp_ns);
+    }
+    fprintf(sensor->trace, "\n");
+    fflush(sensor->trace);
+}
+
+// 수집한 에지를 기록하고 디코드하는 함수
+int dht_sensor_finish(struct dht_sensor* sensor, struct dht_reading* reading)
+{
+    record_trace(sensor, sensor->edges, sensor->count);
+    return dht_decode(sensor->edges, sensor->count, reading);
+}
+
+// 측정값 하나를 읽는 함수 (실패하면 센서 최소 측정 간격을 두고 재시도)
+int dht_sensor_read(struct dht_sensor* sensor, struct dht_reading* reading)
+{
+    int status = DHT_TOO_FEW_EDGES;
+
+    for (int attempt = 0; attempt < DHT_RETRIES; attempt++)
+    {
+        if (attempt > 0)
+        {
+            usleep(DHT_RETRY_DELAY_MS * 1000);
+        }
+        size_t count = capture_edges(sensor);
+        status = dht_sensor_finish(sensor, reading);
+        if (status == DHT_OK)
+        {
+            break;
+        }
+        printf("DHT11 read failed (%s, %zu edges), attempt %d/%d\n", dht_status_name(status), count, attempt + 1, DHT_RETRIES);
+    }
+    return status;
+}
+
+// 라인과 기록 파일 반납 함수
+void dht_sensor_close(struct dht_sensor* sensor)
+{
+    gpio_release(&sensor->line);
+    if (sensor->trace != NULL)
+    {
+        fclose(sensor->trace);
+        sensor->trace = NULL;
+    }
+}
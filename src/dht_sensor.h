@@ -0,0 +1,52 @@
+#ifndef DHT_SENSOR_H
+#define DHT_SENSOR_H
+
+#include <stdio.h>
+#include "gpio.h"
+#include "dht_decode.h"
+
+/*
+ * DHT11 센서 읽기 (GPIO 라인 요청, 시작 신호, 에지 수집, 디코드, 재시도)
+ * 시작 신호를 보낸 뒤에는 커널이 기록한 에지 시각만으로 디코드하므로 바쁜 대기가 없음
+ * 한 번 읽는 데 약 25ms, 실패하면 DHT11 최소 측정 간격(1초)을 두고 최대 DHT_RETRIES번 시도
+ * trace_path를 주면 수집한 에지를 기록해 두었다가 dht_replay로 재생할 수 있음
+ * 이벤트 루프에서는 같은 과정을 나눠 부르면 기다리는 동안 다른 센서를 처리할 수 있음
+ *  dht_sensor_start -> DHT_START_MS 뒤 dht_sensor_listen -> 라인 fd가 읽을 수 있을 때마다 dht_sensor_collect
+ *  -> DHT_RESPONSE_TIMEOUT_MS가 지나거나 에지 버퍼가 차면 dht_sensor_finish (실패하면 DHT_RETRY_DELAY_MS 뒤 다시 시작)
+ */
+#define DHT_RETRIES 3 // 한 측정에서 시도할 최대 횟수
+#define DHT_START_MS 18 // 시작 신호 LOW 유지 시간
+#define DHT_RESPONSE_TIMEOUT_MS 10 // 응답 에지를 기다리는 최대 시간 (정상 응답은 약 5ms)
+#define DHT_RETRY_DELAY_MS 1100 // 재시도 간격 (DHT11 최소 측정 간격 1초)
+
+// 센서 하나의 상태
+struct dht_sensor
+{
+    struct gpio_lines line; // DHT11 데이터 라인 (한 번 요청해 방향만 바꿔 가며 사용)
+    FILE* trace; // 에지 기록 파일 (NULL이면 기록하지 않음)
+    struct gpio_event edges[DHT_MAX_EDGES]; // 이번 응답에서 수집한 에지
+    size_t count; // 수집한 에지 수
+};
+
+// 데이터 라인 요청 (trace_path가 NULL이면 기록하지 않음, 실패 시 -1)
+int dht_sensor_open(struct dht_sensor* sensor, unsigned int pin, const char* trace_path);
+
+// 측정값 하나 읽기 (재시도 포함, 반환값은 enum dht_status)
+int dht_sensor_read(struct dht_sensor* sensor, struct dht_reading* reading);
+
+// 이전 이벤트를 비우고 시작 신호(LOW)를 내보냄
+void dht_sensor_start(struct dht_sensor* sensor);
+
+// 라인을 놓고 에지 수집 시작 (라인 fd로 에지 이벤트가 옴)
+void dht_sensor_listen(struct dht_sensor* sensor);
+
+// 도착한 에지 읽기 (새로 읽은 에지 수 반환, 버퍼가 차면 count가 DHT_MAX_EDGES)
+int dht_sensor_collect(struct dht_sensor* sensor);
+
+// 수집한 에지를 기록하고 디코드 (반환값은 enum dht_status)
+int dht_sensor_finish(struct dht_sensor* sensor, struct dht_reading* reading);
+
+// 라인과 기록 파일 반납
+void dht_sensor_close(struct dht_sensor* sensor);
+
+#endif
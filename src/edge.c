@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include "protocol.h"
+#include "dht_sensor.h"
+#include "adc.h"
+#include "wbgt.h"
+#include "edge_wbgt.h"
+#include "transport.h"
+
+#define PIN 2 // PIN number for DHT11
+#define DEVICE "/dev/spidev0.0" // SPI 장치 파일 경로
+
+// 측정 설정
+#define EDGE_SAMPLE_MS 2000 // 기본 측정 간격 (EDGE_SAMPLE_MS로 변경, DHT11 최소 측정 간격 1초)
+#define EDGE_SUMMARY_MS 60000 // 기본 요약 전송 간격 (EDGE_SUMMARY_MS로 변경)
+#define ADC_BURST 32 // 측정마다 평균할 ADC 스캔 수 (조도 잡음 완화)
+
+// 서버 정보 정의
+#define SERVER_ADDRESS "192.168.45.8"
+#define SERVER_PORT 8080
+#define NODE_ID 4 // 서버에 보고할 노드 ID
+#define SITE_ID 1 // 노드가 설치된 현장 ID
+#define ZONE_ID 1 // 현장 내 구역 ID
+#define SPOOL_PATH "edge.spool" // 연결이 끊긴 동안의 보고를 보관할 파일
+#define SPOOL_BYTES (1 << 20) // spool 크기
+
+// 변수 정의
+static struct dht_sensor sensor; // DHT11 센서
+static struct adc_device adc; // MCP3008 (LIGHT_CHANNELS 환경 변수로 채널 지정, 기본은 0번 조도)
+static struct edge_wbgt edge; // WBGT 판정 상태
+static int sample_ms = EDGE_SAMPLE_MS; // 측정 간격 (서버가 측정 속도를 지시하면 바뀜)
+static int default_sample_ms = EDGE_SAMPLE_MS; // 설정된 측정 간격
+static uint32_t send_seq = 0; // 전송 프레임 시퀀스 번호
+
+// 함수 선언
+static int read_analog(float *light, float *globe);
+static void send_report(struct transport *link, const struct proto_wbgt *report, uint64_t timestamp_ms);
+static void apply_control(const struct proto_control *control);
+
+int main(void)
+{
+    printf("Edge WBGT node (DHT11 + MCP3008)\n");
+
+    // DHT11 데이터 라인 요청과 SPI 장치 준비
+    if (dht_sensor_open(&sensor, PIN, getenv("DHT11_TRACE")) == -1)
+    {
+        perror("GPIO initialization failed\n");
+        return -1;
+    }
+    if (adc_open(&adc, DEVICE) == -1)
+    {
+        dht_sensor_close(&sensor);
+        return -1;
+    }
+    const char *env = getenv("LIGHT_CHANNELS");
+    if (env != NULL)
+    {
+        adc_parse_channels(&adc, env);
+    }
+
+    // 측정 간격과 요약 주기 설정
+    env = getenv("EDGE_SAMPLE_MS");
+    if (env != NULL && atoi(env) >= 1000)
+    {
+        sample_ms = atoi(env);
+    }
+    default_sample_ms = sample_ms;
+    env = getenv("EDGE_SUMMARY_MS");
+    uint32_t summary_ms = (env != NULL && atoi(env) > 0) ? (uint32_t)atoi(env) : EDGE_SUMMARY_MS;
+    edge_wbgt_init(&edge, WBGT_LIMIT, summary_ms);
+    printf("Sampling every %d ms, WBGT limit %d, summary every %u ms\n", sample_ms, WBGT_LIMIT, summary_ms);
+
+    // 서버 연결 준비 (처음 연결에 실패해도 측정은 계속하고 spool에 쌓아 두었다가 재연결 후 전송)
+    struct transport link;
+    if (transport_open(&link, SERVER_ADDRESS, SERVER_PORT, NODE_ID, PROTO_WBGT, SITE_ID, ZONE_ID, SPOOL_PATH, SPOOL_BYTES) == -1)
+    {
+        adc_close(&adc);
+        dht_sensor_close(&sensor);
+        return -1;
+    }
+
+    // 측정마다 WBGT를 계산하고, 초과 시작/해제와 요약만 send
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (1)
+    {
+        struct dht_reading reading;
+        float light, globe;
+        if (dht_sensor_read(&sensor, &reading) == DHT_OK && read_analog(&light, &globe) == 0)
+        {
+            struct proto_wbgt report;
+            if (edge_wbgt_push(&edge, reading.temperature, reading.humidity, light, globe, proto_monotonic_ms(), &report)) // 요약 주기는 단조 시계로 셈
+            {
+                send_report(&link, &report, proto_now_ms());
+            }
+        }
+        else
+        {
+            printf("Invalid data. skip! \n");
+        }
+        transport_poll(&link); // 연결이 끊겨 있으면 재연결 시도
+        struct proto_control control;
+        if (transport_control(&link, &control))
+        {
+            apply_control(&control); // 서버가 현장 WBGT에 맞춰 측정 속도를 바꿈
+        }
+
+        // 측정에 걸린 시간(재시도 포함)과 무관하게 일정한 간격 유지 (밀렸으면 지금부터 다시 셈)
+        next.tv_sec += sample_ms / 1000;
+        next.tv_nsec += (long)(sample_ms % 1000) * 1000000L;
+        if (next.tv_nsec >= 1000000000L)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+        {
+            next = now;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    transport_close(&link);
+    adc_close(&adc);
+    dht_sensor_close(&sensor);
+    return 0;
+}
+
+// ADC를 ADC_BURST번 스캔해 조도 평균과 흑구 온도를 구하는 함수 (흑구 채널이 없거나 끊겼으면 *globe는 NAN, 실패 시 -1)
+static int read_analog(float *light, float *globe)
+{
+    double sums[ADC_CHANNELS] = {0};
+    int scans = 0;
+    for (int n = 0; n < ADC_BURST; n++)
+    {
+        int values[ADC_CHANNELS];
+        if (adc_scan(&adc, values) == 0)
+        {
+            for (int i = 0; i < adc.count; i++)
+            {
+                sums[i] += values[i];
+            }
+            scans++;
+        }
+    }
+    if (scans == 0)
+    {
+        return -1;
+    }
+
+    // 채널 종류별로 평균 (조도 채널이 여럿이면 함께 평균)
+    double light_sum = 0.0, globe_sum = 0.0;
+    int lights = 0, globes = 0;
+    for (int i = 0; i < adc.count; i++)
+    {
+        if (adc.channels[i].kind == PROTO_ANALOG_GLOBE)
+        {
+            globe_sum += sums[i] / scans;
+            globes++;
+        }
+        else
+        {
+            light_sum += sums[i] / scans;
+            lights++;
+        }
+    }
+    *light = lights ? (float)(light_sum / lights) : 0.0f;
+    *globe = globes ? adc_globe_temperature((int)(globe_sum / globes + 0.5)) : NAN;
+    return 0;
+}
+
+// 판정 보고를 server로 send (초과 시작/해제는 묶음 대기 없이 바로 보냄)
+static void send_report(struct transport *link, const struct proto_wbgt *report, uint64_t timestamp_ms)
+{
+    static const char *kinds[] = {"Summary", "Exceeded", "Cleared"};
+    uint8_t frame[PROTO_MAX_FRAME];
+
+    // 메세지 출력
+    printf("%s: WBGT = %.1f (max %.1f over %u samples), Temperature = %.1f°C, Humidity = %.1f%%, Tg = %.1f°C\n",
+           kinds[report->kind], report->wbgt, report->wbgt_max, report->samples, report->temperature, report->humidity, report->globe);
+
+    // 바이너리 프레임으로 인코딩해 전달 (연결이 없으면 spool에 저장)
+    size_t frame_len = proto_encode_wbgt(frame, sizeof(frame), NODE_ID, send_seq++, timestamp_ms, report);
+    if (transport_send(link, frame, frame_len) == -1)
+    {
+        printf("Transmission failed, report dropped\n");
+    }
+    if (report->kind != PROTO_WBGT_SUMMARY)
+    {
+        transport_flush(link);
+    }
+}
+
+// 서버의 측정 속도 지시를 적용하는 함수 (간격이 0이면 설정된 기본값으로 되돌림, 요약 주기는 그대로)
+static void apply_control(const struct proto_control *control)
+{
+    int ms = control->sample_us ? (int)(control->sample_us / 1000) : default_sample_ms;
+    sample_ms = ms < 1000 ? 1000 : ms; // DHT11 최소 측정 간격
+    printf("Server requested %s rate: sampling every %d ms\n",
+           control->level == PROTO_RATE_FAST ? "fast" : control->level == PROTO_RATE_RELAXED ? "relaxed" : "normal", sample_ms);
+}
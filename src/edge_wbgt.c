@@ -0,0 +1,80 @@
+#include <math.h>
+#include <string.h>
+#include "wbgt.h"
+#include "edge_wbgt.h"
+
+// 판정 상태 초기화 함수
+void edge_wbgt_init(struct edge_wbgt* edge, float limit, uint32_t summary_ms)
+{
+    memset(edge, 0, sizeof(*edge));
+    edge->limit = limit;
+    edge->summary_ms = summary_ms;
+}
+
+// 측정 입력 함수
+int edge_wbgt_push(struct edge_wbgt* edge, float temperature, float humidity, float light, float globe, uint64_t now_ms, struct proto_wbgt* out)
+{
+    // 서버의 cal_wbgt와 같은 계산 (흑구 온도 측정값이 없으면 온도와 조도로 추정)
+    float wet_bulb = wbgt_wet_bulb(temperature, humidity);
+    float tg = isnan(globe) ? wbgt_globe(temperature, light) : globe;
+    float wbgt = wbgt_index(wet_bulb, temperature, tg);
+
+    // 요약 구간에 누적
+    edge->sum += wbgt;
+    edge->max = edge->samples == 0 || wbgt > edge->max ? wbgt : edge->max;
+    edge->samples++;
+    edge->temperature = temperature;
+    edge->humidity = humidity;
+    edge->globe = tg;
+    if (edge->next_summary_ms == 0)
+    {
+        edge->next_summary_ms = now_ms + edge->summary_ms;
+    }
+
+    // 초과 시작/해제는 바로 보고
+    int kind = -1;
+    if (!edge->over && wbgt >= edge->limit)
+    {
+        kind = PROTO_WBGT_EXCEED;
+        edge->exceedances++;
+    }
+    else if (edge->over && wbgt < edge->limit - EDGE_CLEAR_MARGIN)
+    {
+        kind = PROTO_WBGT_CLEAR;
+    }
+    if (kind >= 0)
+    {
+        edge->over = kind == PROTO_WBGT_EXCEED;
+        out->kind = kind;
+        out->over = edge->over;
+        out->wbgt = wbgt;
+        out->wbgt_max = wbgt;
+        out->temperature = temperature;
+        out->humidity = humidity;
+        out->globe = tg;
+        out->samples = 1;
+        return 1;
+    }
+
+    // 요약 주기가 되면 구간 평균/최대를 보고하고 새 구간 시작 (오래 멈춰 있었으면 밀린 주기는 건너뜀)
+    if (now_ms < edge->next_summary_ms)
+    {
+        return 0;
+    }
+    out->kind = PROTO_WBGT_SUMMARY;
+    out->over = edge->over;
+    out->wbgt = (float)(edge->sum / edge->samples);
+    out->wbgt_max = edge->max;
+    out->temperature = temperature;
+    out->humidity = humidity;
+    out->globe = tg;
+    out->samples = edge->samples;
+    edge->sum = 0;
+    edge->samples = 0;
+    edge->next_summary_ms += edge->summary_ms;
+    if (edge->next_summary_ms <= now_ms)
+    {
+        edge->next_summary_ms = now_ms + edge->summary_ms;
+    }
+    return 1;
+}
@@ -0,0 +1,38 @@
+#ifndef EDGE_WBGT_H
+#define EDGE_WBGT_H
+
+#include <stdint.h>
+#include "protocol.h"
+
+/*
+ * 엣지 노드의 WBGT 판정
+ * 온습도와 조도(또는 흑구 온도)를 함께 읽는 노드가 서버와 같은 식(wbgt.c)으로 측정마다 WBGT를 계산하고
+ * 서버로 보낼 보고만 골라냄
+ *  - 초과 시작: WBGT가 임계치 이상이 된 측정 (바로 보냄)
+ *  - 초과 해제: 초과 중 WBGT가 임계치보다 EDGE_CLEAR_MARGIN 넘게 내려간 측정 (바로 보냄)
+ *  - 요약: summary_ms마다 구간 평균/최대 WBGT와 마지막 측정값
+ * 같은 측정에서 초과 시작/해제와 요약이 겹치면 초과 보고를 먼저 내고 요약은 다음 측정에서 냄
+ */
+#define EDGE_CLEAR_MARGIN 0.5f // 초과 해제에 필요한 임계치 아래 여유 (경계에서 시작/해제가 반복되지 않도록)
+
+// 판정 상태
+struct edge_wbgt
+{
+    float limit; // WBGT 임계치
+    uint32_t summary_ms; // 요약 주기
+    uint64_t next_summary_ms; // 다음 요약 시각 (단조 시계, 0이면 첫 측정 기준으로 정함)
+    int over; // 임계치 초과 중인지 여부
+    double sum; // 구간 WBGT 합계
+    float max; // 구간 최대 WBGT
+    uint16_t samples; // 구간 측정 수
+    float temperature, humidity, globe; // 마지막 측정
+    uint64_t exceedances; // 초과 시작 횟수
+};
+
+// 판정 상태 초기화
+void edge_wbgt_init(struct edge_wbgt* edge, float limit, uint32_t summary_ms);
+
+// 측정 하나 입력 (globe가 NAN이면 조도로 흑구 온도를 추정, now_ms는 요약 주기를 셀 단조 시계 시각, 보낼 보고가 있으면 *out을 채우고 1 반환)
+int edge_wbgt_push(struct edge_wbgt* edge, float temperature, float humidity, float light, float globe, uint64_t now_ms, struct proto_wbgt* out);
+
+#endif
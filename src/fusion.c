@@ -0,0 +1,118 @@
+#include <math.h>
+#include <string.h>
+#include "fusion.h"
+
+// 샘플 추가 함수
+void fusion_add(struct fusion_stream* stream, uint64_t t_ms, float v0, float v1)
+{
+    struct fusion_sample* s = stream->samples;
+    int n = stream->count;
+
+    // 늦게 도착한 샘플은 시각순 위치를 찾아 넣음 (보통은 맨 끝)
+    int pos = n;
+    while (pos > 0 && s[pos - 1].t_ms > t_ms)
+    {
+        pos--;
+    }
+    if (pos > 0 && s[pos - 1].t_ms == t_ms)
+    {
+        s[pos - 1].value[0] = v0; // 같은 시각의 재전송은 덮어씀
+        s[pos - 1].value[1] = v1;
+        return;
+    }
+    if (n == FUSION_WINDOW)
+    {
+        if (pos == 0)
+        {
+            return; // 보관 범위보다 오래된 샘플
+        }
+        memmove(&s[0], &s[1], (pos - 1) * sizeof(s[0])); // 가장 오래된 샘플을 버리고 앞으로 당김
+        pos--;
+    }
+    else
+    {
+        memmove(&s[pos + 1], &s[pos], (n - pos) * sizeof(s[0]));
+        stream->count++;
+    }
+    s[pos].t_ms = t_ms;
+    s[pos].value[0] = v0;
+    s[pos].value[1] = v1;
+}
+
+// 두 샘플을 잇는 직선 위의 값을 구하는 함수 (a와 b의 시각은 달라야 함)
+static void line_at(const struct fusion_sample* a, const struct fusion_sample* b, uint64_t t_ms, float out[2])
+{
+    float w = (float)((double)((int64_t)t_ms - (int64_t)a->t_ms) / (double)(b->t_ms - a->t_ms));
+    for (int i = 0; i < 2; i++)
+    {
+        out[i] = a->value[i] + (b->value[i] - a->value[i]) * w; // NaN이 섞이면 결과도 NaN
+    }
+}
+
+// 스트림 값 추정 함수
+int fusion_estimate(const struct fusion_stream* stream, uint64_t t_ms, float out[2])
+{
+    const struct fusion_sample* s = stream->samples;
+    int n = stream->count;
+    if (n == 0)
+    {
+        return FUSION_NONE;
+    }
+    if (t_ms < s[0].t_ms)
+    {
+        // tick 경계는 샘플 시각보다 최대 1 tick 이를 수 있으므로 그 안이면 첫 샘플 값을 씀
+        if (s[0].t_ms - t_ms >= FUSION_TICK_MS)
+        {
+            return FUSION_NONE;
+        }
+        memcpy(out, s[0].value, sizeof(s[0].value));
+        return FUSION_HELD;
+    }
+
+    // 마지막 샘플 이후: 다음 샘플이 올 때까지 마지막 값 유지
+    const struct fusion_sample* last = &s[n - 1];
+    if (t_ms >= last->t_ms)
+    {
+        if (t_ms - last->t_ms > FUSION_MAX_AGE_MS)
+        {
+            return FUSION_NONE;
+        }
+        memcpy(out, last->value, sizeof(last->value));
+        return t_ms == last->t_ms ? FUSION_INTERPOLATED : FUSION_HELD;
+    }
+
+    // 두 샘플 사이: 선형 보간
+    int i = n - 1;
+    while (s[i - 1].t_ms > t_ms)
+    {
+        i--;
+    }
+    line_at(&s[i - 1], &s[i], t_ms, out);
+    return FUSION_INTERPOLATED;
+}
+
+// 측정점 만들기 함수
+int fusion_join(struct fusion_state* state, uint64_t t_ms, struct fusion_point* out)
+{
+    float temp[2], light[2];
+    uint64_t tick = t_ms - t_ms % FUSION_TICK_MS;
+
+    // 이미 판정한 tick보다 이전 샘플은 창에만 넣고 판정을 다시 하지 않음 (같은 tick은 새 샘플로 갱신)
+    if (tick < state->last_tick_ms)
+    {
+        return 0;
+    }
+    out->temp_method = fusion_estimate(&state->temp, tick, temp);
+    out->light_method = fusion_estimate(&state->light, tick, light);
+    if (out->temp_method == FUSION_NONE || out->light_method == FUSION_NONE)
+    {
+        return 0;
+    }
+    state->last_tick_ms = tick;
+    out->tick_ms = tick;
+    out->temperature = temp[0];
+    out->humidity = temp[1];
+    out->light = light[0];
+    out->globe = light[1];
+    return 1;
+}
@@ -0,0 +1,71 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdint.h>
+
+/*
+ * 시각을 맞춘 센서 융합
+ * 현장마다 온습도와 조도(흑구) 스트림의 최근 샘플을 측정 시각과 함께 보관하고,
+ * 새 샘플이 들어오면 그 시각이 속한 tick에서 두 스트림 값을 추정해 하나의 측정점으로 묶음
+ * - tick이 스트림의 두 샘플 사이에 있으면 선형 보간
+ * - 스트림의 마지막 샘플보다 늦으면 마지막 값을 유지 (DHT11은 1 C 단위라 기울기로 외삽하면 양자화 오차가 커짐)
+ *   단, 마지막 샘플보다 FUSION_MAX_AGE_MS 넘게 늦으면 오래된 값으로 보고 추정하지 않음
+ * 서로 다른 주기와 위상으로 보고하는 노드의 값도 같은 시각 기준으로 묶이고, 알람은 새 샘플이 들어온 tick에 바로 판정됨
+ * 샘플 시각은 서버 수신 시각 기준이어야 함 (노드 시계가 앞선 샘플이 last_tick_ms를 밀어 다른 노드의 샘플을 막지 않도록)
+ */
+#define FUSION_WINDOW 8 // 스트림별 보관 샘플 수
+#define FUSION_TICK_MS 1000 // 융합 시각 간격
+#define FUSION_MAX_AGE_MS 30000 // 추정에 쓸 수 있는 마지막 샘플의 최대 나이 (보고 주기보다 길어야 함)
+
+// 추정 방법
+enum fusion_method
+{
+    FUSION_NONE = -1, // 추정할 수 없음 (샘플 없음, 너무 오래됨, 보관 범위보다 이전)
+    FUSION_INTERPOLATED = 0, // 두 샘플 사이를 보간
+    FUSION_HELD = 1 // 가장 가까운 샘플 값을 유지 (다음 샘플이 아직 없음)
+};
+
+// 샘플 하나 (값 두 개: 온습도 스트림은 온도/습도, 조도 스트림은 조도/측정 흑구 온도, 없는 값은 NaN)
+struct fusion_sample
+{
+    uint64_t t_ms; // 측정 시각
+    float value[2]; // 측정값
+};
+
+// 스트림 하나의 최근 샘플 (시각순, 가장 오래된 것부터)
+struct fusion_stream
+{
+    struct fusion_sample samples[FUSION_WINDOW]; // 샘플
+    int count; // 보관 중인 샘플 수
+};
+
+// 현장별 융합 상태
+struct fusion_state
+{
+    struct fusion_stream temp; // 온습도 스트림
+    struct fusion_stream light; // 조도/흑구 스트림
+    uint64_t last_tick_ms; // 마지막으로 측정점을 만든 tick
+};
+
+// 융합된 측정점
+struct fusion_point
+{
+    uint64_t tick_ms; // 측정점 시각 (tick 경계)
+    float temperature; // 건구 온도
+    float humidity; // 상대 습도
+    float light; // 조도 값
+    float globe; // 측정 흑구 온도 (없으면 NaN)
+    int temp_method; // 온습도 추정 방법 (enum fusion_method)
+    int light_method; // 조도 추정 방법
+};
+
+// 샘플 추가 (시각순 위치에 넣고, 가득 차면 가장 오래된 샘플을 버림)
+void fusion_add(struct fusion_stream* stream, uint64_t t_ms, float v0, float v1);
+
+// 스트림 값을 t_ms 시각으로 추정 (추정 방법 반환)
+int fusion_estimate(const struct fusion_stream* stream, uint64_t t_ms, float out[2]);
+
+// t_ms가 속한 tick의 측정점 만들기 (이미 지난 tick이거나 추정할 수 없으면 0, 만들었으면 1)
+int fusion_join(struct fusion_state* state, uint64_t t_ms, struct fusion_point* out);
+
+#endif
@@ -0,0 +1,362 @@
+#define _GNU_SOURCE // pipe2 사용을 위해 정의
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "gpio.h"
+
+static const struct gpio_ops* backend = NULL; // 현재 backend (NULL이면 처음 요청 시 결정)
+
+// 요청 플래그를 GPIO v2 라인 플래그로 바꾸는 함수
+static uint64_t to_line_flags(int flags)
+{
+    uint64_t line_flags = 0;
+    if (flags & GPIO_OUTPUT)
+    {
+        line_flags |= GPIO_V2_LINE_FLAG_OUTPUT;
+    }
+    else
+    {
+        line_flags |= GPIO_V2_LINE_FLAG_INPUT;
+    }
+    if (flags & GPIO_EDGE_RISING)
+    {
+        line_flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+    }
+    if (flags & GPIO_EDGE_FALLING)
+    {
+        line_flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    }
+    return line_flags;
+}
+
+// 모든 라인을 가리키는 마스크
+static uint64_t all_lines(const struct gpio_lines* lines)
+{
+    return lines->count >= 64 ? ~0ULL : (1ULL << lines->count) - 1;
+}
+
+/* ---------- 문자 장치 backend ---------- */
+
+// 라인 요청 함수
+static int chardev_request(struct gpio_lines* lines, const char* chip, const char* consumer)
+{
+    struct gpio_v2_line_request req;
+    int chip_fd = open(chip, O_RDWR | O_CLOEXEC);
+    if (chip_fd == -1)
+    {
+        fprintf(stderr, "Failed to open %s!\n", chip);
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    for (unsigned int i = 0; i < lines->count; i++)
+    {
+        req.offsets[i] = lines->offsets[i];
+    }
+    req.num_lines = lines->count;
+    strncpy(req.consumer, consumer, sizeof(req.consumer) - 1);
+    req.config.flags = to_line_flags(lines->flags);
+    req.event_buffer_size = lines->events; // 에지를 나중에 켜도 버퍼 크기는 요청 때 정해짐
+
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) == -1)
+    {
+        fprintf(stderr, "Failed to request gpio lines!\n");
+        close(chip_fd);
+        return -1;
+    }
+    close(chip_fd); // 라인 요청 fd만 있으면 칩 fd는 필요 없음
+    lines->fd = req.fd;
+    return 0;
+}
+
+// 라인 설정 변경 함수
+static int chardev_reconfigure(struct gpio_lines* lines)
+{
+    struct gpio_v2_line_config config;
+    memset(&config, 0, sizeof(config));
+    config.flags = to_line_flags(lines->flags);
+    if (ioctl(lines->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) == -1)
+    {
+        fprintf(stderr, "Failed to reconfigure gpio lines!\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 라인 값 읽기 함수
+static int chardev_get(struct gpio_lines* lines, uint64_t* values)
+{
+    struct gpio_v2_line_values v = {.bits = 0, .mask = all_lines(lines)};
+    if (ioctl(lines->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) == -1)
+    {
+        fprintf(stderr, "Failed to read value!\n");
+        return -1;
+    }
+    *values = v.bits;
+    return 0;
+}
+
+// 라인 값 쓰기 함수
+static int chardev_set(struct gpio_lines* lines, uint64_t mask, uint64_t values)
+{
+    struct gpio_v2_line_values v = {.bits = values, .mask = mask & all_lines(lines)};
+    if (ioctl(lines->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) == -1)
+    {
+        fprintf(stderr, "Failed to write value!\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 에지 이벤트 읽기 함수
+static int chardev_read_events(struct gpio_lines* lines, struct gpio_event* events, int max)
+{
+    struct gpio_v2_line_event buf[GPIO_MAX_EVENTS];
+    if (max > GPIO_MAX_EVENTS)
+    {
+        max = GPIO_MAX_EVENTS;
+    }
+
+    ssize_t n = read(lines->fd, buf, max * sizeof(buf[0]));
+    if (n < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+
+    int count = n / sizeof(buf[0]);
+    for (int i = 0; i < count; i++)
+    {
+        events[i].offset = buf[i].offset;
+        events[i].value = (buf[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+        events[i].timestamp_ns = buf[i].timestamp_ns;
+    }
+    return count;
+}
+
+// 라인 반납 함수
+static void chardev_release(struct gpio_lines* lines)
+{
+    close(lines->fd);
+}
+
+const struct gpio_ops gpio_chardev_ops = {
+    .request = chardev_request,
+    .reconfigure = chardev_reconfigure,
+    .get = chardev_get,
+    .set = chardev_set,
+    .read_events = chardev_read_events,
+    .release = chardev_release,
+};
+
+/* ---------- 가짜 backend ---------- */
+
+// 가짜 라인 상태 (이벤트는 pipe로 전달해 fd를 poll/epoll에 그대로 쓸 수 있게 함)
+struct fake_state
+{
+    uint64_t values; // 라인 값
+    int pipe_w; // 이벤트를 써 넣는 pipe 끝
+};
+
+// 가짜 라인 요청 함수
+static int fake_request(struct gpio_lines* lines, const char* chip, const char* consumer)
+{
+    int fds[2];
+    struct fake_state* state = calloc(1, sizeof(*state));
+    (void)chip;
+    (void)consumer;
+
+    if (state == NULL || pipe2(fds, O_CLOEXEC) == -1)
+    {
+        free(state);
+        return -1;
+    }
+    state->pipe_w = fds[1];
+    lines->fd = fds[0];
+    lines->priv = state;
+    return 0;
+}
+
+// 가짜 라인 설정 변경 함수
+static int fake_reconfigure(struct gpio_lines* lines)
+{
+    (void)lines;
+    return 0;
+}
+
+// 가짜 라인 값 읽기 함수
+static int fake_get(struct gpio_lines* lines, uint64_t* values)
+{
+    *values = ((struct fake_state*)lines->priv)->values;
+    return 0;
+}
+
+// 가짜 라인 값 쓰기 함수
+static int fake_set(struct gpio_lines* lines, uint64_t mask, uint64_t values)
+{
+    struct fake_state* state = lines->priv;
+    state->values = (state->values & ~mask) | (values & mask);
+    return 0;
+}
+
+// 가짜 에지 이벤트 읽기 함수
+static int fake_read_events(struct gpio_lines* lines, struct gpio_event* events, int max)
+{
+    ssize_t n = read(lines->fd, events, max * sizeof(events[0]));
+    if (n < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+    return n / sizeof(events[0]);
+}
+
+// 가짜 라인 반납 함수
+static void fake_release(struct gpio_lines* lines)
+{
+    struct fake_state* state = lines->priv;
+    close(state->pipe_w);
+    close(lines->fd);
+    free(state);
+}
+
+const struct gpio_ops gpio_fake_ops = {
+    .request = fake_request,
+    .reconfigure = fake_reconfigure,
+    .get = fake_get,
+    .set = fake_set,
+    .read_events = fake_read_events,
+    .release = fake_release,
+};
+
+/* ---------- 공통 함수 ---------- */
+
+// backend 지정 함수
+void gpio_set_backend(const struct gpio_ops* ops)
+{
+    backend = ops;
+}
+
+// 라인 묶음 요청 함수
+int gpio_request(struct gpio_lines* lines, const char* chip, const unsigned int* offsets, unsigned int count, int flags, unsigned int events, const char* consumer)
+{
+    if (count == 0 || count > GPIO_MAX_LINES || events > GPIO_MAX_EVENTS)
+    {
+        return -1;
+    }
+    if (backend == NULL)
+    {
+        const char* name = getenv("GPIO_BACKEND");
+        backend = (name != NULL && strcmp(name, "fake") == 0) ? &gpio_fake_ops : &gpio_chardev_ops;
+    }
+
+    memset(lines, 0, sizeof(*lines));
+    memcpy(lines->offsets, offsets, count * sizeof(offsets[0]));
+    lines->count = count;
+    lines->flags = flags;
+    lines->events = events;
+    lines->ops = backend;
+    if (backend->request(lines, chip, consumer) == -1)
+    {
+        lines->ops = NULL; // 실패한 요청은 반납할 것이 없음
+        return -1;
+    }
+    return 0;
+}
+
+// 라인 설정 변경 함수
+int gpio_reconfigure(struct gpio_lines* lines, int flags)
+{
+    lines->flags = flags;
+    return lines->ops->reconfigure(lines);
+}
+
+// 모든 라인 값 읽기 함수
+int gpio_get(struct gpio_lines* lines, uint64_t* values)
+{
+    return lines->ops->get(lines, values);
+}
+
+// 여러 라인 값 쓰기 함수
+int gpio_set(struct gpio_lines* lines, uint64_t mask, uint64_t values)
+{
+    return lines->ops->set(lines, mask, values);
+}
+
+// 라인 하나 읽기 함수
+int gpio_read(struct gpio_lines* lines, unsigned int index)
+{
+    uint64_t values;
+    if (index >= lines->count || gpio_get(lines, &values) == -1)
+    {
+        return -1;
+    }
+    return (values >> index) & 1;
+}
+
+// 라인 하나 쓰기 함수
+int gpio_write(struct gpio_lines* lines, unsigned int index, int value)
+{
+    if (index >= lines->count)
+    {
+        return -1;
+    }
+    return gpio_set(lines, 1ULL << index, value ? 1ULL << index : 0);
+}
+
+// 에지 이벤트 읽기 함수
+int gpio_read_events(struct gpio_lines* lines, struct gpio_event* events, int max)
+{
+    return lines->ops->read_events(lines, events, max);
+}
+
+// 이벤트 대기 함수
+int gpio_wait_event(struct gpio_lines* lines, int timeout_ms)
+{
+    struct pollfd pfd = {.fd = lines->fd, .events = POLLIN};
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+    return ret > 0 ? 1 : 0;
+}
+
+// 라인 반납 함수
+void gpio_release(struct gpio_lines* lines)
+{
+    if (lines->ops != NULL)
+    {
+        lines->ops->release(lines);
+        lines->ops = NULL;
+    }
+}
+
+// 가짜 backend 입력 주입 함수
+int gpio_fake_inject(struct gpio_lines* lines, unsigned int index, int value, uint64_t timestamp_ns)
+{
+    if (lines->ops != &gpio_fake_ops || index >= lines->count)
+    {
+        return -1;
+    }
+
+    struct fake_state* state = lines->priv;
+    int old = (state->values >> index) & 1;
+    value = value ? 1 : 0;
+    fake_set(lines, 1ULL << index, (uint64_t)value << index);
+
+    // 값이 바뀌었고 해당 방향 에지를 요청했으면 이벤트 생성
+    if (old != value && (lines->flags & (value ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING)))
+    {
+        struct gpio_event ev = {.offset = lines->offsets[index], .value = value, .timestamp_ns = timestamp_ns};
+        if (write(state->pipe_w, &ev, sizeof(ev)) != sizeof(ev))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
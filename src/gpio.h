@@ -0,0 +1,90 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdint.h>
+
+/*
+ * /dev/gpiochipN 문자 장치(GPIO v2 line request)를 사용하는 GPIO 모듈
+ * 라인을 한 번 요청해 두고 fd를 계속 사용하므로 읽기/쓰기마다 open/close 하지 않음
+ * 한 요청에 여러 라인을 묶으면 한 번의 ioctl로 모두 읽거나 쓸 수 있음
+ * GPIO_BACKEND=fake 환경 변수를 주면 GPIO가 없는 리눅스 PC에서도 동작하는 가짜 backend 사용
+ */
+#define GPIO_CHIP "/dev/gpiochip0" // 라즈베리파이 BCM GPIO 칩 (라인 번호 = BCM 번호)
+#define GPIO_MAX_LINES 64 // 한 요청에 묶을 수 있는 최대 라인 수
+#define GPIO_MAX_EVENTS 256 // 요청할 수 있는 최대 이벤트 버퍼 크기 (한 번에 읽을 수 있는 최대 이벤트 수)
+
+// 라인 설정 플래그
+#define GPIO_INPUT 0x01 // 입력
+#define GPIO_OUTPUT 0x02 // 출력
+#define GPIO_EDGE_RISING 0x04 // 상승 에지 이벤트
+#define GPIO_EDGE_FALLING 0x08 // 하강 에지 이벤트
+#define GPIO_EDGE_BOTH (GPIO_EDGE_RISING | GPIO_EDGE_FALLING) // 양쪽 에지 이벤트
+
+// 에지 이벤트
+struct gpio_event
+{
+    unsigned int offset; // 이벤트가 발생한 라인 번호
+    int value; // 에지 이후의 값 (1: 상승, 0: 하강)
+    uint64_t timestamp_ns; // 커널이 기록한 시각 (CLOCK_MONOTONIC, ns)
+};
+
+struct gpio_lines;
+
+// backend 함수 모음
+struct gpio_ops
+{
+    int (*request)(struct gpio_lines* lines, const char* chip, const char* consumer);
+    int (*reconfigure)(struct gpio_lines* lines);
+    int (*get)(struct gpio_lines* lines, uint64_t* values);
+    int (*set)(struct gpio_lines* lines, uint64_t mask, uint64_t values);
+    int (*read_events)(struct gpio_lines* lines, struct gpio_event* events, int max);
+    void (*release)(struct gpio_lines* lines);
+};
+
+// 요청한 라인 묶음
+struct gpio_lines
+{
+    int fd; // line request fd (poll/epoll로 이벤트 대기 가능)
+    int flags; // 라인 설정 플래그
+    unsigned int events; // 커널 이벤트 버퍼 크기 (0이면 커널 기본값, 라인당 16개)
+    unsigned int count; // 라인 수
+    unsigned int offsets[GPIO_MAX_LINES]; // 라인 번호 (값 비트 i는 offsets[i]에 대응)
+    const struct gpio_ops* ops; // 사용하는 backend
+    void* priv; // backend 전용 데이터
+};
+
+extern const struct gpio_ops gpio_chardev_ops; // 실제 GPIO 문자 장치 backend
+extern const struct gpio_ops gpio_fake_ops; // 메모리 위의 가짜 backend
+
+// 이후 요청에 사용할 backend 지정 (기본값은 환경 변수 GPIO_BACKEND로 결정)
+void gpio_set_backend(const struct gpio_ops* ops);
+
+// 라인 묶음 요청 (events는 읽기 전에 쌓아 둘 수 있는 에지 이벤트 수, 나중에 에지를 켤 라인도 요청 때 정해야 함, 성공 시 0, 실패 시 -1)
+int gpio_request(struct gpio_lines* lines, const char* chip, const unsigned int* offsets, unsigned int count, int flags, unsigned int events, const char* consumer);
+
+// 라인 방향/에지 설정 변경 (fd는 그대로 유지)
+int gpio_reconfigure(struct gpio_lines* lines, int flags);
+
+// 모든 라인 값을 한 번에 읽기 (비트 i = offsets[i]의 값)
+int gpio_get(struct gpio_lines* lines, uint64_t* values);
+
+// mask에 해당하는 라인 값을 한 번에 쓰기
+int gpio_set(struct gpio_lines* lines, uint64_t mask, uint64_t values);
+
+// 라인 하나 읽기/쓰기 (index는 요청 순서)
+int gpio_read(struct gpio_lines* lines, unsigned int index);
+int gpio_write(struct gpio_lines* lines, unsigned int index, int value);
+
+// 에지 이벤트 최대 max개 읽기 (fd가 블로킹이면 이벤트가 올 때까지 대기)
+int gpio_read_events(struct gpio_lines* lines, struct gpio_event* events, int max);
+
+// timeout_ms 동안 이벤트 대기 (이벤트 있음 1, 시간 초과 0, 오류 -1, timeout_ms < 0이면 무한 대기)
+int gpio_wait_event(struct gpio_lines* lines, int timeout_ms);
+
+// 라인 반납
+void gpio_release(struct gpio_lines* lines);
+
+// 가짜 backend에서 입력 라인 값을 바꾸고 에지 이벤트를 만드는 함수 (테스트/시뮬레이션용)
+int gpio_fake_inject(struct gpio_lines* lines, unsigned int index, int value, uint64_t timestamp_ns);
+
+#endif
@@ -1,156 +1,218 @@
-#include <fcntl.h> 
-#include <linux/spi/spidev.h> 
-#include <linux/types.h> 
 #include <stdint.h> 
 #include <stdio.h> 
 #include <stdlib.h> 
-#include <sys/ioctl.h> 
 #include <unistd.h> 
 #include <string.h> 
-#include <sys/socket.h> 
-#include <arpa/inet.h> 
 #include <pthread.h> 
+#include <math.h> 
+#include <time.h> 
+#include <stdatomic.h> 
+#include "protocol.h"
+#include "light_filter.h"
+#include "adc.h"
+#include "transport.h"
 
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0])) // 배열의 크기를 계산하는 매크로
 
+// 수집 파이프라인 설정 (LIGHT_SAMPLE_HZ, LIGHT_OUTPUT_MS 환경 변수로 변경 가능)
+#define SAMPLE_HZ 500 // 기본 스캔 주파수
+#define OUTPUT_MS 1000 // 기본 출력 주기 (이 주기마다 서버로 전송)
+#define RING_SIZE 1024 // 스캔 링 버퍼 크기 (2의 거듭제곱, 500Hz에서 약 2초 분량)
+#define DRAIN_MS 20 // 통신 쓰레드가 링 버퍼를 비우는 주기
+#define SPOOL_PATH "light.spool" // 연결이 끊긴 동안의 측정을 보관할 파일
+#define SPOOL_BYTES (1 << 20) // spool 크기
+
+static struct adc_device adc; // MCP3008 (LIGHT_CHANNELS 환경 변수로 "0:light,1:light,2:globe"처럼 채널 지정, 기본은 0번 조도)
+static atomic_int sample_hz = SAMPLE_HZ; // 스캔 주파수 (서버의 측정 속도 지시로 통신 쓰레드가 바꿈)
+static int output_ms = OUTPUT_MS;
+static int default_sample_hz = SAMPLE_HZ; // 설정된 스캔 주파수
+static int default_output_ms = OUTPUT_MS; // 설정된 출력 주기
+
+// 수집 쓰레드 -> 통신 쓰레드 링 버퍼 (생산자, 소비자가 하나씩이라 잠금 없음)
+struct adc_scan {
+    uint16_t values[ADC_CHANNELS]; // 채널별 ADC 값
+};
+static struct adc_scan ring[RING_SIZE];
+static atomic_uint ring_head; // 다음에 쓸 위치 (수집 쓰레드만 증가)
+static atomic_uint ring_tail; // 다음에 읽을 위치 (통신 쓰레드만 증가)
+static atomic_ulong ring_dropped; // 링 버퍼가 가득 차 버린 스캔 수
+static atomic_ulong scan_failures; // 재시도 후에도 실패한 스캔 수
+
 static const char *DEVICE = "/dev/spidev0.0"; // SPI 장치 파일 경로
-static uint8_t MODE = 0; // SPI 모드 설정
-static uint8_t BITS = 8; // 전송 비트 수 설정
-static uint32_t CLOCK = 1000000; // SPI 클럭 속도 설정
-static uint16_t DELAY = 5; // 전송 딜레이 설정
 
 static const char *SERVER_IP = "192.168.45.8"; // 서버 IP 주소
 static const int SERVER_PORT = 8080; // 서버 포트 번호
-
-// SPI 장치를 준비하는 함수
-static int prepare(int fd) { 
-    if (ioctl(fd, SPI_IOC_WR_MODE, &MODE) == -1) { // SPI 모드 설정
-        perror("Can't set MODE");
-        return -1;
+static const uint32_t NODE_ID = 2; // 서버에 보고할 노드 ID
+static const uint16_t SITE_ID = 1; // 노드가 설치된 현장 ID
+static const uint16_t ZONE_ID = 1; // 현장 내 구역 ID
+
+// 다음 스캔 시각 계산 함수
+static void advance(struct timespec *t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
     }
+}
 
-    if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &BITS) == -1) { // 전송 비트 수 설정
-        perror("Can't set number of BITS");
-        return -1;
-    }
+// 수집 쓰레드 함수 (절대 시각으로 잠들어 주기가 밀리지 않고, 스캔 사이에는 CPU를 쓰지 않음)
+void *acquisition_thread(void *arg) {
+    struct timespec next, now;
 
-    if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &CLOCK) == -1) { // SPI 클럭 속도 설정
-        perror("Can't set write CLOCK");
-        return -1;
-    }
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (1) {
+        int values[ADC_CHANNELS];
+        if (adc_scan(&adc, values) == 0) { // 모든 채널을 한 번에 읽기 (실패하면 재시도 후 장치를 다시 엶)
+            unsigned int head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+            unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+            if (head - tail < RING_SIZE) {
+                struct adc_scan *slot = &ring[head & (RING_SIZE - 1)];
+                for (int i = 0; i < adc.count; i++) {
+                    slot->values[i] = (uint16_t)values[i];
+                }
+                atomic_store_explicit(&ring_head, head + 1, memory_order_release); // 소비자에게 공개
+            } else {
+                atomic_fetch_add_explicit(&ring_dropped, 1, memory_order_relaxed); // 소비자가 밀려 있으면 버림
+            }
+        } else {
+            atomic_fetch_add_explicit(&scan_failures, 1, memory_order_relaxed); // 이번 샘플은 건너뜀
+        }
 
-    if (ioctl(fd, SPI_IOC_RD_MAX_SPEED_HZ, &CLOCK) == -1) { // SPI 읽기 클럭 속도 설정
-        perror("Can't set read CLOCK");
-        return -1;
+        advance(&next, 1000000000L / atomic_load_explicit(&sample_hz, memory_order_relaxed)); // 스캔 주기 (측정 속도 지시로 바뀔 수 있음)
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec + 1) {
+            next = now; // 재시도 등으로 1초 넘게 밀렸으면 밀린 스캔을 몰아서 하지 않고 지금부터 다시 시작
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
     }
-
-    return 0;
+    return NULL;
 }
 
-// 채널의 차동 제어 비트를 설정하는 함수
-uint8_t control_bits_differential(uint8_t channel) {
-    return (channel & 7) << 4;
-}
-
-// 채널의 제어 비트를 설정하는 함수
-uint8_t control_bits(uint8_t channel) {
-    return 0x8 | control_bits_differential(channel);
+// 현재 스캔 주파수와 출력 주기로 필터를 초기화하는 함수
+static void reset_filters(struct light_filter *filters) {
+    int hz = atomic_load_explicit(&sample_hz, memory_order_relaxed);
+    uint32_t decimation = (uint32_t)((long)hz * output_ms / 1000); // 출력 1개당 스캔 수
+    for (int i = 0; i < adc.count; i++) {
+        light_filter_init(&filters[i], decimation);
+    }
+    printf("Sampling %d channel(s) at %d Hz, sending every %d ms (decimation %u)\n", adc.count, hz, output_ms, filters[0].decimation);
 }
 
-// ADC 값을 읽는 함수
-int readadc(int fd, uint8_t channel) { 
-    uint8_t tx[] = {1, control_bits(channel), 0}; // 전송 버퍼 초기화
-    uint8_t rx[3]; // 수신 버퍼
-
-    // SPI 전송 구조체 초기화
-    struct spi_ioc_transfer tr = {
-        .tx_buf = (unsigned long)tx,
-        .rx_buf = (unsigned long)rx,
-        .len = ARRAY_SIZE(tx),
-        .delay_usecs = DELAY,
-        .speed_hz = CLOCK,
-        .bits_per_word = BITS,
-    };
-
-    // SPI 메시지 전송
-    if (ioctl(fd, SPI_IOC_MESSAGE(1), &tr) < 0) {
-        perror("IO Error");
-        abort();
+// 서버의 측정 속도 지시를 적용하는 함수 (간격이 0이면 설정된 기본값으로 되돌리고, 필터는 상태를 유지한 채 비율만 바꿈)
+static void apply_control(const struct proto_control *control, struct light_filter *filters) {
+    int hz = control->sample_us ? (int)(1000000 / control->sample_us) : default_sample_hz;
+    hz = hz > 0 ? hz : 1;
+    atomic_store_explicit(&sample_hz, hz, memory_order_relaxed);
+    output_ms = control->report_ms ? (int)control->report_ms : default_output_ms;
+    printf("Server requested %s rate\n", control->level == PROTO_RATE_FAST ? "fast" : control->level == PROTO_RATE_RELAXED ? "relaxed" : "normal");
+
+    uint32_t decimation = (uint32_t)((long)hz * output_ms / 1000); // 출력 1개당 스캔 수
+    int changed = 0;
+    for (int i = 0; i < adc.count; i++) {
+        changed |= light_filter_set_decimation(&filters[i], decimation); // 중앙값 창과 적분기는 유지
+    }
+    if (changed) {
+        printf("Sampling at %d Hz, sending every %d ms (decimation %u)\n", hz, output_ms, filters[0].decimation);
     }
-
-    // 수신된 데이터 반환
-    return ((rx[1] << 8) & 0x300) | (rx[2] & 0xFF);
 }
 
 // 통신 쓰레드 함수
 void *communication_thread(void *arg) {
-    int fd = *((int *)arg); // 전달된 파일 디스크립터 가져오기
-    int num_readings = 10; // 데이터 읽기 횟수
-    int sum = 0; // 조도 센서 값 누적을 위한 변수
-
-    int sock; // 소켓 파일 디스크립터
-    struct sockaddr_in server; // 서버 주소 구조체
-
-    sock = socket(AF_INET, SOCK_STREAM, 0); // 소켓 생성
-    if (sock == -1) {
-        perror("Could not create socket");
-        pthread_exit(NULL); // 실패 시 쓰레드 종료
-    }
+    struct light_filter filters[ADC_CHANNELS]; // 채널별 이상값 제거 + 데시메이션 필터
+    uint32_t seq = 0; // 전송 프레임 시퀀스 번호
 
-    server.sin_addr.s_addr = inet_addr(SERVER_IP); // 서버 IP 주소 설정
-    server.sin_family = AF_INET; // 주소 체계 설정 (IPv4)
-    server.sin_port = htons(SERVER_PORT); // 서버 포트 번호 설정
+    reset_filters(filters);
 
-    if (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) { // 서버에 연결 시도
-        perror("Connect failed. Error");
-        pthread_exit(NULL); // 실패 시 쓰레드 종료
+    struct transport link; // 서버 연결 (끊기면 재연결하고 그동안의 측정은 spool에 보관)
+    if (transport_open(&link, SERVER_IP, SERVER_PORT, NODE_ID, PROTO_LIGHT, SITE_ID, ZONE_ID, SPOOL_PATH, SPOOL_BYTES) == -1) {
+        pthread_exit(NULL); // spool을 만들 수 없으면 쓰레드 종료
     }
-    printf("Connected to server\n");
 
     while (1) {
-        sum = 0; // 합계 초기화
-        num_readings = 10; // 읽기 횟수 초기화
-
-        while (num_readings > 0) { // 읽기 횟수만큼 반복
-            int value = readadc(fd, 0); // ADC 값 읽기
-            printf("Light sensor value: %d\n", value); // 읽은 값 출력
-            sum += value; // 읽은 값을 합계에 추가
-            num_readings--; // 읽기 횟수 감소
-            usleep(2000000); // 2초 대기
+        usleep(DRAIN_MS * 1000); // 스캔이 쌓일 때까지 대기
+        transport_poll(&link); // 연결이 끊겨 있으면 재연결 시도
+        struct proto_control control;
+        if (transport_control(&link, &control)) {
+            apply_control(&control, filters); // 서버가 현장 WBGT에 맞춰 측정 속도를 바꿈
         }
 
-        int average = sum / 10; // 평균 값 계산
-        printf("Average Light Sensor Value: %d\n", average); // 평균 값 출력
-
-        char message[20]; // 메시지 버퍼
-        snprintf(message, sizeof(message), "%d", average); // 평균 값을 문자열로 변환하여 메시지에 저장
-        if (send(sock, message, strlen(message), 0) < 0) { // 서버로 메시지 전송
-            perror("Send failed");
-            pthread_exit(NULL); // 실패 시 쓰레드 종료
+        unsigned int tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&ring_head, memory_order_acquire);
+        for (; tail != head; tail++) { // 쌓인 스캔을 모두 필터에 넣기
+            const struct adc_scan *scan = &ring[tail & (RING_SIZE - 1)];
+            struct proto_analog readings[ADC_CHANNELS];
+            int count = 0;
+
+            for (int i = 0; i < adc.count; i++) {
+                float average;
+                if (!light_filter_push(&filters[i], scan->values[i], &average)) {
+                    continue; // 아직 출력 주기가 아님
+                }
+                if (adc.channels[i].kind == PROTO_ANALOG_GLOBE) {
+                    average = adc_globe_temperature((int)(average + 0.5f)); // 흑구 온도는 필터를 거친 ADC 값으로 변환
+                    if (isnan(average)) {
+                        printf("Globe sensor on channel %d disconnected\n", adc.channels[i].channel);
+                        continue;
+                    }
+                    printf("Globe Temperature: %.1f C\n", average); // 출력 값 출력
+                } else {
+                    printf("Light Sensor Value: %.1f (%llu outliers rejected)\n", average, (unsigned long long)filters[i].rejected); // 출력 값 출력
+                }
+                readings[count].channel = adc.channels[i].channel;
+                readings[count].kind = adc.channels[i].kind;
+                readings[count].value = average;
+                count++;
+            }
+            if (count == 0) {
+                continue;
+            }
+
+            uint8_t frame[PROTO_MAX_FRAME]; // 프레임 버퍼
+            size_t frame_len = proto_encode_analog(frame, sizeof(frame), NODE_ID, seq++, proto_now_ms(), readings, count); // 채널 묶음을 바이너리 프레임으로 인코딩
+            if (transport_send(&link, frame, frame_len) == -1) { // 서버로 메시지 전송 (연결이 없으면 spool에 저장)
+                printf("Send failed, reading dropped\n");
+            }
+
+            unsigned long dropped = atomic_load_explicit(&ring_dropped, memory_order_relaxed);
+            unsigned long failures = atomic_load_explicit(&scan_failures, memory_order_relaxed);
+            if (dropped > 0 || failures > 0) {
+                printf("Scans dropped: %lu, failed: %lu\n", dropped, failures);
+            }
         }
+        atomic_store_explicit(&ring_tail, tail, memory_order_release); // 읽은 자리를 수집 쓰레드에 돌려줌
     }
 
-    close(sock); // 소켓 닫기
+    transport_close(&link); // 연결 닫기
     pthread_exit(NULL); // 쓰레드 종료
 }
 
 int main(int argc, char **argv) {
-    int fd = open(DEVICE, O_RDWR); // SPI 장치 열기
-    if (fd <= 0) {
-        perror("Device open error"); // 열기 실패 시 에러 메시지 출력
+    if (adc_open(&adc, DEVICE) == -1) { // SPI 장치 열기 및 준비
         return -1;
     }
-
-    if (prepare(fd) == -1) { // SPI 장치 준비
-        perror("Device prepare error"); // 준비 실패 시 에러 메시지 출력
-        return -1;
+    const char *spec = getenv("LIGHT_CHANNELS"); // 스캔할 채널 설정
+    if (spec != NULL) {
+        adc_parse_channels(&adc, spec);
     }
+    const char *hz = getenv("LIGHT_SAMPLE_HZ"); // 스캔 주파수
+    if (hz != NULL && atoi(hz) > 0) {
+        sample_hz = atoi(hz);
+        default_sample_hz = sample_hz;
+    }
+    const char *ms = getenv("LIGHT_OUTPUT_MS"); // 출력 주기
+    if (ms != NULL && atoi(ms) > 0) {
+        output_ms = atoi(ms);
+        default_output_ms = output_ms;
+    }
+
+    pthread_t acquisition_id; // 수집 쓰레드 ID 변수
+    pthread_create(&acquisition_id, NULL, acquisition_thread, NULL); // 수집 쓰레드 생성
 
     pthread_t thread_id; // 쓰레드 ID 변수
-    pthread_create(&thread_id, NULL, communication_thread, (void *)&fd); // 통신 쓰레드 생성
+    pthread_create(&thread_id, NULL, communication_thread, NULL); // 통신 쓰레드 생성
 
     pthread_join(thread_id, NULL); // 쓰레드 종료 대기
 
-    close(fd); // SPI 장치 닫기
+    adc_close(&adc); // SPI 장치 닫기
     return 0; // 프로그램 종료
 }
@@ -0,0 +1,127 @@
+#include <string.h>
+#include "light_filter.h"
+
+// 비율을 허용 범위로 맞추는 함수
+static uint32_t clamp_decimation(uint32_t decimation)
+{
+    if (decimation < 1)
+    {
+        decimation = 1;
+    }
+    if (decimation > LIGHT_MAX_DECIMATION)
+    {
+        decimation = LIGHT_MAX_DECIMATION;
+    }
+    return decimation;
+}
+
+// 비율과 CIC 이득을 정하는 함수
+static void set_ratio(struct light_filter* filter, uint32_t decimation)
+{
+    filter->decimation = decimation;
+
+    // CIC 이득 = decimation^단수
+    filter->gain = 1.0;
+    for (int i = 0; i < LIGHT_CIC_STAGES; i++)
+    {
+        filter->gain *= decimation;
+    }
+}
+
+// 필터 초기화 함수
+void light_filter_init(struct light_filter* filter, uint32_t decimation)
+{
+    memset(filter, 0, sizeof(*filter));
+    set_ratio(filter, clamp_decimation(decimation));
+    filter->settling = LIGHT_CIC_STAGES - 1; // 처음 단수-1개 출력은 0에서 시작한 미분기의 과도 구간
+}
+
+// 데시메이션 비율 변경 함수
+int light_filter_set_decimation(struct light_filter* filter, uint32_t decimation)
+{
+    decimation = clamp_decimation(decimation);
+    if (decimation == filter->decimation)
+    {
+        return 0;
+    }
+
+    // 적분기는 비율과 무관하게 이어지지만 미분기 지연 값은 이전 비율 간격이므로 단수만큼 출력해야 새 비율로 채워짐
+    set_ratio(filter, decimation);
+    filter->phase = 0;
+    filter->sum = 0;
+    filter->settling = LIGHT_CIC_STAGES;
+    return 1;
+}
+
+// 창의 중앙값 계산 함수 (창이 작아서 삽입 정렬로 충분함)
+static uint16_t window_median(const struct light_filter* filter)
+{
+    uint16_t sorted[LIGHT_MEDIAN_TAPS];
+    uint32_t n = filter->filled < LIGHT_MEDIAN_TAPS ? (uint32_t)filter->filled : LIGHT_MEDIAN_TAPS;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint16_t v = filter->window[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > v)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[n / 2];
+}
+
+// 샘플 입력 함수
+int light_filter_push(struct light_filter* filter, uint16_t sample, float* out)
+{
+    // 1. 이상값 제거 (창에 원본을 넣고, 중앙값에서 크게 벗어나면 중앙값으로 대체)
+    filter->window[filter->filled % LIGHT_MEDIAN_TAPS] = sample;
+    filter->filled++;
+    if (filter->filled >= LIGHT_MEDIAN_TAPS)
+    {
+        uint16_t median = window_median(filter);
+        int diff = (int)sample - (int)median;
+        if (diff > LIGHT_OUTLIER_LIMIT || diff < -LIGHT_OUTLIER_LIMIT)
+        {
+            sample = median;
+            filter->rejected++;
+        }
+    }
+
+    filter->sum += sample;
+
+    // 2. CIC 적분기 (입력 주기마다)
+    uint64_t acc = sample;
+    for (int i = 0; i < LIGHT_CIC_STAGES; i++)
+    {
+        filter->integrator[i] += acc;
+        acc = filter->integrator[i];
+    }
+    if (++filter->phase < filter->decimation)
+    {
+        return 0;
+    }
+    filter->phase = 0;
+
+    // 3. CIC 미분기 (출력 주기마다)
+    for (int i = 0; i < LIGHT_CIC_STAGES; i++)
+    {
+        uint64_t prev = filter->comb[i];
+        filter->comb[i] = acc;
+        acc -= prev;
+    }
+
+    // 미분기 지연 값이 채워지지 않은 과도 구간에는 CIC 대신 구간 평균을 냄 (시작이나 비율 변경 직후에도 값이 끊기지 않음)
+    if (filter->settling > 0)
+    {
+        filter->settling--;
+        *out = (float)((double)filter->sum / filter->decimation);
+    }
+    else
+    {
+        *out = (float)(acc / filter->gain);
+    }
+    filter->sum = 0;
+    return 1;
+}
@@ -0,0 +1,45 @@
+#ifndef LIGHT_FILTER_H
+#define LIGHT_FILTER_H
+
+#include <stdint.h>
+
+/*
+ * 조도 채널 데시메이션 필터
+ * 수백 Hz ~ kHz로 읽은 ADC 값을 채널마다 다음 순서로 처리해 출력 주기마다 한 값을 만듦
+ *  1. 이상값 제거: 최근 LIGHT_MEDIAN_TAPS개 샘플의 중앙값에서 LIGHT_OUTLIER_LIMIT 넘게 벗어난
+ *     샘플(SPI 잡음, 순간 반사광)은 중앙값으로 대체하고 개수를 셈
+ *  2. CIC 데시메이션: LIGHT_CIC_STAGES단 적분기-미분기로 decimation개마다 한 값 출력
+ *     (곱셈 없이 덧셈만 사용, 적분기는 uint64 순환 연산이라 넘쳐도 결과가 맞음)
+ * 출력은 CIC 이득(decimation^단수)으로 나눈 평균 ADC 값이라 기존 10회 평균과 같은 단위임
+ * 시작 직후나 비율을 바꾼 직후에는 미분기 지연 값이 새 비율로 채워질 때까지 그 구간의 단순 평균을 대신 냄
+ */
+#define LIGHT_MEDIAN_TAPS 5 // 이상값 판정용 중앙값 창 크기
+#define LIGHT_OUTLIER_LIMIT 64 // 중앙값과의 최대 허용 차이 (ADC 단위)
+#define LIGHT_CIC_STAGES 3 // CIC 단수
+#define LIGHT_MAX_DECIMATION 10000 // 최대 데시메이션 비율 (이득 10000^3 * 1023이 uint64에 들어감)
+
+// 채널 하나의 필터 상태
+struct light_filter
+{
+    uint32_t decimation; // 데시메이션 비율 (입력 샘플 수 / 출력 1개)
+    uint32_t phase; // 현재 출력 구간에서 받은 샘플 수
+    uint64_t integrator[LIGHT_CIC_STAGES]; // 적분기
+    uint64_t comb[LIGHT_CIC_STAGES]; // 미분기 지연 값
+    uint32_t settling; // 미분기 지연 값이 아직 채워지지 않은 남은 출력 수 (그동안은 구간 평균을 냄)
+    uint64_t sum; // 현재 출력 구간의 샘플 합 (이상값 대체 후)
+    double gain; // CIC 이득
+    uint16_t window[LIGHT_MEDIAN_TAPS]; // 최근 샘플
+    uint64_t filled; // 지금까지 받은 샘플 수
+    uint64_t rejected; // 대체한 이상값 수
+};
+
+// 필터 초기화 (decimation은 1 ~ LIGHT_MAX_DECIMATION)
+void light_filter_init(struct light_filter* filter, uint32_t decimation);
+
+// 데시메이션 비율 변경 (중앙값 창과 적분기는 유지, 비율이 같으면 아무것도 바꾸지 않고 0, 바꿨으면 1 반환)
+int light_filter_set_decimation(struct light_filter* filter, uint32_t decimation);
+
+// 샘플 하나 입력 (출력이 나오면 *out에 저장하고 1, 아니면 0 반환)
+int light_filter_push(struct light_filter* filter, uint16_t sample, float* out);
+
+#endif
@@ -0,0 +1,601 @@
+#define _GNU_SOURCE // getopt 등 사용을 위해 정의
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "protocol.h"
+
+/*
+ * 가상 센서 노드 부하 생성기
+ * 현장마다 DHT11/조도/PIR 노드를 하나씩 흉내 내며 실제 노드와 같은 바이너리 프레임을 보냄
+ * 서버를 WBGT_DECISION_ACK=1로 실행하면 판정 결과 프레임이 돌아오므로
+ * "측정값 전송"부터 "cal_wbgt 판정"까지의 지연 시간을 잴 수 있음
+ */
+#define SEQ_WINDOW 256 // 응답을 기다리는 시퀀스 번호 보관 개수 (노드별)
+#define RECV_BUFFER_SIZE 1024 // 노드별 수신 버퍼 크기
+#define SEND_BUFFER_SIZE 1024 // 노드별 미전송 버퍼 크기
+#define MAX_EVENTS 256 // epoll_wait 한 번에 처리할 최대 이벤트 수
+#define NODE_ID_BASE 100000 // 가상 노드 ID 시작값 (실제 노드 ID와 겹치지 않도록)
+#define NODES_PER_SITE 3 // 현장당 노드 수 (온습도, 조도, PIR)
+
+// 부하 설정
+struct config
+{
+    const char* host; // 서버 주소
+    int port; // 서버 포트
+    int sites; // 현장 수
+    double rate; // 노드당 초당 측정값 수
+    int burst; // 한 번에 몰아서 보내는 측정값 수
+    double churn; // 노드당 초당 연결 끊김 확률
+    double duration; // 실행 시간 (초)
+    double period; // WBGT 급상승 주기 (초, 0이면 급상승 없음)
+    double width; // 급상승 지속 시간 (초)
+    pid_t server_pid; // CPU/RSS를 측정할 서버 프로세스 (0이면 측정하지 않음)
+};
+
+// 가상 노드
+struct vnode
+{
+    int fd; // 소켓 (-1이면 연결 끊김)
+    uint32_t node_id; // 노드 ID
+    uint8_t type; // 센서 종류 (enum proto_type)
+    uint16_t site_id; // 현장 ID
+    uint32_t seq; // 다음 시퀀스 번호
+    uint64_t next_ns; // 다음 전송 시각
+    uint32_t sent_seq[SEQ_WINDOW]; // 응답 대기 중인 시퀀스 번호
+    uint64_t sent_ns[SEQ_WINDOW]; // 전송 시각
+    uint8_t sent_hot[SEQ_WINDOW]; // 급상승 구간의 측정값인지 여부
+    size_t rlen; // 수신 버퍼에 쌓인 바이트 수
+    uint8_t rbuf[RECV_BUFFER_SIZE]; // 수신 버퍼
+    size_t wlen; // 아직 보내지 못한 바이트 수
+    uint8_t wbuf[SEND_BUFFER_SIZE]; // 미전송 버퍼
+};
+
+// 지연 시간 표본 (us)
+struct samples
+{
+    uint32_t* v; // 표본 배열
+    size_t count; // 표본 수
+    size_t cap; // 배열 크기
+};
+
+// 누적 통계
+static struct
+{
+    uint64_t sent; // 보낸 측정값 수
+    uint64_t deferred; // 소켓 버퍼가 차서 미룬 측정값 수
+    uint64_t decisions; // 받은 판정 수
+    uint64_t alerts; // 알람 시작 판정 수
+    uint64_t disconnects; // 일부러 끊은 연결 수
+    uint64_t reconnects; // 재연결 수
+    uint64_t errors; // 연결 오류 수
+    struct samples all; // 모든 판정 지연
+    struct samples hot; // 급상승 구간 측정값의 판정 지연
+} stats;
+
+static volatile sig_atomic_t stop = 0; // Ctrl+C 시 중단
+
+// 단조 시각 (ns)
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 표본 추가 함수
+static void sample_add(struct samples* s, uint32_t value)
+{
+    if (s->count == s->cap)
+    {
+        size_t cap = s->cap ? s->cap * 2 : 65536;
+        uint32_t* v = realloc(s->v, cap * sizeof(*v));
+        if (v == NULL)
+        {
+            return; // 메모리가 부족하면 표본을 버림
+        }
+        s->v = v;
+        s->cap = cap;
+    }
+    s->v[s->count++] = value;
+}
+
+// 정렬 비교 함수
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// 백분위 지연 출력 함수
+static void print_latency(const char* name, struct samples* s)
+{
+    if (s->count == 0)
+    {
+        printf("%-8s latency: no samples\n", name);
+        return;
+    }
+    qsort(s->v, s->count, sizeof(s->v[0]), cmp_u32);
+    const double pct[] = {50, 90, 99, 99.9};
+    printf("%-8s latency (us, n=%zu):", name, s->count);
+    for (size_t i = 0; i < sizeof(pct) / sizeof(pct[0]); i++)
+    {
+        size_t idx = (size_t)(pct[i] / 100.0 * (s->count - 1));
+        printf(" p%g=%u", pct[i], s->v[idx]);
+    }
+    printf(" max=%u\n", s->v[s->count - 1]);
+}
+
+// 현장이 급상승 구간인지 확인하는 함수 (현장마다 위상을 달리해 알람이 한꺼번에 몰리지 않게 함)
+static int in_excursion(const struct config* cfg, const struct vnode* n, double elapsed)
+{
+    if (cfg->period <= 0)
+    {
+        return 0;
+    }
+    double phase = elapsed + cfg->period * (n->site_id % cfg->sites) / cfg->sites;
+    return (phase - cfg->period * (long)(phase / cfg->period)) < cfg->width;
+}
+
+// 급상승 직후인지 확인하는 함수 (PIR 노드가 알람 확인 모션을 보내는 구간)
+static int after_excursion(const struct config* cfg, const struct vnode* n, double elapsed)
+{
+    if (cfg->period <= 0)
+    {
+        return 0;
+    }
+    double phase = elapsed + cfg->period * (n->site_id % cfg->sites) / cfg->sites;
+    double t = phase - cfg->period * (long)(phase / cfg->period);
+    return t >= cfg->width && t < cfg->width + 1.0;
+}
+
+// 미전송 데이터를 보내는 함수 (모두 보내면 0, 남으면 1, 오류 시 -1)
+static int flush_node(struct vnode* n)
+{
+    while (n->wlen > 0)
+    {
+        ssize_t sent = send(n->fd, n->wbuf, n->wlen, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 1 : -1;
+        }
+        memmove(n->wbuf, n->wbuf + sent, n->wlen - sent);
+        n->wlen -= sent;
+    }
+    return 0;
+}
+
+// 노드 연결 함수 (연결 후 핸드셰이크 전송)
+static int connect_node(struct vnode* n, const struct config* cfg, int epfd)
+{
+    struct sockaddr_in addr;
+    int one = 1;
+
+    n->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (n->fd == -1)
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(cfg->port);
+    inet_pton(AF_INET, cfg->host, &addr.sin_addr);
+    if (connect(n->fd, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+    {
+        close(n->fd);
+        n->fd = -1;
+        return -1;
+    }
+    setsockopt(n->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 지연 측정이 Nagle에 묻히지 않도록 함
+    fcntl(n->fd, F_SETFL, fcntl(n->fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = n};
+    epoll_ctl(epfd, EPOLL_CTL_ADD, n->fd, &ev);
+
+    n->rlen = 0;
+    n->wlen = proto_encode_hello(n->wbuf, sizeof(n->wbuf), n->node_id, proto_now_ms(), n->type, n->site_id, 1);
+    return flush_node(n) == -1 ? -1 : 0;
+}
+
+// 노드 연결 끊기 함수
+static void disconnect_node(struct vnode* n)
+{
+    if (n->fd != -1)
+    {
+        close(n->fd); // close하면 epoll에서도 자동으로 빠짐
+        n->fd = -1;
+    }
+}
+
+// 측정값 하나를 만들어 보내는 함수
+static void send_reading(struct vnode* n, const struct config* cfg, double elapsed, uint64_t now)
+{
+    uint8_t frame[PROTO_MAX_FRAME];
+    size_t len = 0;
+    int hot = in_excursion(cfg, n, elapsed);
+    float jitter = (rand() % 21 - 10) / 10.0f; // -1.0 ~ 1.0
+
+    switch (n->type)
+    {
+    case PROTO_TEMP:
+        // 평상시 WBGT 약 10, 급상승 시 약 27
+        len = proto_encode_temp(frame, sizeof(frame), n->node_id, n->seq, proto_now_ms(), (hot ? 33.0f : 15.0f) + jitter, hot ? 70.0f : 40.0f);
+        break;
+    case PROTO_LIGHT:
+        len = proto_encode_light(frame, sizeof(frame), n->node_id, n->seq, proto_now_ms(), (hot ? 900 : 300) + (int)(jitter * 10));
+        break;
+    case PROTO_PIR:
+        len = proto_encode_pir(frame, sizeof(frame), n->node_id, n->seq, proto_now_ms(), after_excursion(cfg, n, elapsed));
+        break;
+    }
+    if (n->wlen + len > sizeof(n->wbuf))
+    {
+        stats.deferred++; // 서버가 따라오지 못해 소켓 버퍼가 찬 상태
+        return;
+    }
+
+    int slot = n->seq % SEQ_WINDOW;
+    n->sent_seq[slot] = n->seq;
+    n->sent_ns[slot] = now;
+    n->sent_hot[slot] = hot;
+    n->seq++;
+    memcpy(n->wbuf + n->wlen, frame, len);
+    n->wlen += len;
+    stats.sent++;
+}
+
+// 서버가 보낸 판정 결과를 읽는 함수
+static int read_node(struct vnode* n)
+{
+    struct proto_frame frame;
+    float wbgt;
+    int alert;
+    uint16_t site_id, zone_id;
+
+    for (;;)
+    {
+        ssize_t got = recv(n->fd, n->rbuf + n->rlen, sizeof(n->rbuf) - n->rlen, 0);
+        if (got == 0)
+        {
+            return -1;
+        }
+        if (got < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        n->rlen += got;
+
+        uint64_t now = now_ns();
+        size_t off = 0;
+        for (;;)
+        {
+            int used = proto_decode(n->rbuf + off, n->rlen - off, &frame);
+            if (used == PROTO_NEED_MORE)
+            {
+                break;
+            }
+            if (used == PROTO_BAD_FRAME)
+            {
+                off++;
+                continue;
+            }
+            off += used;
+            if (frame.type != PROTO_DECISION || proto_parse_decision(&frame, &wbgt, &alert, &site_id, &zone_id) == -1)
+            {
+                continue;
+            }
+
+            stats.decisions++;
+            stats.alerts += alert;
+            int slot = frame.seq % SEQ_WINDOW;
+            if (n->sent_seq[slot] == frame.seq && n->sent_ns[slot] != 0)
+            {
+                uint32_t us = (now - n->sent_ns[slot]) / 1000;
+                sample_add(&stats.all, us);
+                if (n->sent_hot[slot])
+                {
+                    sample_add(&stats.hot, us);
+                }
+                n->sent_ns[slot] = 0; // 같은 측정값에 대한 중복 계산 방지
+            }
+        }
+        memmove(n->rbuf, n->rbuf + off, n->rlen - off);
+        n->rlen -= off;
+    }
+}
+
+// 서버 프로세스의 CPU 시간(초)과 RSS(kB)를 읽는 함수
+static int read_proc(pid_t pid, double* cpu_s, long* rss_kb)
+{
+    char path[64], buf[1024];
+    unsigned long utime, stime;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    // 프로세스 이름에 공백이 있을 수 있으므로 마지막 ')' 뒤부터 해석 (utime, stime은 14, 15번째 필드)
+    char* p = strrchr(buf, ')');
+    if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+    {
+        return -1;
+    }
+    *cpu_s = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    *rss_kb = 0;
+    while (fgets(buf, sizeof(buf), f) != NULL)
+    {
+        if (sscanf(buf, "VmRSS: %ld", rss_kb) == 1)
+        {
+            break;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// 시그널 처리 함수
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+// 사용법 출력 함수
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -H host     server address (default 127.0.0.1)\n"
+            "  -p port     server port (default 8080)\n"
+            "  -s sites    number of sites, 3 nodes each (default 10)\n"
+            "  -r rate     readings per second per node (default 1)\n"
+            "  -b burst    readings sent back to back per burst (default 1)\n"
+            "  -c churn    disconnect probability per node per second (default 0)\n"
+            "  -d seconds  run time (default 10)\n"
+            "  -x seconds  WBGT excursion period per site, 0 = none (default 0)\n"
+            "  -w seconds  excursion width (default 2)\n"
+            "  -P pid      server pid for CPU/RSS sampling\n",
+            prog);
+}
+
+// 메인 함수
+int main(int argc, char* argv[])
+{
+    struct config cfg = {.host = "127.0.0.1", .port = 8080, .sites = 10, .rate = 1, .burst = 1, .churn = 0, .duration = 10, .period = 0, .width = 2, .server_pid = 0};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "H:p:s:r:b:c:d:x:w:P:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H': cfg.host = optarg; break;
+        case 'p': cfg.port = atoi(optarg); break;
+        case 's': cfg.sites = atoi(optarg); break;
+        case 'r': cfg.rate = atof(optarg); break;
+        case 'b': cfg.burst = atoi(optarg); break;
+        case 'c': cfg.churn = atof(optarg); break;
+        case 'd': cfg.duration = atof(optarg); break;
+        case 'x': cfg.period = atof(optarg); break;
+        case 'w': cfg.width = atof(optarg); break;
+        case 'P': cfg.server_pid = atoi(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (cfg.sites <= 0 || cfg.rate <= 0 || cfg.burst <= 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    // 노드 수만큼 파일 디스크립터 제한 상향
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int count = cfg.sites * NODES_PER_SITE;
+    struct vnode* nodes = calloc(count, sizeof(*nodes));
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (nodes == NULL || epfd == -1)
+    {
+        perror("setup failed");
+        return 1;
+    }
+
+    // 가상 노드 연결 (전송 시각은 노드마다 흩어 놓음)
+    uint64_t start = now_ns();
+    uint64_t interval_ns = (uint64_t)(1e9 * cfg.burst / cfg.rate); // 버스트 간격
+    const uint8_t types[NODES_PER_SITE] = {PROTO_TEMP, PROTO_LIGHT, PROTO_PIR};
+    for (int i = 0; i < count; i++)
+    {
+        struct vnode* n = &nodes[i];
+        n->node_id = NODE_ID_BASE + i;
+        n->type = types[i % NODES_PER_SITE];
+        n->site_id = 1 + i / NODES_PER_SITE;
+        n->next_ns = start + interval_ns * i / count;
+        if (connect_node(n, &cfg, epfd) == -1)
+        {
+            fprintf(stderr, "Failed to connect node %u: %s\n", n->node_id, strerror(errno));
+            return 1;
+        }
+    }
+    printf("%d nodes connected (%d sites)\n", count, cfg.sites);
+
+    double cpu0 = 0, cpu_prev = 0;
+    long rss = 0, rss_peak = 0;
+    if (cfg.server_pid > 0)
+    {
+        read_proc(cfg.server_pid, &cpu0, &rss);
+        cpu_prev = cpu0;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t end = start + (uint64_t)(cfg.duration * 1e9);
+    uint64_t next_report = start + 1000000000ull;
+    uint64_t prev_sent = 0, prev_decisions = 0, last_churn = start;
+
+    while (!stop)
+    {
+        uint64_t now = now_ns();
+        if (now >= end)
+        {
+            break;
+        }
+        double elapsed = (now - start) / 1e9;
+
+        // 연결 끊김 시뮬레이션 (끊은 노드는 다음 전송 시각에 다시 연결)
+        if (cfg.churn > 0 && now - last_churn >= 100000000ull)
+        {
+            double p = cfg.churn * (now - last_churn) / 1e9;
+            for (int i = 0; i < count; i++)
+            {
+                if (nodes[i].fd != -1 && rand() < p * RAND_MAX)
+                {
+                    disconnect_node(&nodes[i]);
+                    stats.disconnects++;
+                }
+            }
+            last_churn = now;
+        }
+
+        // 전송할 차례인 노드 처리
+        for (int i = 0; i < count; i++)
+        {
+            struct vnode* n = &nodes[i];
+            if (n->fd == -1)
+            {
+                if (now < n->next_ns)
+                {
+                    continue;
+                }
+                if (connect_node(n, &cfg, epfd) == -1)
+                {
+                    disconnect_node(n);
+                    stats.errors++;
+                    n->next_ns = now + interval_ns;
+                    continue;
+                }
+                stats.reconnects++;
+            }
+            if (now >= n->next_ns)
+            {
+                for (int b = 0; b < cfg.burst; b++)
+                {
+                    send_reading(n, &cfg, elapsed, now);
+                }
+                n->next_ns += interval_ns;
+                if (n->next_ns < now)
+                {
+                    n->next_ns = now + interval_ns; // 밀린 전송은 따라잡지 않고 건너뜀
+                }
+            }
+            if (n->wlen > 0 && flush_node(n) == -1)
+            {
+                disconnect_node(n);
+                stats.errors++;
+            }
+        }
+
+        // 판정 결과 수신 (다음 전송까지 최대 1ms 대기)
+        int ready = epoll_wait(epfd, events, MAX_EVENTS, 1);
+        for (int i = 0; i < ready; i++)
+        {
+            struct vnode* n = events[i].data.ptr;
+            if (n->fd != -1 && read_node(n) == -1)
+            {
+                disconnect_node(n);
+                stats.errors++;
+            }
+        }
+
+        // 1초마다 진행 상황 출력
+        if (now >= next_report)
+        {
+            double cpu = 0;
+            printf("[%5.1fs] sent %llu/s, decisions %llu/s", elapsed, (unsigned long long)(stats.sent - prev_sent), (unsigned long long)(stats.decisions - prev_decisions));
+            if (cfg.server_pid > 0 && read_proc(cfg.server_pid, &cpu, &rss) == 0)
+            {
+                printf(", server cpu %.0f%%, rss %ld kB", (cpu - cpu_prev) * 100.0, rss);
+                cpu_prev = cpu;
+                if (rss > rss_peak)
+                {
+                    rss_peak = rss;
+                }
+            }
+            printf("\n");
+            prev_sent = stats.sent;
+            prev_decisions = stats.decisions;
+            next_report += 1000000000ull;
+        }
+    }
+
+    // 남은 판정 결과를 잠시 더 수신
+    uint64_t drain_end = now_ns() + 200000000ull;
+    while (now_ns() < drain_end)
+    {
+        int ready = epoll_wait(epfd, events, MAX_EVENTS, 10);
+        for (int i = 0; i < ready; i++)
+        {
+            struct vnode* n = events[i].data.ptr;
+            if (n->fd != -1 && read_node(n) == -1)
+            {
+                disconnect_node(n);
+            }
+        }
+    }
+
+    // 결과 요약
+    double secs = (now_ns() - start) / 1e9;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("\n=== summary (%.1fs, %d nodes) ===\n", secs, count);
+    printf("ingest   : %llu readings, %.0f msgs/sec, %llu deferred (socket full)\n", (unsigned long long)stats.sent, stats.sent / secs, (unsigned long long)stats.deferred);
+    printf("decisions: %llu (%llu alerts)\n", (unsigned long long)stats.decisions, (unsigned long long)stats.alerts);
+    printf("churn    : %llu disconnects, %llu reconnects, %llu errors\n", (unsigned long long)stats.disconnects, (unsigned long long)stats.reconnects, (unsigned long long)stats.errors);
+    print_latency("all", &stats.all);
+    print_latency("hot", &stats.hot);
+    if (cfg.server_pid > 0)
+    {
+        double cpu = cpu_prev;
+        read_proc(cfg.server_pid, &cpu, &rss);
+        printf("server   : cpu %.1f%% avg, rss %ld kB (peak sampled %ld kB)\n", (cpu - cpu0) * 100.0 / secs, rss, rss > rss_peak ? rss : rss_peak);
+    }
+    printf("loadgen  : cpu %.1f%% avg\n", (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6) * 100.0 / secs);
+
+    for (int i = 0; i < count; i++)
+    {
+        disconnect_node(&nodes[i]);
+    }
+    free(nodes);
+    free(stats.all.v);
+    free(stats.hot.v);
+    close(epfd);
+    return 0;
+}
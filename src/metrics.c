@@ -0,0 +1,404 @@
+#define _GNU_SOURCE // open_memstream 사용을 위해 정의
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "metrics.h"
+#include "protocol.h"
+#include "registry.h"
+#include "shard.h"
+#include "pipeline.h"
+
+#define SUB_BITS 4 // 2의 거듭제곱 구간당 하위 구간 비트 수
+#define SUB_COUNT (1 << SUB_BITS) // 2의 거듭제곱 구간당 하위 구간 수
+#define MAX_BITS 40 // 기록할 수 있는 최대 값 (2^40 ns, 약 18분)
+#define HIST_BUCKETS ((MAX_BITS - SUB_BITS + 1) * SUB_COUNT) // 히스토그램 구간 수
+#define EXPORT_MIN_BITS 10 // 내보낼 le 경계의 시작 (2^10 ns, 약 1us)
+
+// 히스토그램 (쓰레드 하나만 기록)
+struct histogram
+{
+    atomic_uint_least64_t sum; // 값의 합 (ns)
+    atomic_uint_least64_t buckets[HIST_BUCKETS]; // 구간별 기록 수
+};
+
+// 쓰레드별 계측 영역
+struct metrics_shard
+{
+    atomic_uint_least64_t counters[METRIC_COUNTERS]; // 카운터
+    struct histogram histograms[METRIC_HISTOGRAMS]; // 지연 히스토그램
+    struct metrics_shard* next; // 다음 쓰레드 영역
+};
+
+// 내보낼 이름과 설명
+static const char* const counter_names[METRIC_COUNTERS][2] = {
+    {"wbgt_connections_accepted_total", "Accepted sensor connections"},
+    {"wbgt_disconnects_total", "Closed sensor connections"},
+    {"wbgt_frames_total", "Binary frames processed"},
+    {"wbgt_text_messages_total", "Text messages processed"},
+    {"wbgt_parse_failures_total", "Messages whose payload could not be parsed"},
+    {"wbgt_resyncs_total", "Bad frames skipped by resynchronizing on the magic byte"},
+    {"wbgt_unregistered_drops_total", "Messages dropped because the node was not registered"},
+    {"wbgt_decisions_total", "WBGT decisions made in cal_wbgt"},
+    {"wbgt_alerts_raised_total", "WBGT exceedances sent to the alert scheduler"},
+    {"wbgt_alerts_started_total", "Alerts started by the alert scheduler"},
+    {"wbgt_pir_transitions_total", "PIR motion state changes"},
+    {"wbgt_pir_missed_transitions_total", "PIR state changes first seen in a heartbeat"},
+    {"wbgt_backlog_frames_total", "Delayed readings replayed by nodes and written to history only"},
+    {"wbgt_batches_total", "Batch frames received"},
+    {"wbgt_datagrams_total", "UDP datagrams received"},
+    {"wbgt_recvmmsg_calls_total", "recvmmsg calls that returned datagrams"},
+};
+static const char* const histogram_names[METRIC_HISTOGRAMS][2] = {
+    {"wbgt_recv_to_parse_seconds", "Time from recv() returning to the payload being parsed"},
+    {"wbgt_parse_to_decision_seconds", "Time from payload parsed to the WBGT decision"},
+    {"wbgt_decision_to_alert_seconds", "Time from a WBGT exceedance to the alert starting"},
+    {"wbgt_alert_duration_seconds", "Time an alert stayed active"},
+};
+
+static _Atomic(struct metrics_shard*) shards = NULL; // 모든 쓰레드 영역 목록 (추가만 함)
+static __thread struct metrics_shard* local = NULL; // 현재 쓰레드 영역
+
+// 현재 쓰레드 영역을 구하는 함수 (처음 호출 시 할당해 목록에 추가)
+static struct metrics_shard* shard(void)
+{
+    if (local == NULL)
+    {
+        static struct metrics_shard fallback; // 할당 실패 시 공용 영역 사용 (값이 조금 틀려질 수 있음)
+        struct metrics_shard* s = calloc(1, sizeof(*s));
+        if (s == NULL)
+        {
+            local = &fallback;
+            return local;
+        }
+        s->next = atomic_load(&shards);
+        while (!atomic_compare_exchange_weak(&shards, &s->next, s))
+        {
+        }
+        local = s;
+    }
+    return local;
+}
+
+// 자기 쓰레드만 쓰는 값을 증가시키는 함수 (lock 접두 명령 없이 읽고 씀)
+static inline void bump(atomic_uint_least64_t* value, uint64_t n)
+{
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// 값을 히스토그램 구간 번호로 바꾸는 함수
+static int bucket_of(uint64_t ns)
+{
+    if (ns < SUB_COUNT)
+    {
+        return (int)ns;
+    }
+    if (ns >= (1ull << MAX_BITS))
+    {
+        ns = (1ull << MAX_BITS) - 1;
+    }
+    int e = 63 - __builtin_clzll(ns); // 최상위 비트 위치
+    int sub = (ns >> (e - SUB_BITS)) & (SUB_COUNT - 1);
+    return (e - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+// 구간의 상한 값 (ns, 포함하지 않음)
+static uint64_t bucket_upper(int index)
+{
+    if (index < SUB_COUNT)
+    {
+        return index + 1;
+    }
+    int e = index / SUB_COUNT + SUB_BITS - 1;
+    int sub = index % SUB_COUNT;
+    return (uint64_t)(SUB_COUNT + sub + 1) << (e - SUB_BITS);
+}
+
+// 단조 시계 기준 현재 시각 함수
+uint64_t metrics_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 카운터 증가 함수
+void metrics_count(enum metric_counter counter)
+{
+    bump(&shard()->counters[counter], 1);
+}
+
+// 히스토그램 기록 함수
+void metrics_record(enum metric_histogram histogram, uint64_t ns)
+{
+    struct histogram* h = &shard()->histograms[histogram];
+    bump(&h->buckets[bucket_of(ns)], 1);
+    bump(&h->sum, ns);
+}
+
+// 노드 종류 이름
+static const char* type_name(uint8_t type)
+{
+    switch (type)
+    {
+    case PROTO_TEMP:
+        return "temp";
+    case PROTO_LIGHT:
+        return "light";
+    case PROTO_PIR:
+        return "pir";
+    case PROTO_WBGT:
+        return "wbgt";
+    default:
+        return "unknown";
+    }
+}
+
+// 노드별 메시지 수를 내보내는 함수
+static void write_node(const struct sensor_node* node, void* arg)
+{
+    fprintf((FILE*)arg, "wbgt_node_messages_total{node=\"%u\",site=\"%u\",zone=\"%u\",type=\"%s\"} %llu\n", node->node_id, node->site_id, node->zone_id, type_name(node->type), (unsigned long long)atomic_load_explicit(&node->messages, memory_order_relaxed));
+}
+
+// UDP 노드별 수신 프레임 수를 내보내는 함수 (TCP로만 연결된 노드는 건너뜀)
+static void write_node_datagrams(const struct sensor_node* node, void* arg)
+{
+    uint64_t frames = atomic_load_explicit(&node->datagram_frames, memory_order_relaxed);
+    if (frames > 0)
+    {
+        fprintf((FILE*)arg, "wbgt_node_datagram_frames_total{node=\"%u\"} %llu\n", node->node_id, (unsigned long long)frames);
+    }
+}
+
+// UDP 노드별 손실 프레임 수를 내보내는 함수
+static void write_node_datagram_loss(const struct sensor_node* node, void* arg)
+{
+    if (atomic_load_explicit(&node->datagram_frames, memory_order_relaxed) > 0)
+    {
+        fprintf((FILE*)arg, "wbgt_node_datagram_lost_total{node=\"%u\"} %llu\n", node->node_id, (unsigned long long)atomic_load_explicit(&node->datagram_lost, memory_order_relaxed));
+    }
+}
+
+// 모든 쓰레드 영역을 합쳐 Prometheus text 형식으로 쓰는 함수
+static void write_metrics(FILE* out)
+{
+    static uint64_t buckets[HIST_BUCKETS]; // 합산용 (조회 쓰레드만 사용)
+
+    for (int c = 0; c < METRIC_COUNTERS; c++)
+    {
+        uint64_t total = 0;
+        for (struct metrics_shard* s = atomic_load(&shards); s != NULL; s = s->next)
+        {
+            total += atomic_load_explicit(&s->counters[c], memory_order_relaxed);
+        }
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", counter_names[c][0], counter_names[c][1], counter_names[c][0], counter_names[c][0], (unsigned long long)total);
+    }
+
+    for (int h = 0; h < METRIC_HISTOGRAMS; h++)
+    {
+        const char* name = histogram_names[h][0];
+        uint64_t sum = 0;
+        memset(buckets, 0, sizeof(buckets));
+        for (struct metrics_shard* s = atomic_load(&shards); s != NULL; s = s->next)
+        {
+            const struct histogram* src = &s->histograms[h];
+            for (int b = 0; b < HIST_BUCKETS; b++)
+            {
+                buckets[b] += atomic_load_explicit(&src->buckets[b], memory_order_relaxed);
+            }
+            sum += atomic_load_explicit(&src->sum, memory_order_relaxed);
+        }
+
+        // Prometheus 히스토그램: 2의 거듭제곱 경계마다 누적 값 (하위 구간 경계와 정확히 맞음)
+        fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_names[h][1], name);
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (int bits = EXPORT_MIN_BITS; bits <= MAX_BITS; bits++)
+        {
+            while (b < HIST_BUCKETS && bucket_upper(b) <= (1ull << bits))
+            {
+                cumulative += buckets[b++];
+            }
+            fprintf(out, "%s_bucket{le=\"%g\"} %llu\n", name, (double)(1ull << bits) / 1e9, (unsigned long long)cumulative);
+        }
+        // 기록 도중에 읽으면 구간 합과 count가 잠깐 어긋날 수 있으므로 +Inf는 구간 합을 사용
+        while (b < HIST_BUCKETS)
+        {
+            cumulative += buckets[b++];
+        }
+        fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9f\n%s_count %llu\n", name, (unsigned long long)cumulative, name, sum / 1e9, name, (unsigned long long)cumulative);
+
+        // 세밀한 구간으로 계산한 백분위 (구간 상한 값이므로 실제 값보다 최대 약 6% 큼)
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        fprintf(out, "# HELP %s_quantile %s (percentile from HDR buckets)\n# TYPE %s_quantile gauge\n", name, histogram_names[h][1], name);
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        {
+            uint64_t rank = (uint64_t)(quantiles[q] * cumulative + 0.5), seen = 0;
+            double value = 0;
+            for (int i = 0; i < HIST_BUCKETS && cumulative > 0; i++)
+            {
+                seen += buckets[i];
+                if (seen >= rank && seen > 0)
+                {
+                    value = bucket_upper(i) / 1e9;
+                    break;
+                }
+            }
+            fprintf(out, "%s_quantile{quantile=\"%g\"} %.9f\n", name, quantiles[q], value);
+        }
+    }
+
+    fprintf(out, "# HELP wbgt_node_messages_total Measurement messages received per node\n# TYPE wbgt_node_messages_total counter\n");
+    registry_foreach(write_node, out);
+    fprintf(out, "# HELP wbgt_node_datagram_frames_total Frames received over UDP per node\n# TYPE wbgt_node_datagram_frames_total counter\n");
+    registry_foreach(write_node_datagrams, out);
+    fprintf(out, "# HELP wbgt_node_datagram_lost_total UDP frames missing from each node's sequence numbers\n# TYPE wbgt_node_datagram_lost_total counter\n");
+    registry_foreach(write_node_datagram_loss, out);
+
+    // shard별 부하 (shard가 하나면 전체와 같음)
+    static const char* const shard_names[SHARD_STATS][3] = {
+        {"wbgt_shard_connections", "gauge", "Sensor connections handled by each shard"},
+        {"wbgt_shard_messages_total", "counter", "Messages processed by each shard"},
+        {"wbgt_shard_handoffs_total", "counter", "Connections handed to the shard owning their site"},
+        {"wbgt_shard_sites", "gauge", "Sites owned by each shard with a WBGT decision"},
+        {"wbgt_shard_sites_over_limit", "gauge", "Sites owned by each shard whose last WBGT is at or above the limit"},
+    };
+    for (int s = 0; s < SHARD_STATS; s++)
+    {
+        fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", shard_names[s][0], shard_names[s][2], shard_names[s][0], shard_names[s][1]);
+        for (int i = 0; i < shard_count(); i++)
+        {
+            fprintf(out, "%s{shard=\"%d\"} %lld\n", shard_names[s][0], i, (long long)shard_value(i, s));
+        }
+    }
+
+    // 모든 shard를 합친 현장 전체 보기
+    int64_t totals[SHARD_STATS];
+    shard_totals(totals);
+    fprintf(out, "# HELP wbgt_sites Sites with a WBGT decision\n# TYPE wbgt_sites gauge\nwbgt_sites %lld\n", (long long)totals[SHARD_SITES]);
+    fprintf(out, "# HELP wbgt_sites_over_limit Sites whose last WBGT is at or above the limit\n# TYPE wbgt_sites_over_limit gauge\nwbgt_sites_over_limit %lld\n", (long long)totals[SHARD_SITES_OVER_LIMIT]);
+
+    // 처리 단계별 backpressure (dropped가 늘면 해당 단계가 수신 속도를 따라오지 못함)
+    static const char* const stage_names[4][3] = {
+        {"wbgt_stage_queued_total", "counter", "Items handed to each pipeline stage"},
+        {"wbgt_stage_dropped_total", "counter", "Items dropped because a stage queue was full"},
+        {"wbgt_stage_wakeups_total", "counter", "Times a sleeping stage thread was woken"},
+        {"wbgt_stage_depth", "gauge", "Items waiting in each pipeline stage"},
+    };
+    for (int m = 0; m < 4; m++)
+    {
+        fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", stage_names[m][0], stage_names[m][2], stage_names[m][0], stage_names[m][1]);
+        for (int i = 0; i < pipeline_stage_count(); i++)
+        {
+            struct pipeline_stage* stage = pipeline_stage_at(i);
+            uint64_t value = m == 0 ? atomic_load(&stage->queued) : m == 1 ? atomic_load(&stage->dropped) : m == 2 ? atomic_load(&stage->wakeups) : pipeline_depth(stage);
+            fprintf(out, "%s{stage=\"%s\"} %llu\n", stage_names[m][0], stage->name, (unsigned long long)value);
+        }
+    }
+}
+
+// 조회 요청 하나를 처리하는 함수
+static void serve(int fd)
+{
+    char request[1024];
+    char* body = NULL;
+    size_t body_len = 0;
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+
+    // 요청 내용과 관계없이 항상 전체 계측값을 돌려줌
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (recv(fd, request, sizeof(request), 0) <= 0)
+    {
+        return;
+    }
+
+    FILE* out = open_memstream(&body, &body_len);
+    if (out == NULL)
+    {
+        return;
+    }
+    write_metrics(out);
+    fclose(out);
+
+    char header[128];
+    int header_len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", body_len);
+    if (send(fd, header, header_len, MSG_NOSIGNAL) == header_len)
+    {
+        for (size_t off = 0; off < body_len;)
+        {
+            ssize_t sent = send(fd, body + off, body_len - off, MSG_NOSIGNAL);
+            if (sent <= 0)
+            {
+                break;
+            }
+            off += sent;
+        }
+    }
+    free(body);
+}
+
+// 조회용 HTTP 쓰레드 함수
+static void* metrics_thread(void* arg)
+{
+    int server_sock = (int)(intptr_t)arg;
+    while (1)
+    {
+        int fd = accept(server_sock, NULL, NULL);
+        if (fd == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("metrics accept failed");
+            break;
+        }
+        serve(fd);
+        close(fd);
+    }
+    close(server_sock);
+    return NULL;
+}
+
+// 조회용 HTTP 쓰레드 시작 함수
+int metrics_start(int port)
+{
+    struct sockaddr_in addr;
+    int opt = 1;
+    pthread_t tid;
+
+    int server_sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server_sock == -1)
+    {
+        perror("metrics socket failed");
+        return -1;
+    }
+    setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 외부에서는 접속할 수 없도록 루프백에만 바인딩
+    if (bind(server_sock, (struct sockaddr*)&addr, sizeof(addr)) == -1 || listen(server_sock, 16) == -1)
+    {
+        perror("metrics bind failed");
+        close(server_sock);
+        return -1;
+    }
+
+    if (pthread_create(&tid, NULL, metrics_thread, (void*)(intptr_t)server_sock) != 0)
+    {
+        perror("pthread_create failed");
+        close(server_sock);
+        return -1;
+    }
+    pthread_detach(tid);
+    printf("Metrics available at http://127.0.0.1:%d/metrics\n", port);
+    return 0;
+}
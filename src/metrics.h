@@ -0,0 +1,59 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+/*
+ * 처리 경로 계측 모듈
+ * 카운터와 지연 히스토그램은 쓰레드별 영역에 기록하므로 기록할 때 락이나 원자적 read-modify-write가 없음
+ * (각 영역은 자기 쓰레드만 쓰고, 조회 요청이 오면 모든 쓰레드 영역을 더해서 내보냄)
+ * 히스토그램은 HDR 방식으로 2의 거듭제곱 구간마다 16개 하위 구간을 두어 상대 오차가 약 6% 이내
+ * 127.0.0.1:METRICS_PORT에 HTTP로 접속하면 Prometheus text 형식으로 내보냄
+ */
+#define METRICS_PORT 9464 // 계측값 조회 포트 (로컬에서만 접속 가능)
+
+// 카운터 종류
+enum metric_counter
+{
+    METRIC_ACCEPTS, // 수락한 연결 수
+    METRIC_DISCONNECTS, // 종료된 연결 수
+    METRIC_FRAMES, // 처리한 바이너리 프레임 수
+    METRIC_TEXT_MESSAGES, // 처리한 텍스트 메시지 수
+    METRIC_PARSE_FAILURES, // payload 해석 실패 수
+    METRIC_RESYNCS, // 잘못된 프레임으로 재동기화한 횟수
+    METRIC_UNREGISTERED, // 등록되지 않은 노드라 버린 메시지 수
+    METRIC_DECISIONS, // WBGT 판정 수
+    METRIC_ALERTS_RAISED, // 알람 스케줄러에 보낸 WBGT 초과 요청 수
+    METRIC_ALERTS_STARTED, // 새로 시작된 알람 수
+    METRIC_PIR_TRANSITIONS, // PIR 상태 변화 수
+    METRIC_PIR_MISSED, // heartbeat로 알게 된 놓친 PIR 상태 변화 수
+    METRIC_BACKLOG_FRAMES, // 이력에만 기록한 밀린 측정 프레임 수
+    METRIC_BATCHES, // 받은 측정 묶음 프레임 수
+    METRIC_DATAGRAMS, // 받은 UDP 데이터그램 수
+    METRIC_RECVMMSG_CALLS, // 데이터그램을 받아 온 recvmmsg 호출 수
+    METRIC_COUNTERS
+};
+
+// 지연 히스토그램 종류 (단위 ns)
+enum metric_histogram
+{
+    METRIC_RECV_TO_PARSE, // 수신 완료 -> payload 해석 완료
+    METRIC_PARSE_TO_WBGT, // payload 해석 완료 -> WBGT 판정 완료
+    METRIC_WBGT_TO_ALERT, // WBGT 초과 판정 -> 알람 시작
+    METRIC_ALERT_DURATION, // 알람 시작 -> 종료
+    METRIC_HISTOGRAMS
+};
+
+// 단조 시계 기준 현재 시각 (ns)
+uint64_t metrics_now_ns(void);
+
+// 카운터 증가
+void metrics_count(enum metric_counter counter);
+
+// 히스토그램에 값 기록
+void metrics_record(enum metric_histogram histogram, uint64_t ns);
+
+// 조회용 HTTP 쓰레드 시작
+int metrics_start(int port);
+
+#endif
@@ -0,0 +1,182 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "pipeline.h"
+
+static struct pipeline_stage* stages[PIPELINE_STAGES]; // 초기화된 단계 목록 (쓰레드 시작 전에만 추가)
+static int stage_count = 0;
+static atomic_int next_producer = 0; // 다음 생산자 번호
+static __thread int producer = -1; // 현재 쓰레드의 생산자 번호 (모든 단계에서 같은 번호 사용)
+
+// 단계 초기화 함수
+int pipeline_init(struct pipeline_stage* stage, const char* name, size_t item_size, size_t capacity)
+{
+    memset(stage, 0, sizeof(*stage));
+    stage->name = name;
+    stage->item_size = item_size;
+    stage->capacity = 1;
+    while (stage->capacity < capacity)
+    {
+        stage->capacity <<= 1; // 위치 계산을 나머지 대신 비트 마스크로 하기 위해 2의 거듭제곱
+    }
+    stage->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stage->wake_fd == -1)
+    {
+        perror("pipeline eventfd failed");
+        return -1;
+    }
+    if (stage_count < PIPELINE_STAGES)
+    {
+        stages[stage_count++] = stage;
+    }
+    return 0;
+}
+
+// 현재 쓰레드의 링을 구하는 함수 (처음이면 생성해 소비 쓰레드에 공개)
+static struct spsc_ring* producer_ring(struct pipeline_stage* stage)
+{
+    if (producer == -1)
+    {
+        producer = atomic_fetch_add(&next_producer, 1);
+    }
+    if (producer >= PIPELINE_PRODUCERS)
+    {
+        return NULL;
+    }
+    struct spsc_ring* ring = atomic_load_explicit(&stage->rings[producer], memory_order_relaxed);
+    if (ring == NULL)
+    {
+        ring = aligned_alloc(64, sizeof(*ring));
+        uint8_t* slots = malloc(stage->capacity * stage->item_size);
+        if (ring == NULL || slots == NULL)
+        {
+            free(ring);
+            free(slots);
+            return NULL;
+        }
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        ring->slots = slots;
+        atomic_store_explicit(&stage->rings[producer], ring, memory_order_release);
+    }
+    return ring;
+}
+
+// 항목 넣기 함수
+int pipeline_push(struct pipeline_stage* stage, const void* item)
+{
+    struct spsc_ring* ring = producer_ring(stage);
+    if (ring == NULL)
+    {
+        atomic_fetch_add_explicit(&stage->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == stage->capacity)
+    {
+        atomic_fetch_add_explicit(&stage->dropped, 1, memory_order_relaxed); // 소비 단계가 따라오지 못함
+        return -1;
+    }
+    memcpy(ring->slots + (head & (stage->capacity - 1)) * stage->item_size, item, stage->item_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release); // 소비자에게 공개
+    atomic_fetch_add_explicit(&stage->queued, 1, memory_order_relaxed);
+
+    // 소비 쓰레드가 잠들었으면 깨움 (head 공개와 sleeping 확인 사이의 순서를 보장)
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&stage->sleeping, memory_order_relaxed) && atomic_exchange(&stage->sleeping, 0))
+    {
+        uint64_t one = 1;
+        if (write(stage->wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+        {
+            perror("pipeline wakeup failed");
+        }
+        atomic_fetch_add_explicit(&stage->wakeups, 1, memory_order_relaxed);
+    }
+    return 0;
+}
+
+// 쌓인 항목 처리 함수
+size_t pipeline_drain(struct pipeline_stage* stage, pipeline_handler handler, void* arg, size_t max)
+{
+    size_t total = 0;
+    int producers = atomic_load(&next_producer);
+    if (producers > PIPELINE_PRODUCERS)
+    {
+        producers = PIPELINE_PRODUCERS;
+    }
+
+    for (int p = 0; p < producers; p++)
+    {
+        struct spsc_ring* ring = atomic_load_explicit(&stage->rings[p], memory_order_acquire);
+        if (ring == NULL)
+        {
+            continue;
+        }
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t n = 0;
+        while (tail != head && n < max)
+        {
+            handler(ring->slots + (tail & (stage->capacity - 1)) * stage->item_size, arg); // 링 안에서 바로 처리 (복사 없음)
+            tail++;
+            n++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release); // 처리한 자리를 생산자에게 돌려줌
+        total += n;
+    }
+    return total;
+}
+
+// 쌓여 있는 항목 수 반환 함수
+size_t pipeline_depth(struct pipeline_stage* stage)
+{
+    size_t depth = 0;
+    for (int p = 0; p < PIPELINE_PRODUCERS; p++)
+    {
+        struct spsc_ring* ring = atomic_load_explicit(&stage->rings[p], memory_order_acquire);
+        if (ring != NULL)
+        {
+            depth += atomic_load_explicit(&ring->head, memory_order_acquire) - atomic_load_explicit(&ring->tail, memory_order_acquire);
+        }
+    }
+    return depth;
+}
+
+// 항목 대기 함수
+void pipeline_wait(struct pipeline_stage* stage, int timeout_ms)
+{
+    // 잠든다고 알린 뒤에 다시 확인해야 그 사이에 들어온 항목을 놓치지 않음
+    atomic_store(&stage->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (pipeline_depth(stage) == 0)
+    {
+        struct pollfd pfd = {.fd = stage->wake_fd, .events = POLLIN};
+        if (poll(&pfd, 1, timeout_ms) > 0)
+        {
+            uint64_t value;
+            if (read(stage->wake_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+            {
+                perror("pipeline wakeup read failed");
+            }
+        }
+    }
+    atomic_store(&stage->sleeping, 0);
+}
+
+// 초기화된 단계 수 반환 함수
+int pipeline_stage_count(void)
+{
+    return stage_count;
+}
+
+// 단계 조회 함수
+struct pipeline_stage* pipeline_stage_at(int index)
+{
+    return stages[index];
+}
@@ -0,0 +1,62 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 처리 단계 사이의 락 없는 큐
+ * 단계 하나는 생산자 쓰레드마다 고정 크기 단일 생산자/단일 소비자 링을 두고, 소비 쓰레드 하나가 모든 링을 비움
+ * - 넣기는 절대 막히지 않음: 링이 가득 차면 항목을 버리고 dropped를 셈 (수신 쓰레드가 느린 단계를 기다리지 않음)
+ * - 소비 쓰레드가 잠들어 있을 때만 eventfd로 깨움 (바쁠 때는 시스템 호출 없음)
+ * - 단계별 queued/dropped/depth를 계측값으로 내보냄 (backpressure 확인용)
+ */
+#define PIPELINE_PRODUCERS 72 // 단계 하나에 넣을 수 있는 최대 생산자 쓰레드 수
+#define PIPELINE_STAGES 72 // 최대 단계 수 (shard별 UDP 인계 큐 포함)
+
+// 생산자 하나의 링 (소비 쓰레드와 생산자 쓰레드만 접근)
+struct spsc_ring
+{
+    _Alignas(64) atomic_size_t head; // 다음에 쓸 위치 (생산자만 증가)
+    _Alignas(64) atomic_size_t tail; // 다음에 읽을 위치 (소비자만 증가)
+    _Alignas(64) uint8_t* slots; // 항목 배열
+};
+
+// 처리 단계 입력
+struct pipeline_stage
+{
+    const char* name; // 계측값에 쓸 이름
+    size_t item_size; // 항목 크기
+    size_t capacity; // 생산자별 링 크기 (2의 거듭제곱)
+    int wake_fd; // 소비 쓰레드를 깨우는 eventfd
+    atomic_int sleeping; // 소비 쓰레드가 잠들어 있는지 여부
+    atomic_uint_least64_t queued; // 넣은 항목 수
+    atomic_uint_least64_t dropped; // 가득 차서 버린 항목 수
+    atomic_uint_least64_t wakeups; // 소비 쓰레드를 깨운 횟수
+    _Atomic(struct spsc_ring*) rings[PIPELINE_PRODUCERS]; // 생산자별 링 (처음 넣을 때 생성)
+};
+
+// 항목 처리 함수
+typedef void (*pipeline_handler)(void* item, void* arg);
+
+// 단계 초기화 (capacity는 2의 거듭제곱으로 올림)
+int pipeline_init(struct pipeline_stage* stage, const char* name, size_t item_size, size_t capacity);
+
+// 항목 넣기 (막히지 않음, 가득 차면 -1)
+int pipeline_push(struct pipeline_stage* stage, const void* item);
+
+// 쌓인 항목을 꺼내 처리 (소비 쓰레드 전용, 생산자마다 최대 max개, 처리한 수 반환)
+size_t pipeline_drain(struct pipeline_stage* stage, pipeline_handler handler, void* arg, size_t max);
+
+// 항목이 들어오거나 timeout_ms가 지날 때까지 대기 (소비 쓰레드 전용, -1이면 무한 대기)
+void pipeline_wait(struct pipeline_stage* stage, int timeout_ms);
+
+// 쌓여 있는 항목 수
+size_t pipeline_depth(struct pipeline_stage* stage);
+
+// 초기화된 단계 수와 단계 조회 (계측값 출력용)
+int pipeline_stage_count(void);
+struct pipeline_stage* pipeline_stage_at(int index);
+
+#endif
@@ -8,191 +8,90 @@
 #include <wiringPi.h> 
 #include <softPwm.h> 
 #include <string.h> 
-#include <arpa/inet.h> 
 #include <pthread.h>  
+#include "protocol.h"
+#include "gpio.h"
+#include "transport.h"
 
-#define IN 0 
-#define OUT 1
 #define LOW 0 
 #define HIGH 1 
 #define PIR_PIN 20 // PIR 센서 핀 정의
 #define POUT 21 // 출력 핀 정의
 #define SERVO 18 // 서보모터 핀 정의
-#define VALUE_MAX 40 // 최대 값 정의
 
 #define SERVER_IP "192.168.45.8"  // 서버 IP 주소 정의
 #define SERVER_PORT 8080 // 서버 포트 정의
-
-static int GPIOExport(int pin) {
-    #define BUFFER_MAX 3
-    char buffer[BUFFER_MAX];
-    ssize_t bytes_written;
-    int fd;
-
-    fd = open("/sys/class/gpio/export", O_WRONLY);
-    if (-1 == fd) {
-        fprintf(stderr, "Failed to open export for writing!\n");
-        return(-1);
+#define NODE_ID 3 // 서버에 보고할 노드 ID
+#define SITE_ID 1 // 노드가 설치된 현장 ID
+#define ZONE_ID 1 // 현장 내 구역 ID
+#define HEARTBEAT_MS 10000 // 상태 변화가 없을 때 현재 상태를 보내는 주기
+#define EVENT_BATCH 16 // 한 번에 읽을 최대 에지 이벤트 수
+#define SPOOL_PATH "pir.spool" // 연결이 끊긴 동안의 이벤트를 보관할 파일
+#define SPOOL_BYTES (256 << 10) // spool 크기
+
+static uint32_t send_seq = 0; // 전송 프레임 시퀀스 번호
+static struct gpio_lines pir_line; // PIR 입력 라인 (시작 시 한 번 요청해 계속 사용)
+static struct gpio_lines led_line; // LED 출력 라인
+
+// 서버로 데이터를 보내는 함수 (kind는 상태 변화 또는 heartbeat, 연결이 없으면 spool에 저장)
+void send_data_to_server(struct transport *link, int motion_detected, uint8_t kind, uint64_t timestamp_ms) {
+    uint8_t frame[PROTO_MAX_FRAME]; // 프레임 버퍼 정의
+    size_t frame_len = proto_encode_pir_event(frame, sizeof(frame), NODE_ID, send_seq++, timestamp_ms, motion_detected, kind); // 모션 감지 상태를 바이너리 프레임으로 인코딩
+    if (transport_send(link, frame, frame_len) == -1) { // 서버로 데이터를 전송
+        printf("send failed, event dropped\n"); // 전송 실패 시 에러 메시지 출력
     }
-
-    bytes_written = snprintf(buffer, BUFFER_MAX, "%d", pin);
-    write(fd, buffer, bytes_written);
-    close(fd);
-    return(0);
 }
 
-static int GPIOUnexport(int pin) {
-    char buffer[BUFFER_MAX];
-    ssize_t bytes_written;
-    int fd;
-
-    fd = open("/sys/class/gpio/unexport", O_WRONLY);
-    if (-1 == fd) {
-        fprintf(stderr, "Failed to open unexport for writing!\n");
-        return(-1);
-    }
-
-    bytes_written = snprintf(buffer, BUFFER_MAX, "%d", pin);
-    write(fd, buffer, bytes_written);
-    close(fd);
-    return(0);
-}
-
-static int GPIODirection(int pin, int dir) {
-    static const char s_directions_str[] = "in\0out";
-    #define DIRECTION_MAX 35
-    char path[DIRECTION_MAX];
-    int fd;
-
-    snprintf(path, DIRECTION_MAX, "/sys/class/gpio/gpio%d/direction", pin);
-
-    fd = open(path, O_WRONLY);
-    if (-1 == fd) {
-        fprintf(stderr, "Failed to open gpio direction for writing!\n");
-        return(-1);
-    }
-
-    if (-1 == write(fd, &s_directions_str[IN == dir ? 0 : 3], IN == dir ? 2 : 3)) {
-        fprintf(stderr, "Failed to set direction!\n");
-        close(fd);
-        return(-1);
-    }
-
-    close(fd);
-    return(0);
-}
-
-static int GPIORead(int pin) {
-    char path[VALUE_MAX];
-    char value_str[3];
-    int fd;
-
-    snprintf(path, VALUE_MAX, "/sys/class/gpio/gpio%d/value", pin);
-    fd = open(path, O_RDONLY);
-    if (-1 == fd) {
-        fprintf(stderr, "Failed to open gpio value for reading!\n");
-        return(-1);
-    }
-
-    if (-1 == read(fd, value_str, 3)) {
-        fprintf(stderr, "Failed to read value!\n");
-        close(fd);
-        return(-1);
-    }
-
-    close(fd);
-    return(atoi(value_str));
+// 커널 에지 시각(CLOCK_MONOTONIC ns)을 프레임 시각(ms)으로 바꾸는 함수
+static uint64_t event_time_ms(uint64_t timestamp_ns) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    uint64_t age_ms = now_ns > timestamp_ns ? (now_ns - timestamp_ns) / 1000000 : 0; // 에지 이후 지난 시간
+    return proto_now_ms() - age_ms;
 }
 
-static int GPIOWrite(int pin, int value) {
-    static const char s_values_str[] = "01";
-    char path[VALUE_MAX];
-    int fd;
-
-    snprintf(path, VALUE_MAX, "/sys/class/gpio/gpio%d/value", pin);
-    fd = open(path, O_WRONLY);
-    if (-1 == fd) {
-        fprintf(stderr, "Failed to open gpio value for writing!\n");
-        return(-1);
-    }
-
-    if (1 != write(fd, &s_values_str[LOW == value ? 0 : 1], 1)) {
-        fprintf(stderr, "Failed to write value!\n");
-        close(fd);
-        return(-1);
-    }
-
-    close(fd);
-    return(0);
-}
-
-// 서버로 데이터를 보내는 함수
-void send_data_to_server(int sock, int motion_detected) {
-    char message[2]; // 메시지 버퍼 정의
-    snprintf(message, sizeof(message), "%d", motion_detected); // 모션 감지 상태를 문자열로 변환하여 message에 저장
-    if (send(sock, message, strlen(message), 0) == -1) { // 서버로 데이터를 전송
-        perror("send failed"); // 전송 실패 시 에러 메시지 출력
-    }
-}
-
-// 서버에 연결하는 함수
-int connect_to_server() {
-    struct sockaddr_in servaddr; // 서버의 주소 정보를 저장할 구조체
-    int sock; // 소켓 파일 디스크립터
-
-    // 소켓 생성
-    sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == -1) { // 소켓 생성에 실패한 경우
-        perror("socket creation failed");
-        return -1;
-    }
-
-    // 서버 주소 초기화
-    servaddr.sin_family = AF_INET; // 주소 체계 설정 (IPv4)
-    servaddr.sin_port = htons(SERVER_PORT); // 포트 번호 설정 (네트워크 바이트 순서로 변환)
-    servaddr.sin_addr.s_addr = inet_addr(SERVER_IP); // IP 주소 설정
-
-    // 서버에 연결 시도
-    while (connect(sock, (struct sockaddr *)&servaddr, sizeof(servaddr)) != 0) {
-        perror("connection with the server failed, retrying..."); // 연결 실패 시 에러 메시지 출력
-        close(sock); // 연결 실패 시 소켓을 닫음
-        sleep(1);  // 잠시 대기 후 재시도
-        sock = socket(AF_INET, SOCK_STREAM, 0); // 새로운 소켓 생성
-        if (sock == -1) { // 소켓 생성에 실패한 경우
-            perror("socket creation failed");
-            return -1;
-        }
-    }
-    printf("Connected to server\n"); // 연결 성공 시 메시지 출력
-    return sock; // 소켓 파일 디스크립터 반환
-}
-
-// 클라이언트 스레드 함수
+// 클라이언트 스레드 함수 (에지 이벤트가 올 때까지 잠들고, 상태가 바뀔 때와 heartbeat 주기에만 전송)
 void *client_thread(void *arg) {
-    int sock = connect_to_server(); // 서버에 연결
-    int cnt = 0; // 카운터 변수
-    if (sock == -1) { // 연결 실패 시
+    struct transport link; // 서버 연결 (끊기면 재연결하고 그동안의 이벤트는 spool에 보관)
+    if (transport_open(&link, SERVER_IP, SERVER_PORT, NODE_ID, PROTO_PIR, SITE_ID, ZONE_ID, SPOOL_PATH, SPOOL_BYTES) == -1) {
         return NULL;
     }
 
-    int state; // 현재 상태
-    int prev_state = LOW; // 이전 상태
-    time_t last_detection_time = 0; // 마지막 감지 시간
+    int state = gpio_read(&pir_line, 0); // 시작 상태
+    send_data_to_server(&link, state, PROTO_PIR_HEARTBEAT, proto_now_ms()); // 서버가 시작 상태를 알 수 있도록 바로 보냄
+    uint64_t next_heartbeat = proto_monotonic_ms() + HEARTBEAT_MS; // 다음 heartbeat 시각 (단조 시계, NTP가 시계를 옮겨도 주기가 유지됨)
 
     while (1) {
-        state = GPIORead(PIR_PIN); // PIR 센서의 상태를 읽음
-
-        if (state == HIGH) { // 모션이 감지된 경우
-            send_data_to_server(sock, 1); // 서버에 데이터 전송
-        } else {
-            send_data_to_server(sock, 0); // 모션이 감지되지 않은 경우 서버에 데이터 전송
+        uint64_t now = proto_monotonic_ms();
+        int timeout_ms = next_heartbeat > now ? (int)(next_heartbeat - now) : 0;
+        int ready = gpio_wait_event(&pir_line, timeout_ms); // 에지 또는 heartbeat 시각까지 대기
+        transport_poll(&link); // 연결이 끊겨 있으면 재연결 시도
+
+        if (ready > 0) {
+            struct gpio_event events[EVENT_BATCH];
+            int n = gpio_read_events(&pir_line, events, EVENT_BATCH);
+            for (int i = 0; i < n; i++) {
+                if (events[i].value == state) {
+                    continue; // 같은 상태로의 에지 (이미 보낸 상태)
+                }
+                state = events[i].value; // 현재 상태 업데이트
+                printf("Motion %s\n", state == HIGH ? "started" : "ended");
+                send_data_to_server(&link, state, PROTO_PIR_EDGE, event_time_ms(events[i].timestamp_ns)); // 상태 변화를 에지 시각과 함께 전송
+                next_heartbeat = proto_monotonic_ms() + HEARTBEAT_MS; // 방금 보냈으므로 heartbeat는 뒤로 미룸
+            }
+            transport_flush(&link); // 모션 변화는 알람 확인에 쓰이므로 묶음 대기 없이 바로 보냄 (한 번에 읽은 에지들은 함께)
+        } else if (ready == 0 && proto_monotonic_ms() >= next_heartbeat) {
+            send_data_to_server(&link, state, PROTO_PIR_HEARTBEAT, proto_now_ms()); // 변화가 없으면 현재 상태만 알림
+            next_heartbeat += HEARTBEAT_MS;
+        } else if (ready < 0) {
+            perror("gpio wait failed");
+            sleep(1);
         }
-        prev_state = state; // 이전 상태 업데이트
-        usleep(100000); // 0.1초 대기
     }
 
-    // 소켓 종료
-    close(sock);
+    // 연결 종료
+    transport_close(&link);
 
     return NULL;
 }
@@ -202,12 +101,11 @@ int main(int argc, char *argv[]) {
     pinMode(SERVO, OUTPUT); // 서보모터 핀을 출력으로 설정
     softPwmCreate(SERVO, 0, 200); // 소프트웨어 PWM 설정
 
-    // GPIO 핀 활성화
-    if (-1 == GPIOExport(PIR_PIN) || -1 == GPIOExport(POUT))
+    // GPIO 라인 요청 (PIR 입력, LED 출력)
+    unsigned int pir_pin = PIR_PIN, led_pin = POUT;
+    if (-1 == gpio_request(&pir_line, GPIO_CHIP, &pir_pin, 1, GPIO_INPUT | GPIO_EDGE_BOTH, 0, "pir-client"))
         return 1;
-
-    // GPIO 핀 방향 설정
-    if (-1 == GPIODirection(PIR_PIN, IN) || -1 == GPIODirection(POUT, OUT))
+    if (-1 == gpio_request(&led_line, GPIO_CHIP, &led_pin, 1, GPIO_OUTPUT, 0, "pir-client"))
         return 2;
 
     // 클라이언트 스레드 생성
@@ -217,11 +115,11 @@ int main(int argc, char *argv[]) {
     // 메인 스레드는 무한 루프 내에서 LED와 서보 모터를 제어
     time_t last_detection_time = 0; // 마지막 감지 시간을 저장할 변수
     while (1) {
-        int state = GPIORead(PIR_PIN); // PIR 센서의 상태를 읽음
+        int state = gpio_read(&pir_line, 0); // PIR 센서의 상태를 읽음
 
         if (state == HIGH) { // 모션이 감지된 경우
             printf("Motion detected in main loop!\n"); // 감지 메시지 출력
-            GPIOWrite(POUT, HIGH); // LED 켬
+            gpio_write(&led_line, 0, HIGH); // LED 켬
             softPwmWrite(SERVO, 25); // 서보모터 25도로 설정
             delay(300); // 300ms 대기
             softPwmWrite(SERVO, 5); // 서보모터 5도로 설정
@@ -232,16 +130,16 @@ int main(int argc, char *argv[]) {
         // 마지막 모션 감지 후 최소 5초 동안 LED를 켜둠
         if (difftime(time(NULL), last_detection_time) >= 5) {
             printf("No detection in main loop\n"); // 감지 없음 메시지 출력
-            GPIOWrite(POUT, LOW); // LED 끔
+            gpio_write(&led_line, 0, LOW); // LED 끔
             softPwmWrite(SERVO, 0); // 서보모터 0도로 설정
         }
 
         delay(1000); // 1초 대기
     }
 
-    // GPIO 핀 비활성화
-    if (-1 == GPIOUnexport(PIR_PIN) || -1 == GPIOUnexport(POUT))
-        return 4;
+    // GPIO 라인 반납
+    gpio_release(&pir_line);
+    gpio_release(&led_line);
 
     return 0;
 }
@@ -0,0 +1,411 @@
+#include <string.h>
+#include <time.h>
+#include "protocol.h"
+
+// little-endian 읽기/쓰기 함수 (정렬되지 않은 주소에서도 안전)
+static uint16_t get_u16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t* p)
+{
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static void put_u64(uint8_t* p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+// 버퍼 앞에서 프레임 하나를 디코드하는 함수
+int proto_decode(const uint8_t* buf, size_t len, struct proto_frame* out)
+{
+    if (len == 0)
+    {
+        return PROTO_NEED_MORE;
+    }
+    if (buf[0] != PROTO_MAGIC)
+    {
+        return PROTO_BAD_FRAME; // 시작 바이트 불일치
+    }
+    if (len >= 2 && buf[1] != PROTO_VERSION)
+    {
+        return PROTO_BAD_FRAME; // 지원하지 않는 버전
+    }
+    if (len < PROTO_HEADER_SIZE)
+    {
+        return PROTO_NEED_MORE; // 헤더가 아직 다 오지 않음
+    }
+
+    size_t frame_len = PROTO_HEADER_SIZE + buf[3]; // 전체 프레임 길이
+    if (len < frame_len)
+    {
+        return PROTO_NEED_MORE; // payload가 아직 다 오지 않음
+    }
+
+    out->version = buf[1];
+    out->type = buf[2] & PROTO_TYPE_MASK;
+    out->flags = buf[2] & ~PROTO_TYPE_MASK;
+    out->payload_len = buf[3];
+    out->node_id = get_u32(buf + 4);
+    out->seq = get_u32(buf + 8);
+    out->timestamp_ms = get_u64(buf + 12);
+    out->payload = buf + PROTO_HEADER_SIZE;
+    return (int)frame_len;
+}
+
+// 헤더와 payload를 인코딩하는 함수
+size_t proto_encode(uint8_t* buf, size_t cap, uint8_t type, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const void* payload, uint8_t payload_len)
+{
+    size_t frame_len = PROTO_HEADER_SIZE + payload_len;
+    if (cap < frame_len)
+    {
+        return 0; // 버퍼 공간 부족
+    }
+
+    buf[0] = PROTO_MAGIC;
+    buf[1] = PROTO_VERSION;
+    buf[2] = type;
+    buf[3] = payload_len;
+    put_u32(buf + 4, node_id);
+    put_u32(buf + 8, seq);
+    put_u64(buf + 12, timestamp_ms);
+    memcpy(buf + PROTO_HEADER_SIZE, payload, payload_len);
+    return frame_len;
+}
+
+// spool 보관 표시 함수
+void proto_mark_spooled(uint8_t* frame)
+{
+    frame[2] |= PROTO_FLAG_SPOOLED;
+}
+
+// 온습도 프레임 인코딩 (소수점 첫째 자리까지 정수로 변환)
+size_t proto_encode_temp(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, float temperature, float humidity)
+{
+    uint8_t payload[4];
+    put_u16(payload, (uint16_t)(int16_t)(temperature * 10.0f + (temperature < 0 ? -0.5f : 0.5f)));
+    put_u16(payload + 2, (uint16_t)(humidity * 10.0f + 0.5f));
+    return proto_encode(buf, cap, PROTO_TEMP, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// 조도 프레임 인코딩
+size_t proto_encode_light(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int light)
+{
+    uint8_t payload[2];
+    put_u16(payload, (uint16_t)light);
+    return proto_encode(buf, cap, PROTO_LIGHT, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// PIR 프레임 인코딩
+size_t proto_encode_pir(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int motion)
+{
+    uint8_t payload[1] = {motion ? 1 : 0};
+    return proto_encode(buf, cap, PROTO_PIR, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// PIR 상태 변화/heartbeat 프레임 인코딩
+size_t proto_encode_pir_event(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int motion, uint8_t kind)
+{
+    uint8_t payload[2] = {motion ? 1 : 0, kind};
+    return proto_encode(buf, cap, PROTO_PIR, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// 노드 등록 프레임 인코딩
+size_t proto_encode_hello(uint8_t* buf, size_t cap, uint32_t node_id, uint64_t timestamp_ms, uint8_t sensor_type, uint16_t site_id, uint16_t zone_id)
+{
+    uint8_t payload[5];
+    payload[0] = sensor_type;
+    put_u16(payload + 1, site_id);
+    put_u16(payload + 3, zone_id);
+    return proto_encode(buf, cap, PROTO_HELLO, node_id, 0, timestamp_ms, payload, sizeof(payload));
+}
+
+// 아날로그 채널 묶음 프레임 인코딩
+size_t proto_encode_analog(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_analog* channels, int count)
+{
+    uint8_t payload[PROTO_ANALOG_MAX * 4];
+    if (count < 0 || count > PROTO_ANALOG_MAX)
+    {
+        return 0;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        float v = channels[i].value;
+        uint16_t raw = (channels[i].kind == PROTO_ANALOG_GLOBE) ? (uint16_t)(int16_t)(v * 10.0f + (v < 0 ? -0.5f : 0.5f)) : (uint16_t)(v + 0.5f);
+        payload[i * 4] = channels[i].channel;
+        payload[i * 4 + 1] = channels[i].kind;
+        put_u16(payload + i * 4 + 2, raw);
+    }
+    return proto_encode(buf, cap, PROTO_ANALOG, node_id, seq, timestamp_ms, payload, count * 4);
+}
+
+// 묶음 초기화 함수
+void proto_batch_reset(struct proto_batch* batch)
+{
+    batch->count = 0;
+    batch->len = 0;
+}
+
+// 묶음에 측정 프레임을 추가하는 함수 (헤더는 떼고 payload만 복사)
+int proto_batch_add(struct proto_batch* batch, const uint8_t* frame, size_t len)
+{
+    struct proto_frame f;
+    if (proto_decode(frame, len, &f) <= 0 || f.type == PROTO_HELLO || f.type == PROTO_BATCH)
+    {
+        return -1;
+    }
+    if (batch->len + PROTO_BATCH_RECORD + f.payload_len > PROTO_MAX_PAYLOAD)
+    {
+        return -1; // 자리가 없음
+    }
+    if (batch->count == 0)
+    {
+        batch->node_id = f.node_id;
+        batch->seq = f.seq;
+        batch->timestamp_ms = f.timestamp_ms;
+    }
+    else if (f.node_id != batch->node_id || f.seq != batch->seq + (uint32_t)batch->count || f.timestamp_ms < batch->timestamp_ms || f.timestamp_ms - batch->timestamp_ms > UINT16_MAX)
+    {
+        return -1; // 헤더 하나로 표현할 수 없는 측정
+    }
+
+    uint8_t* p = batch->payload + batch->len;
+    p[0] = f.type;
+    p[1] = f.payload_len;
+    put_u16(p + 2, (uint16_t)(f.timestamp_ms - batch->timestamp_ms));
+    memcpy(p + PROTO_BATCH_RECORD, f.payload, f.payload_len);
+    batch->len += PROTO_BATCH_RECORD + f.payload_len;
+    batch->count++;
+    return 0;
+}
+
+// 묶음 프레임 인코딩 함수
+size_t proto_encode_batch(uint8_t* buf, size_t cap, const struct proto_batch* batch)
+{
+    if (batch->count == 0)
+    {
+        return 0;
+    }
+    if (batch->count == 1)
+    {
+        // 하나뿐이면 묶음 머리 없이 원래 프레임으로 보냄
+        return proto_encode(buf, cap, batch->payload[0], batch->node_id, batch->seq, batch->timestamp_ms, batch->payload + PROTO_BATCH_RECORD, batch->payload[1]);
+    }
+    return proto_encode(buf, cap, PROTO_BATCH, batch->node_id, batch->seq, batch->timestamp_ms, batch->payload, (uint8_t)batch->len);
+}
+
+// 묶음에서 다음 측정을 꺼내는 함수 (out의 payload는 묶음 프레임을 그대로 가리킴)
+int proto_batch_next(const struct proto_frame* batch, size_t* offset, uint32_t* index, struct proto_frame* out)
+{
+    if (*offset >= batch->payload_len)
+    {
+        return 0;
+    }
+    const uint8_t* p = batch->payload + *offset;
+    if (*offset + PROTO_BATCH_RECORD > batch->payload_len || *offset + PROTO_BATCH_RECORD + p[1] > batch->payload_len || p[0] == PROTO_BATCH || p[0] == PROTO_HELLO)
+    {
+        return -1;
+    }
+
+    out->version = batch->version;
+    out->type = p[0];
+    out->flags = batch->flags; // 묶음째로 spool에 보관됨
+    out->payload_len = p[1];
+    out->node_id = batch->node_id;
+    out->seq = batch->seq + (*index)++;
+    out->timestamp_ms = batch->timestamp_ms + get_u16(p + 2);
+    out->payload = p + PROTO_BATCH_RECORD;
+    *offset += PROTO_BATCH_RECORD + p[1];
+    return 1;
+}
+
+// 판정 결과 프레임 인코딩 (seq는 판정을 일으킨 측정 프레임의 시퀀스 번호)
+size_t proto_encode_decision(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, float wbgt, int alert, uint16_t site_id, uint16_t zone_id)
+{
+    uint8_t payload[7];
+    put_u16(payload, (uint16_t)(int16_t)(wbgt * 10.0f + (wbgt < 0 ? -0.5f : 0.5f)));
+    payload[2] = alert ? 1 : 0;
+    put_u16(payload + 3, site_id);
+    put_u16(payload + 5, zone_id);
+    return proto_encode(buf, cap, PROTO_DECISION, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// 값을 x10 고정소수점으로 반올림하는 함수 (음수는 int16 비트 그대로)
+static uint16_t fixed10(float v)
+{
+    return (uint16_t)(int16_t)(v * 10.0f + (v < 0 ? -0.5f : 0.5f));
+}
+
+// 노드 WBGT 프레임 인코딩
+size_t proto_encode_wbgt(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_wbgt* report)
+{
+    uint8_t payload[14];
+    payload[0] = report->kind;
+    payload[1] = report->over ? 1 : 0;
+    put_u16(payload + 2, fixed10(report->wbgt));
+    put_u16(payload + 4, fixed10(report->wbgt_max));
+    put_u16(payload + 6, fixed10(report->temperature));
+    put_u16(payload + 8, fixed10(report->humidity));
+    put_u16(payload + 10, fixed10(report->globe));
+    put_u16(payload + 12, report->samples);
+    return proto_encode(buf, cap, PROTO_WBGT, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// 측정 속도 지시 프레임 인코딩
+size_t proto_encode_control(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_control* control)
+{
+    uint8_t payload[9];
+    payload[0] = control->level;
+    put_u32(payload + 1, control->sample_us);
+    put_u32(payload + 5, control->report_ms);
+    return proto_encode(buf, cap, PROTO_CONTROL, node_id, seq, timestamp_ms, payload, sizeof(payload));
+}
+
+// 온습도 payload 해석
+int proto_parse_temp(const struct proto_frame* frame, float* temperature, float* humidity)
+{
+    if (frame->payload_len < 4)
+    {
+        return -1;
+    }
+    *temperature = (int16_t)get_u16(frame->payload) / 10.0f;
+    *humidity = get_u16(frame->payload + 2) / 10.0f;
+    return 0;
+}
+
+// 조도 payload 해석
+int proto_parse_light(const struct proto_frame* frame, int* light)
+{
+    if (frame->payload_len < 2)
+    {
+        return -1;
+    }
+    *light = get_u16(frame->payload);
+    return 0;
+}
+
+// PIR payload 해석
+int proto_parse_pir(const struct proto_frame* frame, int* motion, uint8_t* kind)
+{
+    if (frame->payload_len < 1)
+    {
+        return -1;
+    }
+    *motion = frame->payload[0];
+    *kind = frame->payload_len >= 2 ? frame->payload[1] : PROTO_PIR_SAMPLE;
+    return 0;
+}
+
+// 노드 등록 payload 해석
+int proto_parse_hello(const struct proto_frame* frame, uint8_t* sensor_type, uint16_t* site_id, uint16_t* zone_id)
+{
+    if (frame->payload_len < 5)
+    {
+        return -1;
+    }
+    *sensor_type = frame->payload[0];
+    *site_id = get_u16(frame->payload + 1);
+    *zone_id = get_u16(frame->payload + 3);
+    return 0;
+}
+
+// 아날로그 채널 묶음 payload 해석
+int proto_parse_analog(const struct proto_frame* frame, struct proto_analog* channels, int max)
+{
+    int count = frame->payload_len / 4;
+    if (frame->payload_len % 4 != 0 || count == 0 || count > max)
+    {
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t* p = frame->payload + i * 4;
+        channels[i].channel = p[0];
+        channels[i].kind = p[1];
+        channels[i].value = (p[1] == PROTO_ANALOG_GLOBE) ? (int16_t)get_u16(p + 2) / 10.0f : get_u16(p + 2);
+    }
+    return count;
+}
+
+// 판정 결과 payload 해석
+int proto_parse_decision(const struct proto_frame* frame, float* wbgt, int* alert, uint16_t* site_id, uint16_t* zone_id)
+{
+    if (frame->payload_len < 7)
+    {
+        return -1;
+    }
+    *wbgt = (int16_t)get_u16(frame->payload) / 10.0f;
+    *alert = frame->payload[2];
+    *site_id = get_u16(frame->payload + 3);
+    *zone_id = get_u16(frame->payload + 5);
+    return 0;
+}
+
+// 노드 WBGT payload 해석
+int proto_parse_wbgt(const struct proto_frame* frame, struct proto_wbgt* report)
+{
+    if (frame->payload_len < 14)
+    {
+        return -1;
+    }
+    report->kind = frame->payload[0];
+    report->over = frame->payload[1];
+    report->wbgt = (int16_t)get_u16(frame->payload + 2) / 10.0f;
+    report->wbgt_max = (int16_t)get_u16(frame->payload + 4) / 10.0f;
+    report->temperature = (int16_t)get_u16(frame->payload + 6) / 10.0f;
+    report->humidity = get_u16(frame->payload + 8) / 10.0f;
+    report->globe = (int16_t)get_u16(frame->payload + 10) / 10.0f;
+    report->samples = get_u16(frame->payload + 12);
+    return 0;
+}
+
+// 측정 속도 지시 payload 해석
+int proto_parse_control(const struct proto_frame* frame, struct proto_control* control)
+{
+    if (frame->payload_len < 9)
+    {
+        return -1;
+    }
+    control->level = frame->payload[0];
+    control->sample_us = get_u32(frame->payload + 1);
+    control->report_ms = get_u32(frame->payload + 5);
+    return 0;
+}
+
+// 현재 시각을 ms 단위로 반환하는 함수
+uint64_t proto_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 단조 증가 시각을 ms 단위로 반환하는 함수
+uint64_t proto_monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
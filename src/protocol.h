@@ -0,0 +1,187 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 센서 노드 <-> 서버 바이너리 프레임 형식 (모든 정수는 little-endian)
+ *
+ *  offset  size  field
+ *  0       1     magic (0xA5, ASCII 텍스트에는 나타나지 않는 값)
+ *  1       1     version
+ *  2       1     type (enum proto_type, 최상위 비트는 PROTO_FLAG_SPOOLED)
+ *  3       1     payload 길이 (바이트)
+ *  4       4     node id
+ *  8       4     sequence number
+ *  12      8     timestamp (epoch 기준 ms)
+ *  20      N     payload
+ */
+#define PROTO_MAGIC 0xA5 // 프레임 시작 바이트
+#define PROTO_VERSION 1 // 프로토콜 버전
+#define PROTO_HEADER_SIZE 20 // 헤더 크기
+#define PROTO_MAX_PAYLOAD 255 // payload 최대 크기
+#define PROTO_MAX_FRAME (PROTO_HEADER_SIZE + PROTO_MAX_PAYLOAD) // 프레임 최대 크기
+#define PROTO_TYPE_MASK 0x7F // type 바이트에서 프레임 종류 부분
+#define PROTO_FLAG_SPOOLED 0x80 // 연결이 없던 동안 spool에 보관했다가 보낸 프레임 (서버는 이력에만 기록)
+
+// 프레임 종류
+enum proto_type
+{
+    PROTO_TEMP = 1, // 온습도: int16 온도 x10, uint16 습도 x10
+    PROTO_LIGHT = 2, // 조도: uint16 ADC 값
+    PROTO_PIR = 3, // PIR: uint8 모션 감지 여부 [, uint8 보고 종류 (enum proto_pir_kind, 없으면 주기 샘플)]
+    PROTO_HELLO = 4, // 노드 등록: uint8 센서 종류, uint16 현장 ID, uint16 구역 ID
+    PROTO_DECISION = 5, // 판정 결과 (서버 -> 노드): int16 WBGT x10, uint8 알람 시작 여부, uint16 현장 ID, uint16 구역 ID
+    PROTO_ANALOG = 6, // 아날로그 채널 묶음: (uint8 채널, uint8 종류, uint16 값)을 채널 수만큼 반복
+    PROTO_BATCH = 7, // 측정 묶음: (uint8 종류, uint8 payload 길이, uint16 헤더 시각과의 차이 ms, payload)를 반복
+    PROTO_CONTROL = 8, // 측정 속도 지시 (서버 -> 노드): uint8 단계, uint32 샘플 간격 us, uint32 보고 간격 ms
+    PROTO_WBGT = 9 // 노드에서 계산한 현장 WBGT (struct proto_wbgt 참고)
+};
+
+// 측정 속도 단계 (서버가 현장의 WBGT가 임계치에 얼마나 가까운지로 정함)
+enum proto_rate
+{
+    PROTO_RATE_RELAXED = 1, // 임계치에서 멀리 떨어짐 (느리게)
+    PROTO_RATE_NORMAL = 2, // 기본 속도
+    PROTO_RATE_FAST = 3 // 임계치에 가까움 (빠르게)
+};
+
+// 측정 속도 지시 (간격이 0이면 노드의 기본값 유지)
+struct proto_control
+{
+    uint8_t level; // 단계 (enum proto_rate)
+    uint32_t sample_us; // 센서를 읽는 간격
+    uint32_t report_ms; // 서버로 보내는 간격
+};
+
+/*
+ * 측정 묶음 (PROTO_BATCH)
+ * 한 노드가 연속으로 만든 측정 프레임 여러 개를 헤더 하나로 보냄
+ * 묶음 헤더의 seq/timestamp는 첫 측정의 값이고, i번째 측정의 seq는 seq + i, 시각은 timestamp + 차이
+ * 서버는 묶음을 한 번 훑으면서 각 측정을 일반 프레임과 똑같이 처리함
+ */
+#define PROTO_BATCH_RECORD 4 // 묶음 안 측정 하나의 머리 크기
+
+// 묶음을 만드는 중인 측정들
+struct proto_batch
+{
+    uint32_t node_id; // 노드 ID
+    uint32_t seq; // 첫 측정의 시퀀스 번호
+    uint64_t timestamp_ms; // 첫 측정 시각
+    int count; // 담긴 측정 수
+    size_t len; // payload에 쓴 바이트 수
+    uint8_t payload[PROTO_MAX_PAYLOAD]; // 묶음 payload
+};
+
+// 아날로그 채널 종류
+enum proto_analog_kind
+{
+    PROTO_ANALOG_LIGHT = 1, // 조도: ADC 값
+    PROTO_ANALOG_GLOBE = 2 // 흑구 온도계: int16 온도 x10 (노드에서 변환)
+};
+
+// PIR 보고 종류
+enum proto_pir_kind
+{
+    PROTO_PIR_SAMPLE = 0, // 주기적으로 읽은 상태 (기존 노드, 1바이트 payload)
+    PROTO_PIR_EDGE = 1, // 상태 변화 (timestamp는 커널이 기록한 에지 시각)
+    PROTO_PIR_HEARTBEAT = 2 // 변화가 없을 때 보내는 현재 상태
+};
+
+/*
+ * 노드에서 계산한 WBGT (PROTO_WBGT, 온습도와 조도를 함께 읽는 엣지 노드)
+ * payload: uint8 보고 종류, uint8 초과 중 여부, int16 WBGT x10, int16 최대 WBGT x10,
+ *          int16 건구 온도 x10, uint16 습도 x10, int16 흑구 온도 x10, uint16 샘플 수
+ * 요약은 구간 평균 WBGT와 구간 최대 WBGT, 마지막 측정의 온습도/흑구 온도를 담고,
+ * 초과 시작/해제는 그 측정의 값을 담음 (최대 WBGT도 그 측정의 값, 샘플 수는 1)
+ */
+enum proto_wbgt_kind
+{
+    PROTO_WBGT_SUMMARY = 0, // 주기 요약
+    PROTO_WBGT_EXCEED = 1, // 임계치 초과 시작 (바로 보냄)
+    PROTO_WBGT_CLEAR = 2 // 초과 해제 (바로 보냄)
+};
+
+struct proto_wbgt
+{
+    uint8_t kind; // 보고 종류 (enum proto_wbgt_kind)
+    uint8_t over; // 보고 시점에 임계치를 초과 중인지 여부
+    float wbgt; // 요약이면 구간 평균, 초과 시작/해제면 그 측정의 WBGT
+    float wbgt_max; // 구간 최대 WBGT
+    float temperature; // 건구 온도
+    float humidity; // 상대 습도
+    float globe; // 흑구 온도
+    uint16_t samples; // 구간 측정 수
+};
+
+#define PROTO_ANALOG_MAX 8 // 한 프레임의 최대 채널 수 (MCP3008 채널 수)
+
+// 아날로그 채널 값
+struct proto_analog
+{
+    uint8_t channel; // ADC 채널 번호
+    uint8_t kind; // 채널 종류 (enum proto_analog_kind)
+    float value; // 조도는 ADC 값, 흑구 온도는 C
+};
+
+// 디코드된 프레임 (payload는 수신 버퍼를 그대로 가리킴)
+struct proto_frame
+{
+    uint8_t version; // 프로토콜 버전
+    uint8_t type; // 프레임 종류
+    uint8_t flags; // 헤더 플래그 (PROTO_FLAG_SPOOLED)
+    uint8_t payload_len; // payload 길이
+    uint32_t node_id; // 노드 ID
+    uint32_t seq; // 시퀀스 번호
+    uint64_t timestamp_ms; // 측정 시각 (ms)
+    const uint8_t* payload; // payload 시작 위치 (복사하지 않음)
+};
+
+// 디코드 결과
+#define PROTO_NEED_MORE 0 // 프레임이 아직 다 도착하지 않음
+#define PROTO_BAD_FRAME -1 // 잘못된 프레임 (1바이트 건너뛰고 재동기화)
+
+// 버퍼 앞에서 프레임 하나를 디코드 (성공 시 소비한 바이트 수 반환)
+int proto_decode(const uint8_t* buf, size_t len, struct proto_frame* out);
+
+// 헤더와 payload를 buf에 인코딩 (성공 시 프레임 길이, 공간 부족 시 0 반환)
+size_t proto_encode(uint8_t* buf, size_t cap, uint8_t type, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const void* payload, uint8_t payload_len);
+
+// 인코딩된 프레임에 spool 보관 표시를 남기는 함수
+void proto_mark_spooled(uint8_t* frame);
+
+// 센서별 인코딩 함수
+size_t proto_encode_temp(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, float temperature, float humidity);
+size_t proto_encode_light(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int light);
+size_t proto_encode_pir(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int motion);
+size_t proto_encode_pir_event(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, int motion, uint8_t kind);
+size_t proto_encode_hello(uint8_t* buf, size_t cap, uint32_t node_id, uint64_t timestamp_ms, uint8_t sensor_type, uint16_t site_id, uint16_t zone_id);
+size_t proto_encode_analog(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_analog* channels, int count);
+size_t proto_encode_decision(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, float wbgt, int alert, uint16_t site_id, uint16_t zone_id);
+size_t proto_encode_wbgt(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_wbgt* report);
+size_t proto_encode_control(uint8_t* buf, size_t cap, uint32_t node_id, uint32_t seq, uint64_t timestamp_ms, const struct proto_control* control);
+
+// 측정 묶음 함수
+void proto_batch_reset(struct proto_batch* batch); // 빈 묶음으로 초기화
+int proto_batch_add(struct proto_batch* batch, const uint8_t* frame, size_t len); // 인코딩된 측정 프레임 추가 (같은 노드의 다음 seq가 아니거나 자리가 없으면 -1)
+size_t proto_encode_batch(uint8_t* buf, size_t cap, const struct proto_batch* batch); // 묶음 프레임 인코딩 (측정이 하나뿐이면 일반 프레임으로)
+int proto_batch_next(const struct proto_frame* batch, size_t* offset, uint32_t* index, struct proto_frame* out); // 다음 측정 꺼내기 (offset, index는 0에서 시작, 있으면 1, 끝이면 0, 잘못된 묶음이면 -1)
+
+// 센서별 payload 해석 함수 (payload 길이가 맞지 않으면 -1 반환)
+int proto_parse_temp(const struct proto_frame* frame, float* temperature, float* humidity);
+int proto_parse_light(const struct proto_frame* frame, int* light);
+int proto_parse_pir(const struct proto_frame* frame, int* motion, uint8_t* kind);
+int proto_parse_hello(const struct proto_frame* frame, uint8_t* sensor_type, uint16_t* site_id, uint16_t* zone_id);
+int proto_parse_analog(const struct proto_frame* frame, struct proto_analog* channels, int max); // 채널 수 반환
+int proto_parse_decision(const struct proto_frame* frame, float* wbgt, int* alert, uint16_t* site_id, uint16_t* zone_id);
+int proto_parse_wbgt(const struct proto_frame* frame, struct proto_wbgt* report);
+int proto_parse_control(const struct proto_frame* frame, struct proto_control* control);
+
+// 현재 시각을 ms 단위로 반환 (프레임 시각용, 시계 조정에 따라 뛸 수 있음)
+uint64_t proto_now_ms(void);
+
+// 단조 증가 시각을 ms 단위로 반환 (주기/마감 계산용, NTP 동기화 등으로 시계가 바뀌어도 뛰지 않음)
+uint64_t proto_monotonic_ms(void);
+
+#endif
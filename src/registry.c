@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "protocol.h"
+#include "registry.h"
+
+/*
+ * node_id를 키로 하는 open addressing 해시 테이블
+ * 테이블에는 노드 포인터만 저장하므로 확장 후에도 노드 포인터는 그대로 유지됨
+ * (연결 구조체가 포인터를 캐시해 두고 메시지마다 조회하지 않도록 하기 위함)
+ */
+#define REGISTRY_MIN_CAPACITY 64 // 최소 테이블 크기
+#define REGISTRY_MAX_LOAD 70 // 최대 사용률 (%) - 넘으면 두 배로 확장
+
+static struct sensor_node** table = NULL; // 해시 테이블 (크기는 항상 2의 거듭제곱)
+static size_t table_size = 0; // 테이블 크기
+static size_t node_count = 0; // 등록된 노드 수
+static pthread_rwlock_t table_lock = PTHREAD_RWLOCK_INITIALIZER; // 테이블 보호용 락
+
+// node_id를 테이블 위치로 변환하는 함수 (Fibonacci hashing: 곱의 상위 log2(size) 비트를 사용, 연속된 node_id도 고르게 퍼짐)
+static size_t hash_node(uint32_t node_id, size_t size)
+{
+    int bits = __builtin_ctzll(size); // 테이블 크기는 2의 거듭제곱
+    return (uint32_t)(node_id * 2654435761u) >> (32 - bits);
+}
+
+// 테이블에서 node_id의 슬롯 위치를 찾는 함수 (빈 슬롯 또는 해당 노드의 슬롯)
+static size_t find_slot(struct sensor_node** slots, size_t size, uint32_t node_id)
+{
+    size_t mask = size - 1;
+    size_t i = hash_node(node_id, size);
+    while (slots[i] != NULL && slots[i]->node_id != node_id)
+    {
+        i = (i + 1) & mask; // linear probing
+    }
+    return i;
+}
+
+// 테이블을 새 크기로 재구성하는 함수
+static int resize_table(size_t new_size)
+{
+    struct sensor_node** slots = calloc(new_size, sizeof(*slots));
+    if (slots == NULL)
+    {
+        perror("registry calloc failed");
+        return -1;
+    }
+    for (size_t i = 0; i < table_size; i++)
+    {
+        if (table[i] != NULL)
+        {
+            slots[find_slot(slots, new_size, table[i]->node_id)] = table[i];
+        }
+    }
+    free(table);
+    table = slots;
+    table_size = new_size;
+    return 0;
+}
+
+// 레지스트리 초기화 함수
+int registry_init(size_t capacity)
+{
+    size_t size = REGISTRY_MIN_CAPACITY;
+    while (size * REGISTRY_MAX_LOAD / 100 < capacity)
+    {
+        size <<= 1;
+    }
+
+    pthread_rwlock_wrlock(&table_lock);
+    int ret = resize_table(size);
+    pthread_rwlock_unlock(&table_lock);
+    return ret;
+}
+
+// 노드 등록 또는 정보 갱신 함수
+struct sensor_node* registry_register(uint32_t node_id, uint8_t type, uint16_t site_id, uint16_t zone_id)
+{
+    struct sensor_node* node = NULL;
+
+    pthread_rwlock_wrlock(&table_lock);
+    if ((node_count + 1) * 100 > table_size * REGISTRY_MAX_LOAD && resize_table(table_size ? table_size * 2 : REGISTRY_MIN_CAPACITY) == -1)
+    {
+        pthread_rwlock_unlock(&table_lock);
+        return NULL;
+    }
+
+    size_t slot = find_slot(table, table_size, node_id);
+    node = table[slot];
+    if (node == NULL)
+    {
+        node = calloc(1, sizeof(*node)); // 새 노드 할당
+        if (node == NULL)
+        {
+            perror("registry calloc failed");
+            pthread_rwlock_unlock(&table_lock);
+            return NULL;
+        }
+        node->node_id = node_id;
+        node->registered_ms = proto_now_ms();
+        node->motion = -1;
+        table[slot] = node;
+        node_count++;
+    }
+    // 재접속한 노드는 새로 알린 정보로 갱신
+    node->type = type;
+    node->site_id = site_id;
+    node->zone_id = zone_id;
+    pthread_rwlock_unlock(&table_lock);
+    return node;
+}
+
+// 노드 ID로 조회하는 함수
+struct sensor_node* registry_lookup(uint32_t node_id)
+{
+    struct sensor_node* node = NULL;
+
+    pthread_rwlock_rdlock(&table_lock);
+    if (table_size > 0)
+    {
+        node = table[find_slot(table, table_size, node_id)];
+    }
+    pthread_rwlock_unlock(&table_lock);
+    return node;
+}
+
+// 등록된 노드 수를 반환하는 함수
+size_t registry_count(void)
+{
+    pthread_rwlock_rdlock(&table_lock);
+    size_t count = node_count;
+    pthread_rwlock_unlock(&table_lock);
+    return count;
+}
+
+// 등록된 모든 노드를 순회하는 함수
+void registry_foreach(registry_visit visit, void* arg)
+{
+    pthread_rwlock_rdlock(&table_lock);
+    for (size_t i = 0; i < table_size; i++)
+    {
+        if (table[i] != NULL)
+        {
+            visit(table[i], arg);
+        }
+    }
+    pthread_rwlock_unlock(&table_lock);
+}
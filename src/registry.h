@@ -0,0 +1,47 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 등록된 센서 노드 정보
+struct sensor_node
+{
+    uint32_t node_id; // 노드 ID
+    uint8_t type; // 센서 종류 (enum proto_type)
+    uint16_t site_id; // 현장 ID
+    uint16_t zone_id; // 현장 내 구역 ID
+    uint64_t registered_ms; // 최초 등록 시각
+    atomic_uint_least64_t messages; // 받은 측정 메시지 수
+    int motion; // PIR 노드의 마지막 모션 상태 (-1: 아직 모름)
+
+    // UDP로 받은 프레임의 시퀀스 번호로 계산한 손실 (노드 현장을 소유한 shard만 갱신)
+    int seq_valid; // 시퀀스 기준값이 있는지 여부
+    uint32_t seq_base; // 계산을 시작한 시퀀스 번호
+    uint32_t seq_max; // 지금까지 받은 가장 큰 시퀀스 번호
+    uint64_t seq_received; // seq_base 이후 받은 프레임 수
+    uint64_t seq_lost_before; // 노드가 다시 시작되기 전까지의 손실
+    atomic_uint_least64_t datagram_frames; // UDP로 받은 프레임 수
+    atomic_uint_least64_t datagram_lost; // 잃어버린 것으로 보이는 프레임 수
+};
+
+// 노드 순회 함수
+typedef void (*registry_visit)(const struct sensor_node* node, void* arg);
+
+// 레지스트리 초기화 (capacity는 예상 노드 수, 필요 시 자동 확장)
+int registry_init(size_t capacity);
+
+// 노드 등록 또는 정보 갱신 (이미 있는 노드는 같은 포인터를 반환)
+struct sensor_node* registry_register(uint32_t node_id, uint8_t type, uint16_t site_id, uint16_t zone_id);
+
+// 노드 ID로 조회 (없으면 NULL)
+struct sensor_node* registry_lookup(uint32_t node_id);
+
+// 등록된 노드 수
+size_t registry_count(void);
+
+// 등록된 모든 노드 순회 (순회하는 동안 등록은 대기함)
+void registry_foreach(registry_visit visit, void* arg);
+
+#endif
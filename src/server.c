@@ -1,505 +1,2171 @@
+#define _GNU_SOURCE // accept4 사용을 위해 정의
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #include <unistd.h>
+#include <errno.h>
 #include <pthread.h>
+#include <sched.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
-#include <math.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <wiringPi.h>
 #include <softTone.h>
+#include "protocol.h"
+#include "registry.h"
+#include "site.h"
+#include "alert.h"
+#include "gpio.h"
+#include "tsdb.h"
+#include "metrics.h"
+#include "wbgt.h"
+#include "shard.h"
+#include "pipeline.h"
+#include "capture.h"
 
 // GPIO 관련 설정
 #define POUT 18 // 부저 핀 번호
 #define POUT1 20 // LED 핀 번호
-#define LOW 0 // LOW 값 정의
-#define HIGH 1 // HIGH 값 정의
-#define IN 0 // 입력 방향 정의
-#define OUT 1 // 출력 방향 정의
-#define BUFFER_SIZE 1024 // 버퍼 크기 정의
-#define BUFFER_MAX 3 // 버퍼 최대 크기 정의
-#define VALUE_MAX 40 // 값의 최대 크기 정의
-#define DIRECTION_MAX 35 // 방향 문자열 최대 크기 정의
 
 // port 번호 설정
 #define SERVER_PORT 8080 // 서버 포트 번호 정의
 
-// 클라이언트 IP 주소 설정
-#define TEMP_CLIENT_IP "192.168.45.11" // 온도 클라이언트 IP 주소
-#define LIGHT_CLIENT_IP "192.168.45.10" // 조도 클라이언트 IP 주소
-#define PIR_CLIENT_IP "192.168.45.4" // PIR 클라이언트 IP 주소
+// 이벤트 루프 설정
+#define MAX_EVENTS 256 // epoll_wait 한 번에 처리할 최대 이벤트 수
+#define CONN_BUFFER_SIZE 2048 // 연결별 수신 버퍼 크기 (최대 프레임 크기보다 커야 함, 클수록 recv 한 번에 여러 프레임을 처리)
+#define CONN_NODES 8 // 한 연결로 등록할 수 있는 최대 노드 수 (여러 센서를 가진 에이전트는 센서마다 HELLO를 보냄)
+#define CONN_OUT_SIZE (CONN_NODES * PROTO_MAX_FRAME) // 연결별 송신 대기 버퍼 크기 (한 번에 보내는 응답 프레임 묶음의 최대 크기)
+
+// UDP 수신 설정 (TCP와 같은 포트 번호)
+#define UDP_BATCH 64 // recvmmsg 한 번에 받을 최대 데이터그램 수
+#define UDP_DATAGRAM_SIZE 2048 // 데이터그램 최대 크기 (프레임 여러 개를 이어 보낼 수 있음)
+#define UDP_RCVBUF (4 << 20) // UDP 수신 버퍼 크기 (순간적으로 몰리는 데이터그램 흡수)
+#define UDP_INBOX_SIZE 4096 // shard별 UDP 프레임 인계 큐 크기 (가득 차면 버리고 계측값으로 셈)
+#define SEQ_RESET_WINDOW 1024 // 시퀀스 번호가 이만큼 넘게 뒤로 가면 노드가 다시 시작된 것으로 봄
+
+// 노드 레지스트리 설정
+#define REGISTRY_CAPACITY 4096 // 시작 시 예약할 노드 수 (넘으면 자동 확장)
+#define LEGACY_NODE_ID_BASE 0xFFFFFF00u // 핸드셰이크 없는 기존 노드에 부여할 ID 시작값
+#define LEGACY_SITE_ID 0 // 기존 노드가 속한 현장 ID
+
+// 측정 속도 조절 설정 (현장 WBGT가 임계치에 가까울수록 노드가 더 자주 측정하고 보고하도록 지시)
+#define RATE_FAST_MARGIN 2.0f // 임계치까지 이만큼 이하로 남으면 빠르게
+#define RATE_RELAXED_MARGIN 6.0f // 임계치보다 이만큼 넘게 낮으면 느리게
+#define RATE_HYSTERESIS 0.5f // 느린 단계로 내려갈 때 경계보다 더 내려가야 하는 폭 (경계에서 단계가 오가지 않도록)
+
+// 측정값 이력 저장 위치
+#define TSDB_DIR "data" // 시계열 세그먼트 파일을 둘 디렉터리
+
+// 처리 단계 설정 (수신 -> 센서 융합/WBGT -> 알람 / 이력 기록 / 로그 출력)
+#define PERSIST_QUEUE_SIZE 8192 // 수신 쓰레드별 이력 기록 큐 크기
+#define LOG_QUEUE_SIZE 1024 // 수신 쓰레드별 로그 큐 크기
+#define LOG_LINE_SIZE 120 // 로그 한 줄 최대 길이
+#define STAGE_DRAIN_BATCH 256 // 단계 쓰레드가 생산자마다 한 번에 처리할 최대 항목 수
+
+// 재생 설정
+#define REPLAY_MISMATCH_REPORT 10 // 재생 결과가 다를 때 자세히 출력할 최대 판정 수
+
+// 핸드셰이크를 보내지 않는 기존 텍스트 노드의 IP 매핑
+static const struct legacy_client
+{
+    const char* ip; // 클라이언트 IP 주소
+    uint8_t type; // 센서 종류 (enum proto_type)
+} legacy_clients[] = {
+    {"192.168.45.11", PROTO_TEMP}, // 온도 클라이언트
+    {"192.168.45.10", PROTO_LIGHT}, // 조도 클라이언트
+    {"192.168.45.4", PROTO_PIR}, // PIR 클라이언트
+};
+
+// 센서 종류별 단계마다 지시할 측정/보고 간격 (enum proto_rate 순서, 0은 노드의 기본값으로 되돌림)
+static const struct proto_control temp_rates[] = {
+    [PROTO_RATE_RELAXED] = {PROTO_RATE_RELAXED, 10000000, 20000}, // 10초마다 측정, 20초마다 보고 (보고 주기가 FUSION_MAX_AGE_MS보다 길면 융합할 온습도가 없는 구간이 생김)
+    [PROTO_RATE_NORMAL] = {PROTO_RATE_NORMAL, 0, 0}, // 노드에 설정된 기본값 (2초마다 측정, 20초마다 보고)
+    [PROTO_RATE_FAST] = {PROTO_RATE_FAST, 1000000, 5000}, // DHT11 최소 간격(1초)으로 측정, 5초마다 보고
+};
+static const struct proto_control light_rates[] = {
+    [PROTO_RATE_RELAXED] = {PROTO_RATE_RELAXED, 10000, 5000}, // 100Hz 스캔, 5초마다 보고
+    [PROTO_RATE_NORMAL] = {PROTO_RATE_NORMAL, 0, 0}, // 노드에 설정된 기본값 (500Hz 스캔, 1초마다 보고)
+    [PROTO_RATE_FAST] = {PROTO_RATE_FAST, 1000, 500}, // 1kHz 스캔, 0.5초마다 보고
+};
+
+// 연결의 메시지 형식
+enum conn_mode
+{
+    MODE_UNKNOWN = 0, // 첫 바이트를 받기 전
+    MODE_TEXT, // 기존 ASCII 텍스트 메시지
+    MODE_BINARY, // 길이 정보가 있는 바이너리 프레임 (protocol.h)
+    MODE_DATAGRAM // UDP 데이터그램으로 받은 바이너리 프레임 (모든 UDP 노드가 한 상태를 공유)
+};
+
+// 연결별 상태 구조체 (쓰레드 대신 이벤트 루프가 이 구조체로 연결을 관리)
+struct client_conn
+{
+    int fd; // 클라이언트 소켓 파일 디스크립터
+    uint32_t id; // 연결 번호 (수신 기록과 재생에서 연결을 구분)
+    struct sensor_node* node; // 처리 중인 프레임의 노드 (핸드셰이크 전에는 NULL)
+    struct sensor_node* nodes[CONN_NODES]; // 이 연결로 HELLO를 보낸 노드 (모두 같은 현장)
+    int node_count; // 등록된 노드 수
+    int mode; // 메시지 형식 (enum conn_mode)
+    int text_lines; // 텍스트 메시지에 줄바꿈 구분자를 사용하는지 여부
+    uint32_t seq; // 처리 중인 프레임의 시퀀스 번호 (판정 응답에 사용)
+    uint64_t batch_end_ms; // 처리 중인 묶음의 마지막 측정 시각 (노드 시계, 묶음 밖이면 0)
+    uint64_t recv_ns; // 마지막 수신 시각 (계측용)
+    uint64_t parse_ns; // 처리 중인 메시지의 해석 완료 시각 (계측용)
+    int shard; // 연결을 처리하는 shard (-1이면 UDP 수신 쓰레드)
+    int handoff; // 현장을 소유한 shard로 넘겨야 하면 그 번호 (-1이면 없음)
+    struct client_conn* next; // 인계 대기 목록의 다음 연결
+    struct client_conn* site_prev; // 같은 현장 연결 목록의 이전 연결
+    struct client_conn* site_next; // 같은 현장 연결 목록의 다음 연결
+    int site_linked; // 현장 연결 목록에 들어 있는지 여부
+    int rate_sent; // 이 연결에 마지막으로 보낸 측정 속도 단계 (0이면 보낸 적 없음)
+    size_t out_len; // 송신 대기 버퍼에 남은 바이트 수
+    uint8_t out[CONN_OUT_SIZE]; // 프레임 중간에서 끊긴 응답의 나머지 (다음 응답보다 먼저 보내 노드가 잘린 프레임을 받지 않게 함)
+    size_t len; // 버퍼에 쌓인 바이트 수
+    char buffer[CONN_BUFFER_SIZE]; // 수신 버퍼
+};
+
+// 이력 기록 단계로 보내는 측정값 (tsdb_append 인자)
+struct persist_record
+{
+    uint64_t timestamp_ms; // 측정 시각
+    uint32_t node_id; // 노드 ID
+    uint16_t site_id; // 현장 ID
+    uint8_t kind; // 기록 종류 (enum tsdb_kind)
+    float value[3]; // 값
+};
+
+// 로그 출력 단계로 보내는 한 줄
+struct log_line
+{
+    char text[LOG_LINE_SIZE];
+};
 
-// WBGT 임계치 설정
-#define WBGT_LIMIT 15 // WBGT 임계치 정의
+// shard별 이벤트 루프 (shard.h)
+struct shard_loop
+{
+    int id; // shard 번호
+    int listen_fd; // SO_REUSEPORT 리슨 소켓 (커널이 새 연결을 shard들에 나눠 줌)
+    int epoll_fd; // epoll 인스턴스
+    int wake_fd; // 연결을 넘겨받았음을 알리는 eventfd
+    pthread_mutex_t inbox_lock; // 인계 대기 목록 보호 (연결마다 최대 한 번, 등록할 때만 사용)
+    struct client_conn* inbox; // 다른 shard가 넘긴 연결 목록
+    struct pipeline_stage udp_inbox; // UDP 수신 쓰레드가 넘긴 측정 프레임 (wake_fd를 epoll에 등록)
+    char udp_name[16]; // udp_inbox 계측값 이름
+    struct client_conn* udp_conn; // 이 shard에서 UDP 프레임을 처리할 때 쓰는 연결 상태 (모든 UDP 노드가 공유)
+};
+
+// UDP 수신 쓰레드가 현장을 소유한 shard로 넘기는 프레임
+struct udp_frame
+{
+    uint64_t recv_ns; // 수신 시각 (계측용)
+    uint16_t len; // 프레임 길이
+    uint8_t bytes[PROTO_MAX_FRAME]; // 인코딩된 프레임
+};
 
 // 전역 변수
-float temperature = 0.0, humidity = 0.0, tg = 0.0, wbgt = 0.0, hum_temperature = 0.0; // 온도, 습도, 흑구온도, WBGT, 습구온도 변수
-int temp_flag = 0, light_flag = 0, enable = 0; // 수신 상태 플래그 변수
-const int minFreq = 200; // 주파수의 최소값 설정
-const int maxFreq = 1000; // 주파수의 최대값 설정
-const int step = 10; // 주파수를 증가/감소시키는 단위 설정
-const int delayTime = 10; // 딜레이 시간 설정 (밀리초 단위, 즉 0.01초)
+
+static struct shard_loop loops[SHARD_MAX]; // shard별 이벤트 루프
+static __thread struct shard_loop* self_loop = NULL; // 현재 쓰레드의 shard (UDP 수신 쓰레드는 NULL)
+static struct pipeline_stage persist_stage; // 이력 기록 단계 입력 (디스크 쓰기가 수신을 막지 않도록 분리)
+static struct pipeline_stage log_stage; // 로그 출력 단계 입력 (터미널 출력이 수신을 막지 않도록 분리)
+static atomic_uint next_conn_id = 1; // 다음 연결 번호
+static struct client_conn* site_conns[SITE_MAX]; // 현장별 바이너리 TCP 연결 목록 (현장을 소유한 shard 쓰레드만 접근)
+static int replaying = 0; // 기록 파일 재생 중인지 여부 (이력, 로그, 알람 장치를 건드리지 않음)
+static uint64_t replay_now_ms = 0; // 재생 중인 레코드의 기록 당시 시각
+
+// 재생 결과 검증용 판정 목록
+struct replay_decision
+{
+    struct capture_decision d; // 판정
+    size_t order; // 판정 순서 (현장별로 정렬할 때 순서 유지용)
+};
+static struct replay_decision* replayed = NULL; // 재생 중 내린 판정
+static size_t replayed_count = 0, replayed_capacity = 0;
+
+static struct gpio_lines led_line; // 경고등 GPIO 라인 (시작 시 한 번 요청해 계속 사용)
+static int decision_ack = 0; // WBGT 판정 결과를 측정 노드에 돌려보낼지 여부 (부하 테스트용)
 
 // 함수 선언
-static int GPIOExport(int pin); // GPIO 핀을 활성화하는 함수
-static int GPIODirection(int pin, int dir); // GPIO 핀의 방향을 설정하는 함수
-static int GPIOWrite(int pin, int value); // GPIO 핀에 값을 쓰는 함수
-static int GPIOUnexport(int pin); // GPIO 핀을 비활성화하는 함수
-
-void* handle_client_temp(void* arg); // 온도 클라이언트 요청을 처리하는 함수
-void* handle_client_light(void* arg); // 조도 클라이언트 요청을 처리하는 함수
-void* handle_client_PIR(void* arg); // PIR 클라이언트 요청을 처리하는 함수
-void* alert(void* arg); // 알람 기능을 수행하는 함수
-void cal_wbgt(); // WBGT를 계산하고 알람을 활성화하는 함수
-void* handle_client(void* arg); // 클라이언트 요청을 처리하는 함수
+
+void handle_client_temp(struct client_conn* conn, uint64_t timestamp_ms, float temp, float hum); // 온도 클라이언트 메시지를 처리하는 함수
+void handle_client_light(struct client_conn* conn, uint64_t timestamp_ms, int light); // 조도 클라이언트 메시지를 처리하는 함수
+void handle_client_PIR(struct client_conn* conn, uint64_t timestamp_ms, int pir, uint8_t kind); // PIR 클라이언트 메시지를 처리하는 함수
+void handle_client_analog(struct client_conn* conn, uint64_t timestamp_ms, const struct proto_analog* channels, int count); // 다채널 아날로그 메시지를 처리하는 함수
+void handle_client_wbgt(struct client_conn* conn, uint64_t timestamp_ms, const struct proto_wbgt* report); // 엣지 노드가 계산한 WBGT를 처리하는 함수
+static int store_wbgt(struct site_state* site, struct site_reading* w, float temperature, float humidity, float wet_bulb, float tg, float wbgt, uint64_t wbgt_ms); // 현장의 WBGT 결과를 갱신하는 함수
+static void announce_rate(struct site_state* site, int level, float wbgt); // 바뀐 측정 속도 단계를 알리는 함수
+static void update_light(struct client_conn* conn, uint64_t timestamp_ms, int light, const float* globe); // 조도/흑구 값을 현장 상태에 반영하는 함수
+int cal_wbgt(struct site_state* site, uint16_t zone_id, uint64_t timestamp_ms, float* wbgt_out, uint64_t* tick_out); // 새 샘플 시각의 WBGT를 계산하고 알람을 요청하는 함수
+static void report_decision(struct client_conn* conn, int decision, float wbgt, uint64_t tick_ms); // 판정 결과를 계측하고 노드에 돌려보내는 함수
+struct sensor_node* handle_client(int client_sock); // 기존 텍스트 노드를 IP로 찾아 등록하는 함수
+void* event_loop(void* arg); // shard의 epoll 이벤트 루프 함수
+void* udp_loop(void* arg); // UDP 데이터그램 수신 루프 함수
+
+static int set_nonblocking(int fd); // 소켓을 논블로킹 모드로 설정하는 함수
+static void raise_fd_limit(void); // 파일 디스크립터 제한을 최대로 올리는 함수
+static void buzzer_tone(int freq); // 부저 주파수를 설정하는 함수
+static void alert_led(int on); // 경고등을 켜고 끄는 함수
+static void accept_clients(struct shard_loop* loop); // 대기 중인 연결을 모두 수락하는 함수
+static void read_client(struct client_conn* conn); // 연결에서 데이터를 읽어 처리하는 함수
+static void process_buffer(struct client_conn* conn); // 버퍼에 쌓인 메시지를 처리하는 함수
+static void close_client(struct client_conn* conn); // 연결을 종료하고 상태를 해제하는 함수
+static size_t process_binary(struct client_conn* conn); // 버퍼의 바이너리 프레임을 처리하는 함수
+static size_t process_text(struct client_conn* conn); // 버퍼의 텍스트 메시지를 처리하는 함수
+static void dispatch_frame(struct client_conn* conn, const struct proto_frame* frame); // 프레임을 센서별 처리 함수로 전달하는 함수
+static uint64_t batch_end_ms(const struct proto_frame* batch); // 묶음의 마지막 측정 시각을 구하는 함수
+static void dispatch_text(struct client_conn* conn, const char* msg); // 텍스트 메시지를 센서별 처리 함수로 전달하는 함수
+static void register_node(struct client_conn* conn, uint32_t node_id, uint8_t type, uint16_t site_id, uint16_t zone_id); // 노드를 등록하고 연결에 연결하는 함수
+static const char* sensor_name(const struct sensor_node* node); // 노드 종류 이름을 반환하는 함수
+static void mark_parsed(struct client_conn* conn); // 메시지 해석 완료를 기록하는 함수
+static void record_backlog(struct client_conn* conn, const struct proto_frame* frame); // 밀린 측정을 이력에만 기록하는 함수
+static void track_sequence(struct sensor_node* node, uint32_t seq); // UDP 프레임 손실을 계산하는 함수
+static int open_udp_socket(void); // UDP 수신 소켓을 여는 함수
+static int open_tcp_socket(void); // shard의 TCP 리슨 소켓을 여는 함수
+static int configured_shards(void); // 사용할 shard 수를 정하는 함수
+static int watch_client(struct client_conn* conn); // 연결을 현재 shard의 epoll에 등록하는 함수
+static void handoff_client(struct client_conn* conn); // 연결을 현장을 소유한 shard로 넘기는 함수
+static int route_frame(struct client_conn* conn, const struct proto_frame* frame); // 프레임 노드의 현장을 다른 shard가 소유하는지 확인하는 함수
+static void adopt_clients(struct shard_loop* loop); // 다른 shard가 넘긴 연결을 받아 처리하는 함수
+static int open_udp_inbox(struct shard_loop* loop); // shard의 UDP 프레임 인계 큐를 준비하는 함수
+static void drain_udp_inbox(struct shard_loop* loop); // UDP 수신 쓰레드가 넘긴 프레임을 처리하는 함수
+static void persist(uint64_t timestamp_ms, uint32_t node_id, uint16_t site_id, uint8_t kind, float v0, float v1, float v2); // 측정값을 이력 기록 단계로 보내는 함수
+static void log_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2))); // 로그를 출력 단계로 보내는 함수
+static int start_stages(void); // 이력 기록과 로그 출력 단계 쓰레드를 시작하는 함수
+static uint64_t server_now_ms(void); // 서버 기준 현재 시각을 구하는 함수 (재생 중에는 기록 당시 시각)
+static int replay_capture(const char* path, double speed); // 기록 파일을 처리 함수에 다시 넣는 함수
+static int rate_level(int current, float wbgt); // WBGT로 측정 속도 단계를 정하는 함수
+static void link_site(struct client_conn* conn); // 연결을 현장 연결 목록에 넣는 함수
+static void unlink_site(struct client_conn* conn); // 연결을 현장 연결 목록에서 빼는 함수
+static void sync_rate(struct client_conn* conn); // 현장의 측정 속도 단계를 연결에 알리는 함수
+static int flush_reply(struct client_conn* conn); // 보내다 만 응답의 나머지를 보내는 함수
+static int send_reply(struct client_conn* conn, const uint8_t* frames, size_t len); // 응답 프레임을 노드로 보내는 함수
+static void push_rate(uint16_t site_id); // 현장의 모든 연결에 측정 속도 단계를 알리는 함수
 
 // 메인 함수
-int main()
+int main(int argc, char* argv[])
 {
-    // GPIO 초기화
-    if (GPIOExport(POUT) == -1)
+    // 기록 재생 모드: server --replay <파일> [1 | N | max]
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0)
     {
-        return 1;
+        double speed = 1.0;
+        if (argc >= 4)
+        {
+            speed = strcmp(argv[3], "max") == 0 ? 0.0 : atof(argv[3]);
+            if (speed < 0 || (speed == 0 && strcmp(argv[3], "max") != 0))
+            {
+                fprintf(stderr, "Usage: %s --replay <capture file> [speed | max]\n", argv[0]);
+                return 1;
+            }
+        }
+        return replay_capture(argv[2], speed);
     }
 
-    // GPIO 방향 설정 (출력으로 설정)
-    if (GPIODirection(POUT, 1) == -1)
+    // 경고등 GPIO 라인 요청
+    unsigned int led_pin = POUT1;
+    if (gpio_request(&led_line, GPIO_CHIP, &led_pin, 1, GPIO_OUTPUT, 0, "wbgt-server") == -1)
     {
-        return 2;
+        return 1;
     }
 
-    // POUT1 GPIO 초기화 및 방향 설정
-    if (GPIOExport(POUT1) == -1)
+    // 부저는 알람 스케줄러가 단독으로 사용하므로 한 번만 초기화
+    wiringPiSetupGpio(); // WiringPi GPIO 초기화
+    softToneCreate(POUT); // 소프트 톤 생성
+
+    // 알람 스케줄러 쓰레드 시작
+    struct alert_actuators actuators = {.tone = buzzer_tone, .led = alert_led};
+    if (alert_start(&actuators) == -1)
     {
-        return 1;
+        return 3;
     }
-    if (GPIODirection(POUT1, 1) == -1)
+
+    // 수천 개의 센서 연결을 유지할 수 있도록 파일 디스크립터 제한 상향
+    raise_fd_limit();
+
+    // 노드 레지스트리 초기화
+    if (registry_init(REGISTRY_CAPACITY) == -1)
     {
-        return 2;
+        exit(EXIT_FAILURE);
     }
 
-    int server_sock; // 서버 소켓 파일 디스크립터
-    struct sockaddr_in server_addr; // 서버 주소 구조체
-    struct sockaddr_in client_addr; // 클라이언트 주소 구조체
-    socklen_t client_addr_size; // 클라이언트 주소 크기 변수
+    // 계측값 조회 쓰레드 시작 (실패해도 서버는 계속 동작)
+    metrics_start(METRICS_PORT);
 
-    // 소켓 생성
-    server_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_sock == -1)
+    // 부하 생성기가 지연 시간을 잴 수 있도록 판정 결과 응답 사용 여부 결정
+    const char* ack = getenv("WBGT_DECISION_ACK");
+    decision_ack = (ack != NULL && strcmp(ack, "1") == 0);
+
+    // 측정값 이력 저장소 열기 (실패해도 알람 처리는 계속)
+    if (tsdb_open(TSDB_DIR) == -1)
     {
-        perror("socket creation failed"); // 소켓 생성 실패 시 에러 출력
-        exit(EXIT_FAILURE); // 프로그램 종료
+        fprintf(stderr, "Time-series store disabled, readings will not be recorded\n");
     }
 
-    // 서버 주소 초기화
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET; // IPv4 설정
-    server_addr.sin_port = htons(SERVER_PORT); // 포트 번호 설정
-    server_addr.sin_addr.s_addr = INADDR_ANY; // 모든 인터페이스에서 수신
-
-    // 소켓 바인딩
-    if (bind(server_sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1)
+    // 느린 작업(디스크, 터미널 출력)을 맡을 단계 쓰레드 시작
+    if (start_stages() == -1)
     {
-        perror("socket bind failed"); // 소켓 바인딩 실패 시 에러 출력
-        close(server_sock); // 소켓 닫기
-        exit(EXIT_FAILURE); // 프로그램 종료
+        exit(EXIT_FAILURE);
     }
 
-    // 연결 대기
-    if (listen(server_sock, 5) == -1)
+    // 수신 스트림 기록 (WBGT_CAPTURE=<파일>, 재생 도구로 다시 처리할 수 있음)
+    const char* capture_path = getenv("WBGT_CAPTURE");
+    if (capture_path != NULL && capture_open(capture_path) == 0)
     {
-        perror("listen failed"); // 연결 대기 실패 시 에러 출력
-        close(server_sock); // 소켓 닫기
-        exit(EXIT_FAILURE); // 프로그램 종료
+        printf("Recording received messages to %s\n", capture_path);
     }
-    printf("Server is listening on port %d\n", SERVER_PORT); // 서버가 포트에서 대기 중임을 출력
 
-    while (1)
+    // shard마다 리슨 소켓, epoll, 인계 알림을 준비 (인계는 어느 shard로든 갈 수 있으므로 쓰레드 시작 전에 모두 준비)
+    int shards = shard_init(configured_shards());
+    for (int i = 0; i < shards; i++)
     {
-        client_addr_size = sizeof(client_addr); // 클라이언트 주소 크기 설정
-        int* client_sock = malloc(sizeof(int)); // 클라이언트 소켓 파일 디스크립터 동적 할당
-        *client_sock = accept(server_sock, (struct sockaddr*)&client_addr, &client_addr_size); // 클라이언트 연결 수락
+        struct shard_loop* loop = &loops[i];
+        struct epoll_event ev;
+        loop->id = i;
+        loop->listen_fd = open_tcp_socket();
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        pthread_mutex_init(&loop->inbox_lock, NULL);
+        if (loop->listen_fd == -1 || loop->epoll_fd == -1 || loop->wake_fd == -1 || open_udp_inbox(loop) == -1)
+        {
+            perror("shard setup failed"); // 준비 실패 시 에러 출력
+            exit(EXIT_FAILURE); // 프로그램 종료
+        }
 
-        if (*client_sock == -1)
+        // 리슨 소켓과 인계 알림 등록 (data.ptr이 NULL이면 리슨 소켓, loop 자신이면 인계 알림)
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, &ev) == -1)
+        {
+            perror("epoll_ctl failed"); // 등록 실패 시 에러 출력
+            exit(EXIT_FAILURE);
+        }
+        ev.data.ptr = loop;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev) == -1)
         {
-            perror("server accept failed"); // 연결 수락 실패 시 에러 출력
-            free(client_sock); // 메모리 해제
-            continue; // 다음 반복으로 넘어감
+            perror("epoll_ctl failed");
+            exit(EXIT_FAILURE);
         }
+    }
+    printf("Server is listening on port %d (%d shard%s)\n", SERVER_PORT, shards, shards > 1 ? "s" : ""); // 서버가 포트에서 대기 중임을 출력
+
+    // UDP 수신 쓰레드 시작 (연결 없이 보내는 저전력 노드용, 실패해도 TCP 수신은 계속)
+    static int udp_sock;
+    pthread_t udp_tid;
+    if ((udp_sock = open_udp_socket()) != -1 && pthread_create(&udp_tid, NULL, udp_loop, &udp_sock) == 0)
+    {
+        pthread_detach(udp_tid);
+        printf("Accepting UDP datagrams on port %d\n", SERVER_PORT);
+    }
 
+    // 나머지 shard 쓰레드 생성 (각 쓰레드는 자신의 리슨 소켓과 epoll 인스턴스를 가짐)
+    for (int i = 1; i < shards; i++)
+    {
         pthread_t tid; // 쓰레드 ID 변수
-        if (pthread_create(&tid, NULL, handle_client, client_sock) != 0)
+        if (pthread_create(&tid, NULL, event_loop, &loops[i]) != 0)
         {
             perror("pthread_create failed"); // 쓰레드 생성 실패 시 에러 출력
-            free(client_sock); // 메모리 해제
+            exit(EXIT_FAILURE); // 현장이 이미 shard에 배정되므로 일부만 실행할 수 없음
         }
         pthread_detach(tid); // 쓰레드를 분리하여 독립적으로 실행되도록 설정
     }
 
-    // 소켓 종료
-    close(server_sock);
+    // 메인 쓰레드는 shard 0을 실행
+    event_loop(&loops[0]);
 
     // GPIO 해제
-    GPIOUnexport(POUT);
-    GPIOUnexport(POUT1);
+    gpio_release(&led_line);
 
     return 0;
 }
 
-// 클라이언트 요청을 처리하는 함수
-void* handle_client(void* arg)
+// shard의 epoll 이벤트 루프 함수
+void* event_loop(void* arg)
 {
-    int client_sock = *(int*)arg; // 클라이언트 소켓 파일 디스크립터 가져오기
-    struct sockaddr_in client_addr; // 클라이언트 주소 구조체
-    socklen_t client_addr_len = sizeof(client_addr); // 클라이언트 주소 길이 변수
-    getpeername(client_sock, (struct sockaddr*)&client_addr, &client_addr_len); // 클라이언트 주소 정보 가져오기
+    struct shard_loop* loop = arg; // 이 쓰레드가 맡은 shard
+    struct epoll_event events[MAX_EVENTS]; // 발생한 이벤트 배열
+    self_loop = loop;
 
-    char client_ip[INET_ADDRSTRLEN]; // 클라이언트 IP 주소 문자열
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN); // 클라이언트 IP 주소를 문자열로 변환
-
-    if (strcmp(client_ip, PIR_CLIENT_IP) == 0)
-    {
-        printf("PIR client connected: %s\n", client_ip); // PIR 클라이언트 연결 메시지 출력
-        handle_client_PIR(arg); // PIR 클라이언트 처리 함수 호출
-    }
-    else if (strcmp(client_ip, TEMP_CLIENT_IP) == 0)
-    {
-        printf("Temperature client connected: %s\n", client_ip); // 온도 클라이언트 연결 메시지 출력
-        handle_client_temp(arg); // 온도 클라이언트 처리 함수 호출
-    }
-    else if (strcmp(client_ip, LIGHT_CLIENT_IP) == 0)
+    // shard가 여럿이면 쓰레드를 코어 하나에 고정 (현장 상태와 연결 버퍼가 한 코어의 캐시에 머묾)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (shard_count() > 1 && cpus > 0)
     {
-        printf("Light client connected: %s\n", client_ip); // 조도 클라이언트 연결 메시지 출력
-        handle_client_light(arg); // 조도 클라이언트 처리 함수 호출
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(loop->id % cpus, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        {
+            fprintf(stderr, "Shard %d could not be pinned to CPU %ld\n", loop->id, loop->id % cpus);
+        }
     }
-    return NULL;
-}
-
-// 온도 클라이언트 요청을 처리하는 함수
-void* handle_client_temp(void* arg)
-{
-    int client_sock = *(int*)arg; // 클라이언트 소켓 파일 디스크립터 가져오기
-    char buffer[BUFFER_SIZE]; // 수신 버퍼
-    int bytes_received; // 수신된 바이트 수
 
     while (1)
     {
-        bytes_received = recv(client_sock, buffer, BUFFER_SIZE, 0); // 데이터 수신
-        if (bytes_received <= 0)
+        int n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, -1); // 이벤트 대기
+        if (n == -1)
         {
-            if (bytes_received == 0)
-            {
-                printf("Temperature client disconnected\n"); // 클라이언트가 연결 종료 시 메시지 출력
-            }
-            else
+            if (errno == EINTR)
             {
-                perror("recv failed"); // 수신 실패 시 에러 출력
+                continue; // 시그널에 의한 중단은 무시
             }
-            break; // 루프 종료
+            perror("epoll_wait failed"); // 대기 실패 시 에러 출력
+            break;
         }
 
-        buffer[bytes_received] = '\0'; // 문자열 종료 문자 추가
-
-        // 문자열에서 온도와 습도를 파싱
-        if (sscanf(buffer, "%f %f", &temperature, &humidity) == 2)
-        {
-            printf("[Parsed Temperature: %.1f, Humidity: %.1f]\n", temperature, humidity); // 파싱된 온도와 습도 출력
-            hum_temperature = temperature * atan(0.152 * sqrt(humidity + 8.3136)) + atan(temperature + humidity) - atan(humidity - 1.67633) + 0.00391838 * pow(humidity, 1.5) * atan(0.0231 * humidity) - 4.686;
-            humidity = hum_temperature; // 습구 온도 계산
-
-            temp_flag = 1; // 온도 데이터 수신 완료 플래그
-
-            // 온습도 데이터를 받은 후 조도 데이터 수신 상태 확인 후 WBGT 처리
-            cal_wbgt();
-        }
-        else
+        for (int i = 0; i < n; i++)
         {
-            printf("Failed to parse temperature and humidity\n"); // 파싱 실패 시 메시지 출력
-        }
-    }
-
-    close(client_sock); // 클라이언트 소켓 닫기
-    free(arg); // 메모리 해제
-    return NULL;
-}
+            struct client_conn* conn = events[i].data.ptr; // 이벤트가 발생한 연결
 
-// 조도 클라이언트 요청을 처리하는 함수
-void* handle_client_light(void* arg)
-{
-    int client_sock = *(int*)arg; // 클라이언트 소켓 파일 디스크립터 가져오기
-    char buffer[BUFFER_SIZE]; // 수신 버퍼
-    int bytes_received; // 수신된 바이트 수
-
-    while (1)
-    {
-        bytes_received = recv(client_sock, buffer, BUFFER_SIZE, 0); // 데이터 수신
-        if (bytes_received <= 0)
-        {
-            if (bytes_received == 0)
+            if (conn == NULL)
             {
-                printf("Light client disconnected\n"); // 클라이언트가 연결 종료 시 메시지 출력
+                accept_clients(loop); // 새 연결 수락
             }
-            else
+            else if (events[i].data.ptr == loop)
             {
-                perror("recv failed"); // 수신 실패 시 에러 출력
+                adopt_clients(loop); // 다른 shard가 넘긴 연결
             }
-            break; // 루프 종료
-        }
-
-        buffer[bytes_received] = '\0'; // 문자열 종료 문자 추가
-
-        // 데이터를 파싱하여 조도 추출
-        int light;
-        if (sscanf(buffer, "%d", &light) == 1)
-        {
-            printf("[Light intensity: %d]\n", light); // 파싱된 조도 값 출력
-            tg = temperature + (0.02 * light) / 100.0; // 흑구온도 계산
-            light_flag = 1; // 조도 데이터 수신 완료 플래그
-
-            // 조도 데이터를 받은 후 온습도 데이터 수신 상태 확인 후 WBGT 처리
-            cal_wbgt();
-        }
-        else
-        {
-            printf("Failed to parse light data\n"); // 파싱 실패 시 메시지 출력
-        }
-    }
-
-    close(client_sock); // 클라이언트 소켓 닫기
-    free(arg); // 메모리 해제
-    return NULL;
-}
-
-// PIR 클라이언트 요청을 처리하는 함수
-void* handle_client_PIR(void* arg)
-{
-    int client_sock = *(int*)arg; // 클라이언트 소켓 파일 디스크립터 가져오기
-    char buffer[BUFFER_SIZE]; // 수신 버퍼
-    int bytes_received; // 수신된 바이트 수
-
-    while (1)
-    {
-        bytes_received = recv(client_sock, buffer, BUFFER_SIZE, 0); // 데이터 수신
-        if (bytes_received <= 0)
-        {
-            if (bytes_received == 0)
+            else if (events[i].data.ptr == &loop->udp_inbox)
             {
-                printf("PIR client disconnected\n"); // 클라이언트가 연결 종료 시 메시지 출력
+                drain_udp_inbox(loop); // UDP 수신 쓰레드가 넘긴 이 shard 소유 현장의 프레임
             }
-            else
+            else if (events[i].events & (EPOLLERR | EPOLLHUP))
             {
-                perror("recv failed"); // 수신 실패 시 에러 출력
+                close_client(conn); // 오류 또는 끊긴 연결 정리
             }
-            break; // 루프 종료
-        }
-
-        buffer[bytes_received] = '\0'; // 문자열 종료 문자 추가
-
-        // 데이터를 파싱하여 PIR 데이터 추출
-        int pir;
-        if (sscanf(buffer, "%d", &pir) == 1)
-        {
-            if (pir == 1)
+            else
             {
-                enable = 0; // 모션 감지 시 알람 종료
+                read_client(conn); // 데이터 수신 및 처리
             }
         }
-        else
-        {
-            printf("Failed to parse PIR data\n"); // 파싱 실패 시 메시지 출력
-        }
     }
 
-    close(client_sock); // 클라이언트 소켓 닫기
-    free(arg); // 메모리 해제
+    close(loop->epoll_fd);
     return NULL;
 }
 
-// 알람 기능을 수행하는 함수
-void* alert(void* arg)
+// 사용할 shard 수를 정하는 함수 (SERVER_SHARDS 환경 변수: 숫자 또는 "auto"는 온라인 코어 수, 없으면 1)
+static int configured_shards(void)
 {
-    int elapsed_time = 0; // 경과 시간 초기화
-    wiringPiSetupGpio(); // WiringPi GPIO 초기화
-    softToneCreate(POUT); // 소프트 톤 생성
-
-    // 알람 시작 전에 LED 켜기
-    if (GPIOWrite(POUT1, HIGH) == -1)
+    const char* value = getenv("SERVER_SHARDS");
+    if (value == NULL)
     {
-        fprintf(stderr, "Failed to write GPIO value for light!\n");
-        return NULL;
+        return 1;
+    }
+    if (strcmp(value, "auto") == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        return cpus > 0 ? (int)cpus : 1;
     }
+    return atoi(value);
+}
 
-    while (elapsed_time < 4000 || enable)
-    { // 4초가 지나지 않았거나, enable이 1일 때 루프 실행
-        // 주파수를 증가시키며 사이렌 효과
-        for (int freq = minFreq; freq <= maxFreq && (elapsed_time < 4000 || enable); freq += step)
-        {
-            softToneWrite(POUT, freq); // 주파수 설정
-            delay(delayTime); // 딜레이
-            elapsed_time += delayTime; // 경과 시간 증가
-        }
+// shard의 TCP 리슨 소켓을 여는 함수 (모든 shard가 같은 포트에 SO_REUSEPORT로 바인딩)
+static int open_tcp_socket(void)
+{
+    struct sockaddr_in server_addr; // 서버 주소 구조체
+    int opt = 1; // 소켓 옵션 값
 
-        // 주파수를 감소시키며 사이렌 효과
-        for (int freq = maxFreq; freq >= minFreq && (elapsed_time < 4000 || enable); freq -= step)
-        {
-            softToneWrite(POUT, freq); // 주파수 설정
-            delay(delayTime); // 딜레이
-            elapsed_time += delayTime; // 경과 시간 증가
-        }
+    // 소켓 생성
+    int server_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_sock == -1)
+    {
+        perror("socket creation failed"); // 소켓 생성 실패 시 에러 출력
+        return -1;
+    }
+    setsockopt(server_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)); // 재시작 시 포트 재사용 허용
+    if (setsockopt(server_sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) // 새 연결을 커널이 shard 소켓들에 나눠 줌
+    {
+        perror("SO_REUSEPORT failed");
+        close(server_sock);
+        return -1;
     }
 
-    softToneWrite(POUT, 0); // 소리 끄기
+    // 서버 주소 초기화
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET; // IPv4 설정
+    server_addr.sin_port = htons(SERVER_PORT); // 포트 번호 설정
+    server_addr.sin_addr.s_addr = INADDR_ANY; // 모든 인터페이스에서 수신
 
-    // 알람 종료 후 LED 끄기
-    if (GPIOWrite(POUT1, LOW) == -1)
+    // 소켓 바인딩
+    if (bind(server_sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == -1)
     {
-        fprintf(stderr, "Failed to reset GPIO value for light!\n");
+        perror("socket bind failed"); // 소켓 바인딩 실패 시 에러 출력
+        close(server_sock); // 소켓 닫기
+        return -1;
     }
 
-    return NULL;
+    // 연결 대기 (대량 접속을 고려해 커널 최대 backlog 사용)
+    if (listen(server_sock, SOMAXCONN) == -1 || set_nonblocking(server_sock) == -1)
+    {
+        perror("listen failed"); // 연결 대기 실패 시 에러 출력
+        close(server_sock); // 소켓 닫기
+        return -1;
+    }
+    return server_sock;
 }
 
-// WBGT를 계산하고 알람을 활성화하는 함수
-void cal_wbgt()
+// 연결을 현재 shard의 epoll에 등록하는 함수
+static int watch_client(struct client_conn* conn)
 {
-    if (temp_flag && light_flag)
+    struct epoll_event ev; // 등록용 이벤트 구조체
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.ptr = conn;
+    if (epoll_ctl(self_loop->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) == -1)
     {
-        // WBGT 계산
-        printf("Temperature: %.1f, Humidity: %.1f, Tg: %.1f\n", temperature, humidity, tg);
-        wbgt = 0.7 * humidity + 0.2 * temperature + 0.1 * tg; // WBGT 계산
-        printf("Calculated WBGT: %.1f\n", wbgt); // 계산된 WBGT 출력
-
-        // WBGT 값이 임계치를 초과할 경우 알람을 울림
-        if (wbgt >= WBGT_LIMIT)
-        {
-            printf("WBGT %.1f exceeds the threshold, triggering alarm\n", wbgt);
+        perror("epoll_ctl failed"); // 등록 실패 시 에러 출력
+        return -1;
+    }
+    conn->shard = self_loop->id;
+    conn->handoff = -1;
+    shard_add(conn->shard, SHARD_CONNECTIONS, 1);
+    return 0;
+}
 
-            enable = 1; // 알람 활성화
+// 연결을 현장을 소유한 shard로 넘기는 함수 (현재 shard에서 등록을 풀고 대상 shard의 인계 목록에 넣음)
+static void handoff_client(struct client_conn* conn)
+{
+    struct shard_loop* target = &loops[conn->handoff];
+    uint64_t one = 1;
+
+    epoll_ctl(self_loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    shard_add(conn->shard, SHARD_CONNECTIONS, -1);
+    shard_add(conn->shard, SHARD_HANDOFFS, 1);
+
+    pthread_mutex_lock(&target->inbox_lock);
+    conn->next = target->inbox;
+    target->inbox = conn;
+    pthread_mutex_unlock(&target->inbox_lock);
+    if (write(target->wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+    {
+        perror("shard wakeup failed");
+    }
+}
 
-            pthread_t alert_thread; // 알람 쓰레드
-            if (pthread_create(&alert_thread, NULL, alert, NULL) != 0)
-            {
-                perror("pthread_create failed"); // 쓰레드 생성 실패 시 에러 출력
-                return;
-            }
+// 다른 shard가 넘긴 연결을 받아 처리하는 함수
+static void adopt_clients(struct shard_loop* loop)
+{
+    uint64_t pending;
+    if (read(loop->wake_fd, &pending, sizeof(pending)) == -1 && errno != EAGAIN)
+    {
+        perror("shard wakeup read failed");
+    }
 
-            pthread_detach(alert_thread); // 독립적으로 실행되도록 분리
+    pthread_mutex_lock(&loop->inbox_lock);
+    struct client_conn* list = loop->inbox;
+    loop->inbox = NULL;
+    pthread_mutex_unlock(&loop->inbox_lock);
 
-            // 플래그 리셋
-            temp_flag = 0;
-            light_flag = 0;
+    while (list != NULL)
+    {
+        struct client_conn* conn = list;
+        list = conn->next;
+        if (watch_client(conn) == -1)
+        {
+            metrics_count(METRIC_DISCONNECTS); // 연결 수는 넘긴 shard에서 이미 뺐으므로 close_client를 쓰지 않음
+            close(conn->fd);
+            free(conn);
+            continue;
+        }
+        link_site(conn); // 이제 현장을 소유한 shard에 있으므로 측정 속도 지시 대상
+        // 넘기기 전에 이미 받아 둔 나머지 메시지를 이어서 처리 (새로 도착한 데이터는 epoll이 알려 줌)
+        if (conn->len > 0)
+        {
+            process_buffer(conn);
         }
     }
 }
-// GPIO 제어 함수
-static int GPIOExport(int pin)
+
+// shard의 UDP 프레임 인계 큐를 준비하는 함수 (큐 알림을 epoll에 등록하고 UDP 프레임용 연결 상태를 만듦)
+static int open_udp_inbox(struct shard_loop* loop)
 {
-    char buffer[BUFFER_MAX];
-    ssize_t bytes_written;
-    int fd;
+    snprintf(loop->udp_name, sizeof(loop->udp_name), "udp-%d", loop->id);
+    if (pipeline_init(&loop->udp_inbox, loop->udp_name, sizeof(struct udp_frame), UDP_INBOX_SIZE) == -1)
+    {
+        return -1;
+    }
+    atomic_store(&loop->udp_inbox.sleeping, 1); // 처음 넣는 프레임부터 알림을 받음
 
-    fd = open("/sys/class/gpio/export", O_WRONLY);
-    if (fd == -1)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &loop->udp_inbox;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->udp_inbox.wake_fd, &ev) == -1)
     {
-        fprintf(stderr, "Failed to open export for writing!\n");
         return -1;
     }
 
-    bytes_written = snprintf(buffer, BUFFER_MAX, "%d", pin);
-    write(fd, buffer, bytes_written);
-    close(fd);
+    struct client_conn* conn = calloc(1, sizeof(*conn));
+    if (conn == NULL)
+    {
+        return -1;
+    }
+    conn->fd = -1; // 응답을 보내지 않음
+    conn->id = atomic_fetch_add(&next_conn_id, 1);
+    conn->mode = MODE_DATAGRAM;
+    conn->shard = loop->id;
+    conn->handoff = -1;
+    loop->udp_conn = conn;
     return 0;
 }
 
-static int GPIOUnexport(int pin)
+// UDP 프레임 하나를 처리하는 함수 (인계 큐 안에서 바로 디코드)
+static void handle_udp_frame(void* item, void* arg)
 {
-    char buffer[BUFFER_MAX];
-    ssize_t bytes_written;
-    int fd;
-
-    fd = open("/sys/class/gpio/unexport", O_WRONLY);
-    if (fd == -1)
+    struct udp_frame* udp = item;
+    struct client_conn* conn = ((struct shard_loop*)arg)->udp_conn;
+    struct proto_frame frame;
+    if (proto_decode(udp->bytes, udp->len, &frame) > 0)
     {
-        fprintf(stderr, "Failed to open unexport for writing!\n");
-        return -1;
+        conn->recv_ns = udp->recv_ns;
+        dispatch_frame(conn, &frame);
     }
-    bytes_written = snprintf(buffer, BUFFER_MAX, "%d", pin);
-    write(fd, buffer, bytes_written);
-    close(fd);
-    return 0;
 }
 
-static int GPIODirection(int pin, int dir)
+// UDP 수신 쓰레드가 넘긴 프레임을 처리하는 함수
+static void drain_udp_inbox(struct shard_loop* loop)
 {
-    static const char s_directions_str[] = "in\0out";
-    char path[DIRECTION_MAX];
-    int fd;
+    uint64_t pending;
+    if (read(loop->udp_inbox.wake_fd, &pending, sizeof(pending)) == -1 && errno != EAGAIN)
+    {
+        perror("UDP inbox wakeup read failed");
+    }
+
+    // 비우기 전에 다시 잠든 것으로 표시해야 비우는 동안 들어온 프레임의 알림을 놓치지 않음
+    atomic_store(&loop->udp_inbox.sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (pipeline_drain(&loop->udp_inbox, handle_udp_frame, loop, UDP_BATCH) > 0)
+    {
+    }
+}
 
-    snprintf(path, DIRECTION_MAX, "/sys/class/gpio/gpio%d/direction", pin);
+// UDP 수신 소켓을 여는 함수
+static int open_udp_socket(void)
+{
+    struct sockaddr_in addr;
+    int rcvbuf = UDP_RCVBUF;
 
-    fd = open(path, O_WRONLY);
-    if (fd == -1)
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == -1)
     {
-        fprintf(stderr, "Failed to open gpio direction for writing!\n");
+        perror("UDP socket creation failed");
         return -1;
     }
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)); // 커널 최대값(rmem_max)을 넘으면 최대값으로 제한됨
 
-    if (write(fd, &s_directions_str[IN == dir ? 0 : 3], IN == dir ? 2 : 3) == -1)
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
     {
-        fprintf(stderr, "Failed to set direction!\n");
-        close(fd);
+        perror("UDP bind failed");
+        close(sock);
         return -1;
     }
-
-    close(fd);
-    return 0;
+    return sock;
 }
 
-static int GPIORead(int pin)
+// 데이터그램 하나에 든 프레임을 처리하는 함수 (데이터그램은 프레임 경계에서 끝나야 함)
+static void process_datagram(struct client_conn* conn, const uint8_t* buf, size_t len)
 {
-    char path[VALUE_MAX];
-    char value_str[3];
-    int fd;
+    size_t off = 0;
+    while (off < len)
+    {
+        struct proto_frame frame;
+        int n = proto_decode(buf + off, len - off, &frame);
+        if (n <= 0)
+        {
+            // 잘리거나 깨진 데이터그램은 나머지를 버림 (다음 데이터그램과 이어지지 않음)
+            metrics_count(METRIC_PARSE_FAILURES);
+            return;
+        }
+        capture_add(conn->id, conn->node ? conn->node->node_id : 0, CAPTURE_FRAME, conn->mode, buf + off, n);
+        off += n;
 
-    snprintf(path, VALUE_MAX, "/sys/class/gpio/gpio%d/value", pin);
-    fd = open(path, O_RDONLY);
-    if (fd == -1)
+        // 측정은 노드 현장을 소유한 shard로 넘김 (HELLO와 미등록 노드의 프레임은 레지스트리만 건드리므로 여기서 처리)
+        const struct sensor_node* node = frame.type == PROTO_HELLO ? NULL : registry_lookup(frame.node_id);
+        if (node == NULL)
+        {
+            dispatch_frame(conn, &frame);
+            continue;
+        }
+        struct udp_frame udp = {.recv_ns = conn->recv_ns, .len = (uint16_t)n};
+        memcpy(udp.bytes, buf + off - n, n);
+        pipeline_push(&loops[shard_of_site(node->site_id)].udp_inbox, &udp); // 가득 차면 버리고 단계의 dropped로 셈
+    }
+}
+
+// UDP 데이터그램 수신 루프 함수 (recvmmsg 한 번으로 여러 노드의 데이터그램을 받아 TCP와 같은 디코더로 처리)
+void* udp_loop(void* arg)
+{
+    int sock = *(int*)arg; // UDP 소켓
+    static uint8_t buffers[UDP_BATCH][UDP_DATAGRAM_SIZE]; // 데이터그램 버퍼 (쓰레드가 하나라 정적 할당)
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+
+    // 모든 UDP 노드가 함께 쓰는 연결 상태 (노드는 프레임의 node id로 구분, 측정은 현장을 소유한 shard의 udp_conn이 처리)
+    struct client_conn* conn = calloc(1, sizeof(*conn));
+    if (conn == NULL)
     {
-        fprintf(stderr, "Failed to open gpio value for reading!\n");
-        return -1;
+        perror("calloc failed");
+        return NULL;
+    }
+    conn->fd = sock;
+    conn->id = atomic_fetch_add(&next_conn_id, 1);
+    conn->mode = MODE_DATAGRAM;
+    conn->shard = -1; // 어느 shard에도 속하지 않음 (이 쓰레드는 현장 상태를 건드리지 않음)
+    conn->handoff = -1;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = UDP_DATAGRAM_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
     }
 
-    if (read(fd, value_str, 3) == -1)
+    while (1)
     {
-        fprintf(stderr, "Failed to read value!\n");
-        close(fd);
-        return -1;
+        // 하나가 올 때까지 기다린 뒤 이미 도착해 있는 것까지 한 번에 받음
+        int n = recvmmsg(sock, msgs, UDP_BATCH, MSG_WAITFORONE, NULL);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("recvmmsg failed");
+            break;
+        }
+        metrics_count(METRIC_RECVMMSG_CALLS);
+
+        for (int i = 0; i < n; i++)
+        {
+            metrics_count(METRIC_DATAGRAMS);
+            conn->recv_ns = metrics_now_ns();
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                metrics_count(METRIC_PARSE_FAILURES); // 버퍼보다 큰 데이터그램
+                continue;
+            }
+            process_datagram(conn, buffers[i], msgs[i].msg_len);
+        }
     }
+    free(conn);
+    return NULL;
+}
+
+// 대기 중인 연결을 모두 수락하는 함수
+static void accept_clients(struct shard_loop* loop)
+{
+    while (1)
+    {
+        struct sockaddr_in client_addr; // 클라이언트 주소 구조체
+        socklen_t client_addr_size = sizeof(client_addr); // 클라이언트 주소 크기 변수
+        int client_sock = accept4(loop->listen_fd, (struct sockaddr*)&client_addr, &client_addr_size, SOCK_NONBLOCK | SOCK_CLOEXEC); // 논블로킹 소켓으로 연결 수락
+
+        if (client_sock == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                perror("server accept failed"); // 연결 수락 실패 시 에러 출력
+            }
+            return; // 더 이상 대기 중인 연결이 없음
+        }
+
+        struct client_conn* conn = malloc(sizeof(*conn)); // 연결 상태 할당
+        if (conn == NULL)
+        {
+            perror("malloc failed"); // 메모리 할당 실패 시 에러 출력
+            close(client_sock);
+            continue;
+        }
+        conn->fd = client_sock;
+        conn->id = atomic_fetch_add(&next_conn_id, 1);
+        conn->node = handle_client(client_sock); // 기존 노드가 아니면 핸드셰이크를 기다림
+        conn->mode = MODE_UNKNOWN;
+        conn->text_lines = 0;
+        conn->node_count = 0;
+        conn->site_linked = 0;
+        conn->rate_sent = 0;
+        conn->out_len = 0;
+        conn->batch_end_ms = 0;
+        conn->len = 0;
+        metrics_count(METRIC_ACCEPTS);
+
+        // IP로 등록된 기존 노드는 등록 메시지가 없으므로 재생할 수 있도록 HELLO 프레임으로 기록
+        if (conn->node != NULL && capture_enabled())
+        {
+            uint8_t hello[PROTO_MAX_FRAME];
+            size_t hello_len = proto_encode_hello(hello, sizeof(hello), conn->node->node_id, proto_now_ms(), conn->node->type, conn->node->site_id, conn->node->zone_id);
+            capture_add(conn->id, conn->node->node_id, CAPTURE_FRAME, MODE_BINARY, hello, hello_len);
+        }
+
+        if (watch_client(conn) == -1)
+        {
+            close(client_sock);
+            free(conn);
+            continue;
+        }
 
-    close(fd);
-    return atoi(value_str);
+        // IP로 바로 등록된 기존 노드는 현장을 소유한 shard로 곧장 넘김
+        if (conn->node != NULL && shard_of_site(conn->node->site_id) != loop->id)
+        {
+            conn->handoff = shard_of_site(conn->node->site_id);
+            handoff_client(conn);
+        }
+    }
 }
 
-static int GPIOWrite(int pin, int value)
+// 기존 텍스트 노드를 IP로 찾아 등록하는 함수
+struct sensor_node* handle_client(int client_sock)
 {
-    static const char s_values_str[] = "01";
-    char path[VALUE_MAX];
-    int fd;
+    struct sockaddr_in client_addr; // 클라이언트 주소 구조체
+    socklen_t client_addr_len = sizeof(client_addr); // 클라이언트 주소 길이 변수
+    getpeername(client_sock, (struct sockaddr*)&client_addr, &client_addr_len); // 클라이언트 주소 정보 가져오기
+
+    char client_ip[INET_ADDRSTRLEN]; // 클라이언트 IP 주소 문자열
+    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN); // 클라이언트 IP 주소를 문자열로 변환
 
-    snprintf(path, VALUE_MAX, "/sys/class/gpio/gpio%d/value", pin);
-    fd = open(path, O_WRONLY);
-    if (fd == -1)
+    for (size_t i = 0; i < sizeof(legacy_clients) / sizeof(legacy_clients[0]); i++)
     {
-        fprintf(stderr, "Failed to open gpio value for writing!\n");
-        return -1;
+        if (strcmp(client_ip, legacy_clients[i].ip) == 0)
+        {
+            struct sensor_node* node = registry_register(LEGACY_NODE_ID_BASE + legacy_clients[i].type, legacy_clients[i].type, LEGACY_SITE_ID, 0);
+            log_printf("%s client connected: %s\n", sensor_name(node), client_ip); // 기존 클라이언트 연결 메시지 출력
+            return node;
+        }
     }
+    log_printf("Client connected: %s, waiting for hello\n", client_ip); // 핸드셰이크 대기 메시지 출력
+    return NULL;
+}
 
-    if (write(fd, &s_values_str[LOW == value ? 0 : 1], 1) != 1)
+// 노드를 등록하고 연결에 연결하는 함수
+static void register_node(struct client_conn* conn, uint32_t node_id, uint8_t type, uint16_t site_id, uint16_t zone_id)
+{
+    if (type < PROTO_TEMP || (type > PROTO_PIR && type != PROTO_WBGT))
     {
-        fprintf(stderr, "Failed to write value!\n");
-        close(fd);
-        return -1;
+        log_printf("Hello from node %u with unknown sensor type %d\n", node_id, type);
+        return;
     }
-    close(fd);
+    // UDP 노드는 서버 재시작에 대비해 HELLO를 주기적으로 다시 보내므로 정보가 바뀔 때만 출력
+    const struct sensor_node* known = registry_lookup(node_id);
+    int changed = known == NULL || known->type != type || known->site_id != site_id || known->zone_id != zone_id;
+    // 같은 현장의 노드는 한 연결에 함께 등록 (다른 현장으로 다시 등록하면 이전 노드 목록은 버림)
+    if (conn->node_count > 0 && conn->nodes[0]->site_id != site_id)
+    {
+        unlink_site(conn);
+        conn->node_count = 0;
+    }
+    conn->node = registry_register(node_id, type, site_id, zone_id);
+    if (conn->node != NULL && (changed || conn->mode != MODE_DATAGRAM))
+    {
+        log_printf("%s node %u registered (site %u, zone %u, %zu nodes total)\n", sensor_name(conn->node), node_id, site_id, zone_id, registry_count());
+    }
+    if (conn->node == NULL || conn->mode == MODE_DATAGRAM)
+    {
+        return; // UDP 노드는 연결 상태 하나를 함께 쓰므로 목록과 측정 속도 지시 대상이 아님
+    }
+    int known_here = 0;
+    for (int i = 0; i < conn->node_count; i++)
+    {
+        known_here |= conn->nodes[i] == conn->node;
+    }
+    if (!known_here)
+    {
+        if (conn->node_count == CONN_NODES)
+        {
+            log_printf("Connection already carries %d nodes, node %u gets no rate commands\n", CONN_NODES, node_id);
+            return;
+        }
+        conn->nodes[conn->node_count++] = conn->node;
+    }
+
+    // 현장을 다른 shard가 소유하면 지금 처리 중인 수신 버퍼를 마친 뒤 그 shard로 넘김
+    if (conn->shard >= 0 && shard_of_site(site_id) != conn->shard)
+    {
+        conn->handoff = shard_of_site(site_id);
+        return;
+    }
+    if (conn->site_linked)
+    {
+        conn->rate_sent = 0; // 같은 연결에 새로 등록한 노드에도 현재 단계를 알림
+        sync_rate(conn);
+        return;
+    }
+    link_site(conn); // 현장의 현재 측정 속도 단계를 바로 알림
+}
+
+// 메시지 해석 완료를 기록하는 함수 (수신부터 해석까지의 지연과 노드별 메시지 수)
+static void mark_parsed(struct client_conn* conn)
+{
+    conn->parse_ns = metrics_now_ns();
+    metrics_record(METRIC_RECV_TO_PARSE, conn->parse_ns - conn->recv_ns);
+    atomic_fetch_add_explicit(&conn->node->messages, 1, memory_order_relaxed);
+}
+
+// 노드 종류 이름을 반환하는 함수
+static const char* sensor_name(const struct sensor_node* node)
+{
+    switch (node ? node->type : 0)
+    {
+    case PROTO_TEMP:
+        return "Temperature";
+    case PROTO_LIGHT:
+        return "Light";
+    case PROTO_PIR:
+        return "PIR";
+    case PROTO_WBGT:
+        return "Edge WBGT";
+    }
+    return "Unregistered";
+}
+
+// 연결에서 데이터를 읽어 처리하는 함수
+static void read_client(struct client_conn* conn)
+{
+    // 남은 공간만큼 이어서 수신 (문자열 종료 문자를 위해 1바이트를 남김)
+    ssize_t bytes_received = recv(conn->fd, conn->buffer + conn->len, CONN_BUFFER_SIZE - 1 - conn->len, 0);
+    if (bytes_received <= 0)
+    {
+        if (bytes_received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            return; // 아직 읽을 데이터가 없음
+        }
+        if (bytes_received == 0)
+        {
+            log_printf("%s client disconnected\n", conn->node_count > 1 ? "Multi-sensor" : sensor_name(conn->node)); // 클라이언트가 연결 종료 시 메시지 출력
+        }
+        else
+        {
+            perror("recv failed"); // 수신 실패 시 에러 출력
+        }
+        close_client(conn);
+        return;
+    }
+    conn->len += bytes_received;
+    conn->recv_ns = metrics_now_ns();
+    process_buffer(conn);
+}
+
+// 버퍼에 쌓인 메시지를 처리하는 함수 (등록으로 소유 shard가 바뀌면 나머지는 남겨 두고 연결을 넘김)
+static void process_buffer(struct client_conn* conn)
+{
+    // 첫 바이트로 메시지 형식 판별 (바이너리 프레임은 항상 PROTO_MAGIC으로 시작)
+    if (conn->mode == MODE_UNKNOWN)
+    {
+        conn->mode = ((unsigned char)conn->buffer[0] == PROTO_MAGIC) ? MODE_BINARY : MODE_TEXT;
+    }
+
+    size_t consumed = (conn->mode == MODE_BINARY) ? process_binary(conn) : process_text(conn);
+
+    // 버퍼가 가득 찼는데 처리할 수 없으면 버림
+    if (consumed == 0 && conn->len == CONN_BUFFER_SIZE - 1)
+    {
+        log_printf("Message too long, dropping %zu bytes\n", conn->len);
+        consumed = conn->len;
+    }
+
+    // 아직 완성되지 않은 나머지 바이트만 버퍼 앞으로 이동
+    conn->len -= consumed;
+    if (conn->len > 0 && consumed > 0)
+    {
+        memmove(conn->buffer, conn->buffer + consumed, conn->len);
+    }
+    if (conn->handoff >= 0)
+    {
+        handoff_client(conn);
+        return;
+    }
+    if (conn->site_linked)
+    {
+        sync_rate(conn); // 같은 현장의 다른 연결(UDP 노드 등)의 계산으로 바뀐 단계
+    }
+}
+
+// 버퍼의 바이너리 프레임을 처리하는 함수 (소비한 바이트 수 반환)
+static size_t process_binary(struct client_conn* conn)
+{
+    const uint8_t* buf = (const uint8_t*)conn->buffer;
+    size_t off = 0;
+
+    while (off < conn->len)
+    {
+        struct proto_frame frame;
+        int n = proto_decode(buf + off, conn->len - off, &frame); // 버퍼 안에서 바로 디코드 (복사 없음)
+        if (n == PROTO_NEED_MORE)
+        {
+            break; // 나머지는 다음 수신에서 이어서 처리
+        }
+        if (n == PROTO_BAD_FRAME)
+        {
+            // 다음 시작 바이트까지 건너뛰어 재동기화
+            const uint8_t* next = memchr(buf + off + 1, PROTO_MAGIC, conn->len - off - 1);
+            log_printf("Failed to decode frame, resyncing\n");
+            metrics_count(METRIC_RESYNCS);
+            off = next ? (size_t)(next - buf) : conn->len;
+            continue;
+        }
+        if (route_frame(conn, &frame))
+        {
+            break; // 재접속한 노드의 현장을 다른 shard가 소유하면 이 프레임부터 그 shard가 기록하고 처리
+        }
+        capture_add(conn->id, conn->node ? conn->node->node_id : 0, CAPTURE_FRAME, conn->mode, buf + off, n);
+        dispatch_frame(conn, &frame);
+        off += n;
+        if (conn->handoff >= 0)
+        {
+            break; // 나머지 프레임은 현장을 소유한 shard가 처리
+        }
+    }
+    return off;
+}
+
+// 프레임 노드의 현장을 다른 shard가 소유하면 넘길 shard를 정하는 함수 (재접속한 노드는 등록 없이 아무 shard에나 붙을 수 있음, 넘겨야 하면 1 반환)
+static int route_frame(struct client_conn* conn, const struct proto_frame* frame)
+{
+    if (frame->type == PROTO_HELLO || conn->shard < 0)
+    {
+        return 0; // 등록은 register_node가 소유 shard를 정함
+    }
+    const struct sensor_node* node = (conn->node != NULL && conn->node->node_id == frame->node_id) ? conn->node : registry_lookup(frame->node_id);
+    if (node == NULL || shard_of_site(node->site_id) == conn->shard)
+    {
+        return 0;
+    }
+    conn->handoff = shard_of_site(node->site_id);
+    return 1;
+}
+
+// 버퍼의 텍스트 메시지를 처리하는 함수 (소비한 바이트 수 반환)
+static size_t process_text(struct client_conn* conn)
+{
+    size_t off = 0;
+    conn->buffer[conn->len] = '\0'; // 문자열 종료 문자 추가
+
+    while (off < conn->len)
+    {
+        char* line = conn->buffer + off;
+        char* nl = memchr(line, '\n', conn->len - off);
+        if (nl == NULL)
+        {
+            // 줄바꿈을 쓰는 노드라면 나머지는 다음 수신을 기다림
+            if (conn->text_lines)
+            {
+                break;
+            }
+            // 구분자 없는 기존 노드는 한 번에 받은 내용을 메시지 하나로 처리
+            dispatch_text(conn, line);
+            off = conn->len;
+            break;
+        }
+        *nl = '\0';
+        conn->text_lines = 1;
+        if (nl > line)
+        {
+            dispatch_text(conn, line);
+        }
+        off = (nl - conn->buffer) + 1;
+        if (conn->handoff >= 0)
+        {
+            break; // 나머지 메시지는 현장을 소유한 shard가 처리
+        }
+    }
+    return off;
+}
+
+// 프레임을 센서별 처리 함수로 전달하는 함수
+static void dispatch_frame(struct client_conn* conn, const struct proto_frame* frame)
+{
+    float temp, hum;
+    int value;
+    uint8_t type, kind;
+    uint16_t site_id, zone_id;
+    struct proto_analog channels[PROTO_ANALOG_MAX];
+    struct proto_wbgt report;
+
+    metrics_count(METRIC_FRAMES);
+    if (conn->shard >= 0)
+    {
+        shard_add(conn->shard, SHARD_FRAMES, 1);
+    }
+
+    // 노드 등록 프레임
+    if (frame->type == PROTO_HELLO)
+    {
+        if (proto_parse_hello(frame, &type, &site_id, &zone_id) == 0)
+        {
+            register_node(conn, frame->node_id, type, site_id, zone_id);
+        }
+        return;
+    }
+
+    // 연결에 캐시된 노드와 다르면 레지스트리에서 조회 (재접속한 노드는 핸드셰이크 없이도 허용, 현장을 소유한 shard로는 process_binary가 먼저 넘김)
+    if (conn->node == NULL || conn->node->node_id != frame->node_id)
+    {
+        conn->node = registry_lookup(frame->node_id);
+        if (conn->node == NULL)
+        {
+            log_printf("Frame from unregistered node %u dropped\n", frame->node_id);
+            metrics_count(METRIC_UNREGISTERED);
+            return;
+        }
+    }
+
+    // 측정 묶음은 한 번 훑으면서 각 측정을 일반 프레임처럼 처리
+    if (frame->type == PROTO_BATCH)
+    {
+        struct proto_frame sub;
+        size_t offset = 0;
+        uint32_t index = 0;
+        int ret;
+        metrics_count(METRIC_BATCHES);
+        conn->batch_end_ms = batch_end_ms(frame); // 마지막 측정이 방금 보낸 것으로 보고 나머지는 그 간격만큼 앞에 둠
+        while ((ret = proto_batch_next(frame, &offset, &index, &sub)) > 0)
+        {
+            dispatch_frame(conn, &sub);
+        }
+        conn->batch_end_ms = 0;
+        if (ret < 0)
+        {
+            log_printf("Malformed batch from node %u, %u readings used\n", frame->node_id, (unsigned)index);
+            metrics_count(METRIC_PARSE_FAILURES);
+        }
+        return;
+    }
+
+    conn->seq = frame->seq;
+    if (conn->mode == MODE_DATAGRAM)
+    {
+        track_sequence(conn->node, frame->seq); // UDP는 재전송이 없으므로 빠진 시퀀스 번호를 손실로 셈
+    }
+    if (frame->flags & PROTO_FLAG_SPOOLED) // 노드 시계와 무관하게, 연결이 없던 동안 보관된 프레임만 밀린 기록으로 봄
+    {
+        record_backlog(conn, frame); // 지난 측정으로 현재 상태를 바꾸거나 알람을 울리지 않음
+        return;
+    }
+
+    // 살아 있는 측정은 서버 수신 시각에 맞춤 (노드 시계가 앞서거나 뒤처져도 같은 현장의 다른 노드와 같은 기준으로 융합됨)
+    uint64_t now_ms = server_now_ms();
+    uint64_t at_ms = now_ms;
+    if (conn->batch_end_ms != 0 && conn->batch_end_ms - frame->timestamp_ms < now_ms)
+    {
+        at_ms = now_ms - (conn->batch_end_ms - frame->timestamp_ms); // 묶음 안의 측정 간격은 유지
+    }
+    switch (frame->type)
+    {
+    case PROTO_TEMP:
+        if (proto_parse_temp(frame, &temp, &hum) == 0)
+        {
+            mark_parsed(conn);
+            handle_client_temp(conn, at_ms, temp, hum);
+            return;
+        }
+        break;
+    case PROTO_LIGHT:
+        if (proto_parse_light(frame, &value) == 0)
+        {
+            mark_parsed(conn);
+            handle_client_light(conn, at_ms, value);
+            return;
+        }
+        break;
+    case PROTO_PIR:
+        if (proto_parse_pir(frame, &value, &kind) == 0)
+        {
+            mark_parsed(conn);
+            handle_client_PIR(conn, at_ms, value, kind);
+            return;
+        }
+        break;
+    case PROTO_ANALOG:
+        if ((value = proto_parse_analog(frame, channels, PROTO_ANALOG_MAX)) > 0)
+        {
+            mark_parsed(conn);
+            handle_client_analog(conn, at_ms, channels, value);
+            return;
+        }
+        break;
+    case PROTO_WBGT:
+        if (proto_parse_wbgt(frame, &report) == 0)
+        {
+            mark_parsed(conn);
+            handle_client_wbgt(conn, at_ms, &report);
+            return;
+        }
+        break;
+    }
+    log_printf("Failed to parse frame (type %d, node %u)\n", frame->type, frame->node_id); // 파싱 실패 시 메시지 출력
+    metrics_count(METRIC_PARSE_FAILURES);
+}
+
+// 묶음의 마지막 측정 시각을 구하는 함수 (잘못된 묶음이면 읽을 수 있는 데까지)
+static uint64_t batch_end_ms(const struct proto_frame* batch)
+{
+    struct proto_frame sub;
+    size_t offset = 0;
+    uint32_t index = 0;
+    uint64_t end_ms = batch->timestamp_ms;
+    while (proto_batch_next(batch, &offset, &index, &sub) > 0)
+    {
+        if (sub.timestamp_ms > end_ms)
+        {
+            end_ms = sub.timestamp_ms;
+        }
+    }
+    return end_ms;
+}
+
+// 밀린 측정을 이력에만 기록하는 함수 (연결이 끊긴 동안 노드가 spool에 모았다가 보낸 프레임)
+static void record_backlog(struct client_conn* conn, const struct proto_frame* frame)
+{
+    float temp, hum;
+    int value;
+    uint8_t kind;
+    struct proto_analog channels[PROTO_ANALOG_MAX];
+    struct proto_wbgt report;
+    const struct sensor_node* node = conn->node;
+
+    switch (frame->type)
+    {
+    case PROTO_TEMP:
+        if (proto_parse_temp(frame, &temp, &hum) == 0)
+        {
+            persist(frame->timestamp_ms, node->node_id, node->site_id, TSDB_TEMP, temp, hum, wbgt_wet_bulb(temp, hum));
+            break;
+        }
+        return;
+    case PROTO_LIGHT:
+        if (proto_parse_light(frame, &value) == 0)
+        {
+            persist(frame->timestamp_ms, node->node_id, node->site_id, TSDB_LIGHT, value, 0, 0);
+            break;
+        }
+        return;
+    case PROTO_PIR:
+        if (proto_parse_pir(frame, &value, &kind) == 0)
+        {
+            if (kind != PROTO_PIR_HEARTBEAT)
+            {
+                persist(frame->timestamp_ms, node->node_id, node->site_id, TSDB_PIR, value ? 1 : 0, 0, 0);
+            }
+            break;
+        }
+        return;
+    case PROTO_ANALOG:
+        if ((value = proto_parse_analog(frame, channels, PROTO_ANALOG_MAX)) > 0)
+        {
+            float light = 0, globe = 0;
+            int lights = 0, globes = 0;
+            for (int i = 0; i < value; i++)
+            {
+                if (channels[i].kind == PROTO_ANALOG_GLOBE)
+                {
+                    globe += channels[i].value;
+                    globes++;
+                }
+                else
+                {
+                    light += channels[i].value;
+                    lights++;
+                }
+            }
+            persist(frame->timestamp_ms, node->node_id, node->site_id, TSDB_LIGHT, lights ? light / lights : 0, globes ? globe / globes : 0, 0);
+            break;
+        }
+        return;
+    case PROTO_WBGT:
+        if (proto_parse_wbgt(frame, &report) == 0)
+        {
+            persist(frame->timestamp_ms, 0, node->site_id, TSDB_WBGT, report.wbgt, report.temperature, report.globe); // 연결이 끊긴 동안의 초과 기록도 이력에 남음
+            break;
+        }
+        return;
+    default:
+        return;
+    }
+    metrics_count(METRIC_BACKLOG_FRAMES);
+}
+
+// UDP 프레임 손실을 계산하는 함수 (손실 = 기대한 프레임 수 - 받은 프레임 수, 순서가 바뀌어 늦게 온 프레임은 손실이 아님)
+static void track_sequence(struct sensor_node* node, uint32_t seq)
+{
+    uint64_t lost;
+
+    atomic_fetch_add_explicit(&node->datagram_frames, 1, memory_order_relaxed);
+    if (!node->seq_valid || (int32_t)(seq - node->seq_max) < -SEQ_RESET_WINDOW)
+    {
+        // 처음 받았거나 노드가 다시 시작되어 시퀀스 번호가 처음부터 시작됨
+        node->seq_lost_before = atomic_load_explicit(&node->datagram_lost, memory_order_relaxed);
+        node->seq_valid = 1;
+        node->seq_base = node->seq_max = seq;
+        node->seq_received = 1;
+        return;
+    }
+    if ((int32_t)(seq - node->seq_max) > 0)
+    {
+        node->seq_max = seq;
+    }
+    node->seq_received++;
+
+    uint64_t expected = (uint64_t)(node->seq_max - node->seq_base) + 1;
+    lost = expected > node->seq_received ? expected - node->seq_received : 0; // 중복 수신으로 음수가 되면 0
+    atomic_store_explicit(&node->datagram_lost, node->seq_lost_before + lost, memory_order_relaxed);
+}
+
+// 텍스트 메시지를 센서별 처리 함수로 전달하는 함수
+static void dispatch_text(struct client_conn* conn, const char* msg)
+{
+    float temp, hum;
+    int value;
+    unsigned int node_id, type, site_id, zone_id;
+
+    metrics_count(METRIC_TEXT_MESSAGES);
+    capture_add(conn->id, conn->node ? conn->node->node_id : 0, CAPTURE_TEXT, conn->mode, msg, strlen(msg));
+    shard_add(conn->shard, SHARD_FRAMES, 1);
+
+    // 텍스트 노드 등록 메시지: "HELLO <type> <node id> <site id> <zone id>"
+    if (sscanf(msg, "HELLO %u %u %u %u", &type, &node_id, &site_id, &zone_id) == 4)
+    {
+        register_node(conn, node_id, type, site_id, zone_id);
+        return;
+    }
+
+    switch (conn->node ? conn->node->type : 0)
+    {
+    case PROTO_TEMP:
+        // 문자열에서 온도와 습도를 파싱
+        if (sscanf(msg, "%f %f", &temp, &hum) == 2)
+        {
+            mark_parsed(conn);
+            handle_client_temp(conn, server_now_ms(), temp, hum);
+        }
+        else
+        {
+            log_printf("Failed to parse temperature and humidity\n"); // 파싱 실패 시 메시지 출력
+            metrics_count(METRIC_PARSE_FAILURES);
+        }
+        break;
+    case PROTO_LIGHT:
+        // 데이터를 파싱하여 조도 추출
+        if (sscanf(msg, "%d", &value) == 1)
+        {
+            mark_parsed(conn);
+            handle_client_light(conn, server_now_ms(), value);
+        }
+        else
+        {
+            log_printf("Failed to parse light data\n"); // 파싱 실패 시 메시지 출력
+            metrics_count(METRIC_PARSE_FAILURES);
+        }
+        break;
+    case PROTO_PIR:
+        // 데이터를 파싱하여 PIR 데이터 추출
+        if (sscanf(msg, "%d", &value) == 1)
+        {
+            mark_parsed(conn);
+            handle_client_PIR(conn, server_now_ms(), value, PROTO_PIR_SAMPLE);
+        }
+        else
+        {
+            log_printf("Failed to parse PIR data\n"); // 파싱 실패 시 메시지 출력
+            metrics_count(METRIC_PARSE_FAILURES);
+        }
+        break;
+    default:
+        log_printf("Message from unregistered client dropped\n"); // 등록 전 메시지는 버림
+        metrics_count(METRIC_UNREGISTERED);
+        break;
+    }
+}
+
+// 연결을 종료하고 상태를 해제하는 함수
+static void close_client(struct client_conn* conn)
+{
+    unlink_site(conn);
+    metrics_count(METRIC_DISCONNECTS);
+    shard_add(conn->shard, SHARD_CONNECTIONS, -1);
+    close(conn->fd); // 소켓을 닫으면 epoll 등록도 자동으로 해제됨
+    free(conn); // 연결 상태 해제
+}
+
+// 소켓을 논블로킹 모드로 설정하는 함수
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1)
+    {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// 파일 디스크립터 제한을 최대로 올리는 함수
+static void raise_fd_limit(void)
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max; // soft limit을 hard limit까지 올림
+        if (setrlimit(RLIMIT_NOFILE, &rl) == -1)
+        {
+            perror("setrlimit failed");
+        }
+    }
+}
+
+// 이력 기록 항목 하나를 저장하는 함수 (이력 기록 단계 쓰레드)
+static void persist_one(void* item, void* arg)
+{
+    const struct persist_record* rec = item;
+    (void)arg;
+    tsdb_append(rec->timestamp_ms, rec->node_id, rec->site_id, rec->kind, rec->value[0], rec->value[1], rec->value[2]);
+}
+
+// 로그 한 줄을 출력하는 함수 (로그 출력 단계 쓰레드)
+static void print_one(void* item, void* arg)
+{
+    const struct log_line* line = item;
+    (void)arg;
+    fputs(line->text, stdout);
+}
+
+// 이력 기록 단계 쓰레드 함수
+static void* persist_loop(void* arg)
+{
+    (void)arg;
+    while (1)
+    {
+        if (pipeline_drain(&persist_stage, persist_one, NULL, STAGE_DRAIN_BATCH) == 0)
+        {
+            pipeline_wait(&persist_stage, -1);
+        }
+    }
+    return NULL;
+}
+
+// 로그 출력 단계 쓰레드 함수
+static void* log_loop(void* arg)
+{
+    (void)arg;
+    while (1)
+    {
+        if (pipeline_drain(&log_stage, print_one, NULL, STAGE_DRAIN_BATCH) == 0)
+        {
+            fflush(stdout);
+            pipeline_wait(&log_stage, -1);
+        }
+    }
+    return NULL;
+}
+
+// 이력 기록과 로그 출력 단계 쓰레드를 시작하는 함수
+static int start_stages(void)
+{
+    pthread_t tid;
+    if (pipeline_init(&persist_stage, "persist", sizeof(struct persist_record), PERSIST_QUEUE_SIZE) == -1 || pipeline_init(&log_stage, "log", sizeof(struct log_line), LOG_QUEUE_SIZE) == -1)
+    {
+        return -1;
+    }
+    if (pthread_create(&tid, NULL, persist_loop, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        return -1;
+    }
+    pthread_detach(tid);
+    if (pthread_create(&tid, NULL, log_loop, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        return -1;
+    }
+    pthread_detach(tid);
     return 0;
 }
+
+// 측정값을 이력 기록 단계로 보내는 함수 (큐가 가득 차면 버리고 wbgt_stage_dropped_total에 셈)
+static void persist(uint64_t timestamp_ms, uint32_t node_id, uint16_t site_id, uint8_t kind, float v0, float v1, float v2)
+{
+    if (replaying)
+    {
+        return; // 재생은 원래 기록을 다시 쓰지 않음
+    }
+    struct persist_record rec = {.timestamp_ms = timestamp_ms, .node_id = node_id, .site_id = site_id, .kind = kind, .value = {v0, v1, v2}};
+    pipeline_push(&persist_stage, &rec);
+}
+
+// 로그를 출력 단계로 보내는 함수 (긴 줄은 잘림, 큐가 가득 차면 버림)
+static void log_printf(const char* fmt, ...)
+{
+    struct log_line line;
+    va_list ap;
+    if (replaying)
+    {
+        return; // 재생 속도를 터미널 출력이 제한하지 않도록 생략
+    }
+    va_start(ap, fmt);
+    vsnprintf(line.text, sizeof(line.text), fmt, ap);
+    va_end(ap);
+    pipeline_push(&log_stage, &line);
+}
+
+// 서버 기준 현재 시각을 구하는 함수 (재생 중에는 재생 속도와 관계없이 기록 당시 시각이므로 판정이 원래와 같음)
+// 기록 중에는 재생 시계와 같은 기준(기록 시작 시각 + 단조 경과 시간)을 써서 판정한 tick이 재생 결과와 맞음
+static uint64_t server_now_ms(void)
+{
+    if (replaying)
+    {
+        return replay_now_ms;
+    }
+    return capture_enabled() ? capture_now_ms() : proto_now_ms();
+}
+
+// 판정 키(현장, 구역, 측정점 시각) 비교 함수
+static int compare_decision_keys(const struct capture_decision* x, const struct capture_decision* y)
+{
+    if (x->site_id != y->site_id)
+    {
+        return x->site_id < y->site_id ? -1 : 1;
+    }
+    if (x->zone_id != y->zone_id)
+    {
+        return x->zone_id < y->zone_id ? -1 : 1;
+    }
+    return x->tick_ms < y->tick_ms ? -1 : (x->tick_ms > y->tick_ms);
+}
+
+// 판정을 키 순서로 정렬하는 비교 함수 (같은 tick을 새 샘플로 다시 판정한 경우는 판정 순서 유지)
+static int compare_decisions(const void* a, const void* b)
+{
+    const struct replay_decision* x = a;
+    const struct replay_decision* y = b;
+    int key = compare_decision_keys(&x->d, &y->d);
+    if (key != 0)
+    {
+        return key;
+    }
+    return x->order < y->order ? -1 : (x->order > y->order);
+}
+
+// 재생에 쓴 메모리 해제 함수
+static void replay_free(struct replay_decision* recorded, struct client_conn** conns, uint32_t max_id, struct capture_log* log)
+{
+    if (conns != NULL)
+    {
+        for (uint32_t id = 0; id <= max_id; id++)
+        {
+            free(conns[id]);
+        }
+    }
+    free(conns);
+    free(recorded);
+    free(replayed);
+    replayed = NULL;
+    replayed_count = replayed_capacity = 0;
+    capture_free(log);
+}
+
+// 기록 파일을 처리 함수에 다시 넣는 함수 (speed 0이면 최대 속도, 결과 판정이 원래와 같으면 0 반환)
+static int replay_capture(const char* path, double speed)
+{
+    struct capture_log log;
+    if (capture_load(path, &log) == -1)
+    {
+        return 1;
+    }
+    if (registry_init(REGISTRY_CAPACITY) == -1)
+    {
+        capture_free(&log);
+        return 1;
+    }
+    shard_init(1);
+    replaying = 1;
+
+    // 연결 번호별 연결 상태 (번호는 1부터 차례로 부여됨)
+    uint32_t max_id = 0;
+    struct replay_decision* recorded = malloc((log.count + 1) * sizeof(*recorded));
+    size_t recorded_count = 0;
+    for (size_t i = 0; i < log.count; i++)
+    {
+        max_id = log.records[i].header.conn_id > max_id ? log.records[i].header.conn_id : max_id;
+    }
+    struct client_conn** conns = calloc(max_id + 1, sizeof(*conns));
+    if (conns == NULL || recorded == NULL)
+    {
+        perror("calloc failed");
+        replay_free(recorded, conns, max_id, &log);
+        return 1;
+    }
+
+    if (speed == 0)
+    {
+        printf("Replaying %zu records from %s at max speed\n", log.count, path);
+    }
+    else
+    {
+        printf("Replaying %zu records from %s at %gx\n", log.count, path, speed);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t first_ns = log.count ? log.records[0].header.offset_ns : 0;
+    size_t messages = 0;
+
+    for (size_t i = 0; i < log.count; i++)
+    {
+        const struct capture_record* rec = &log.records[i];
+        if (rec->header.kind == CAPTURE_DECISION)
+        {
+            if (rec->header.len == sizeof(struct capture_decision))
+            {
+                memcpy(&recorded[recorded_count].d, rec->payload, sizeof(struct capture_decision));
+                recorded[recorded_count].order = recorded_count;
+                recorded_count++;
+            }
+            continue;
+        }
+
+        // 기록된 간격을 재생 속도로 나눈 시각까지 대기
+        if (speed > 0)
+        {
+            uint64_t delay_ns = (uint64_t)((rec->header.offset_ns - first_ns) / speed);
+            struct timespec at = {.tv_sec = start.tv_sec + (start.tv_nsec + delay_ns) / 1000000000, .tv_nsec = (start.tv_nsec + delay_ns) % 1000000000};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL);
+        }
+        replay_now_ms = log.start_ms + rec->header.offset_ns / 1000000;
+
+        struct client_conn* conn = conns[rec->header.conn_id];
+        if (conn == NULL)
+        {
+            conn = conns[rec->header.conn_id] = calloc(1, sizeof(*conn));
+            if (conn == NULL)
+            {
+                perror("calloc failed");
+                replay_free(recorded, conns, max_id, &log);
+                return 1;
+            }
+            conn->fd = -1;
+            conn->id = rec->header.conn_id;
+            conn->mode = rec->header.mode;
+            conn->handoff = -1;
+        }
+        conn->recv_ns = metrics_now_ns();
+        messages++;
+
+        if (rec->header.kind == CAPTURE_FRAME)
+        {
+            struct proto_frame frame;
+            if (proto_decode(rec->payload, rec->header.len, &frame) > 0)
+            {
+                dispatch_frame(conn, &frame);
+            }
+        }
+        else if (rec->header.kind == CAPTURE_TEXT)
+        {
+            char msg[CAPTURE_MAX_PAYLOAD + 1];
+            memcpy(msg, rec->payload, rec->header.len);
+            msg[rec->header.len] = '\0';
+            dispatch_text(conn, msg);
+        }
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double span = log.count ? (log.records[log.count - 1].header.offset_ns - first_ns) / 1e9 : 0;
+    printf("Replayed %zu messages in %.3f s (%.0f msgs/sec, capture spans %.1f s)\n", messages, elapsed, elapsed > 0 ? messages / elapsed : 0, span);
+
+    // 판정을 키(현장, 구역, 측정점 시각)로 짝지어 비교 (현장끼리는 다른 shard에서 처리되어 순서가 섞일 수 있고, 한쪽에만 있는 판정이 뒤의 판정을 밀지 않도록)
+    qsort(recorded, recorded_count, sizeof(*recorded), compare_decisions);
+    qsort(replayed, replayed_count, sizeof(*replayed), compare_decisions);
+    size_t matched = 0, differ = 0, missing = 0, extra = 0, alerts = 0, reported = 0;
+    for (size_t i = 0; i < replayed_count; i++)
+    {
+        alerts += replayed[i].d.decision == 1;
+    }
+    size_t i = 0, j = 0;
+    while (i < recorded_count || j < replayed_count)
+    {
+        const struct capture_decision* a = i < recorded_count ? &recorded[i].d : NULL;
+        const struct capture_decision* b = j < replayed_count ? &replayed[j].d : NULL;
+        int key = a == NULL ? 1 : b == NULL ? -1 : compare_decision_keys(a, b);
+        if (key == 0)
+        {
+            i++;
+            j++;
+            if (a->decision == b->decision && fabsf(a->wbgt - b->wbgt) < 0.05f)
+            {
+                matched++;
+                continue;
+            }
+            differ++;
+            if (reported++ < REPLAY_MISMATCH_REPORT)
+            {
+                printf("  site %u zone %u @%llu differs: recorded WBGT %.1f alert %d, replayed WBGT %.1f alert %d\n", a->site_id, a->zone_id, (unsigned long long)a->tick_ms, a->wbgt, (int)a->decision, b->wbgt, (int)b->decision);
+            }
+            continue;
+        }
+
+        // 한쪽에만 있는 판정 (기록 큐가 가득 차 버린 레코드나 재생에서 빠진 판정)
+        const struct capture_decision* only = key < 0 ? a : b;
+        if (key < 0)
+        {
+            i++;
+            missing++;
+        }
+        else
+        {
+            j++;
+            extra++;
+        }
+        if (reported++ < REPLAY_MISMATCH_REPORT)
+        {
+            printf("  site %u zone %u @%llu only %s: WBGT %.1f alert %d\n", only->site_id, only->zone_id, (unsigned long long)only->tick_ms, key < 0 ? "recorded" : "replayed", only->wbgt, (int)only->decision);
+        }
+    }
+    printf("Decisions: %zu recorded, %zu replayed (%zu alerts), %zu matched, %zu differ, %zu only recorded, %zu only replayed\n", recorded_count, replayed_count, alerts, matched, differ, missing, extra);
+
+    replay_free(recorded, conns, max_id, &log);
+    return differ == 0 && missing == 0 && extra == 0 ? 0 : 2;
+}
+
+// 온도 클라이언트 메시지를 처리하는 함수
+void handle_client_temp(struct client_conn* conn, uint64_t timestamp_ms, float temp, float hum)
+{
+    struct site_state* site = site_get(conn->node->site_id); // 노드가 속한 현장 상태
+    if (site == NULL)
+    {
+        return;
+    }
+    log_printf("[Parsed Temperature: %.1f, Humidity: %.1f]\n", temp, hum); // 파싱된 온도와 습도 출력
+
+    // 현장의 온습도 스트림에 측정 시각과 함께 추가
+    struct site_reading* r = site_write_begin(site);
+    fusion_add(&r->fusion.temp, timestamp_ms, temp, hum);
+    site_write_end(site);
+    persist(timestamp_ms, conn->node->node_id, conn->node->site_id, TSDB_TEMP, temp, hum, wbgt_wet_bulb(temp, hum)); // 이력 기록
+
+    // 이 시각의 조도 값을 추정해 WBGT 처리
+    float wbgt;
+    uint64_t tick_ms = 0;
+    int decision = cal_wbgt(site, conn->node->zone_id, timestamp_ms, &wbgt, &tick_ms);
+    report_decision(conn, decision, wbgt, tick_ms);
+}
+
+// 조도 클라이언트 메시지를 처리하는 함수
+void handle_client_light(struct client_conn* conn, uint64_t timestamp_ms, int light)
+{
+    log_printf("[Light intensity: %d]\n", light); // 파싱된 조도 값 출력
+    update_light(conn, timestamp_ms, light, NULL);
+}
+
+// 다채널 아날로그 메시지를 처리하는 함수 (조도 채널끼리, 흑구 채널끼리 평균)
+void handle_client_analog(struct client_conn* conn, uint64_t timestamp_ms, const struct proto_analog* channels, int count)
+{
+    float light_sum = 0, globe_sum = 0;
+    int lights = 0, globes = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (channels[i].kind == PROTO_ANALOG_LIGHT)
+        {
+            light_sum += channels[i].value;
+            lights++;
+        }
+        else if (channels[i].kind == PROTO_ANALOG_GLOBE)
+        {
+            globe_sum += channels[i].value;
+            globes++;
+        }
+    }
+    if (lights == 0 && globes == 0)
+    {
+        return;
+    }
+
+    float globe = globes ? globe_sum / globes : 0;
+    int light = lights ? (int)(light_sum / lights + 0.5f) : -1;
+    log_printf("[Analog: %d light channel(s) avg %d, %d globe channel(s) avg %.1f]\n", lights, light, globes, globe);
+    update_light(conn, timestamp_ms, light, globes ? &globe : NULL);
+}
+
+// 엣지 노드가 계산한 WBGT를 처리하는 함수
+// (노드가 서버와 같은 식으로 측정마다 판정하고 초과 시작/해제와 주기 요약만 보내므로 서버는 현장 결과를 모으기만 함)
+void handle_client_wbgt(struct client_conn* conn, uint64_t timestamp_ms, const struct proto_wbgt* report)
+{
+    static const char* kinds[] = {"summary", "exceeded", "cleared"};
+    struct site_state* site = site_get(conn->node->site_id); // 노드가 속한 현장 상태
+    if (site == NULL || report->kind > PROTO_WBGT_CLEAR)
+    {
+        return;
+    }
+
+    // 이미 반영한 결과보다 이전 보고는 이력에만 남김 (같은 현장의 다른 노드가 더 최근 결과를 낸 경우)
+    struct site_reading* w = site_write_begin(site);
+    if (timestamp_ms < w->wbgt_ms)
+    {
+        site_write_end(site);
+        persist(timestamp_ms, 0, site->site_id, TSDB_WBGT, report->wbgt, report->temperature, report->globe);
+        return;
+    }
+    int level = store_wbgt(site, w, report->temperature, report->humidity, wbgt_wet_bulb(report->temperature, report->humidity), report->globe, report->wbgt, timestamp_ms);
+    site_write_end(site);
+    announce_rate(site, level, report->wbgt);
+
+    log_printf("[Site %u edge %s] WBGT: %.1f (max %.1f over %u samples), Temperature: %.1f, Tg: %.1f\n", site->site_id, kinds[report->kind], report->wbgt, report->wbgt_max, report->samples, report->temperature, report->globe);
+    persist(timestamp_ms, 0, site->site_id, TSDB_WBGT, report->wbgt, report->temperature, report->globe); // 계산 결과 이력 기록
+
+    // 노드가 초과를 알리거나 초과 중 요약을 보내면 알람 요청 (스케줄러가 중복 제거 또는 단계 상승)
+    if (report->over)
+    {
+        float wbgt = report->kind == PROTO_WBGT_SUMMARY ? report->wbgt_max : report->wbgt;
+        log_printf("WBGT %.1f exceeds the threshold at site %u (edge node %u), triggering alarm\n", wbgt, site->site_id, conn->node->node_id);
+        if (!replaying)
+        {
+            alert_raise(site->site_id, conn->node->zone_id, wbgt);
+        }
+        metrics_count(METRIC_ALERTS_RAISED);
+    }
+    report_decision(conn, report->over, report->wbgt, timestamp_ms);
+}
+
+// 조도/흑구 값을 현장 상태에 반영하는 함수 (light가 -1이면 조도는 직전 값, globe가 NULL이면 융합할 때 조도로 흑구 온도를 추정)
+static void update_light(struct client_conn* conn, uint64_t timestamp_ms, int light, const float* globe)
+{
+    struct site_state* site = site_get(conn->node->site_id); // 노드가 속한 현장 상태
+    if (site == NULL)
+    {
+        return;
+    }
+
+    // 현장의 조도 스트림에 측정 시각과 함께 추가
+    float temp[2];
+    struct site_reading* r = site_write_begin(site);
+    if (light >= 0)
+    {
+        r->light = light;
+    }
+    light = r->light;
+    fusion_add(&r->fusion.light, timestamp_ms, light, globe ? *globe : NAN);
+    int temp_known = fusion_estimate(&r->fusion.temp, timestamp_ms, temp) != FUSION_NONE; // 이력용 흑구 온도 계산에 쓸 같은 시각의 온도
+    site_write_end(site);
+    float tg = globe ? *globe : (temp_known ? wbgt_globe(temp[0], light) : 0); // 흑구온도 (측정값이 없으면 조도로 계산)
+    persist(timestamp_ms, conn->node->node_id, conn->node->site_id, TSDB_LIGHT, light, tg, 0); // 이력 기록
+
+    // 이 시각의 온습도 값을 추정해 WBGT 처리
+    float wbgt;
+    uint64_t tick_ms = 0;
+    int decision = cal_wbgt(site, conn->node->zone_id, timestamp_ms, &wbgt, &tick_ms);
+    report_decision(conn, decision, wbgt, tick_ms);
+}
+
+// PIR 클라이언트 메시지를 처리하는 함수
+// (에지 노드는 상태 변화와 heartbeat만, 기존 노드는 주기 샘플을 보냄. 어느 쪽이든 상태가 바뀔 때만 이력에 기록)
+void handle_client_PIR(struct client_conn* conn, uint64_t timestamp_ms, int pir, uint8_t kind)
+{
+    pir = pir ? 1 : 0;
+    if (pir != conn->node->motion)
+    {
+        if (kind == PROTO_PIR_HEARTBEAT && conn->node->motion != -1)
+        {
+            // heartbeat 상태가 마지막으로 받은 변화와 다르면 그 사이의 에지 프레임을 놓친 것
+            log_printf("PIR node %u: missed transition, state is now %d\n", (unsigned)conn->node->node_id, pir);
+            metrics_count(METRIC_PIR_MISSED);
+        }
+        conn->node->motion = pir;
+        metrics_count(METRIC_PIR_TRANSITIONS);
+        persist(timestamp_ms, conn->node->node_id, conn->node->site_id, TSDB_PIR, pir, 0, 0); // 이력 기록
+    }
+    else if (kind == PROTO_PIR_EDGE)
+    {
+        return; // 같은 상태로의 변화는 중복 (재전송 등)
+    }
+
+    if (pir == 1)
+    {
+        alert_ack(conn->node->site_id, conn->node->zone_id); // 모션 감지 중이면 해당 구역 알람 확인 처리
+    }
+}
+
+// 부저 주파수를 설정하는 함수
+static void buzzer_tone(int freq)
+{
+    softToneWrite(POUT, freq); // 주파수 설정 (0이면 소리 끔)
+}
+
+// 경고등을 켜고 끄는 함수
+static void alert_led(int on)
+{
+    if (gpio_write(&led_line, 0, on) == -1)
+    {
+        fprintf(stderr, "Failed to write GPIO value for light!\n");
+    }
+}
+
+// 판정 결과를 계측하고 노드에 돌려보내는 함수 (응답은 WBGT_DECISION_ACK=1일 때 바이너리 연결에만)
+static void report_decision(struct client_conn* conn, int decision, float wbgt, uint64_t tick_ms)
+{
+    uint8_t frame[PROTO_MAX_FRAME];
+    if (decision < 0)
+    {
+        return; // 아직 온습도와 조도가 모두 모이지 않음
+    }
+    metrics_count(METRIC_DECISIONS);
+    metrics_record(METRIC_PARSE_TO_WBGT, metrics_now_ns() - conn->parse_ns);
+
+    // 재생 결과 검증을 위해 판정을 기록
+    struct capture_decision d = {.site_id = conn->node->site_id, .zone_id = conn->node->zone_id, .wbgt = wbgt, .decision = decision, .tick_ms = tick_ms};
+    if (capture_enabled())
+    {
+        capture_add(conn->id, conn->node->node_id, CAPTURE_DECISION, conn->mode, &d, sizeof(d));
+    }
+    if (replaying)
+    {
+        if (replayed_count == replayed_capacity)
+        {
+            replayed_capacity = replayed_capacity ? replayed_capacity * 2 : 1024;
+            replayed = realloc(replayed, replayed_capacity * sizeof(*replayed));
+            if (replayed == NULL)
+            {
+                perror("realloc failed");
+                exit(EXIT_FAILURE);
+            }
+        }
+        replayed[replayed_count].d = d;
+        replayed[replayed_count].order = replayed_count;
+        replayed_count++;
+        return;
+    }
+
+    if (!decision_ack || conn->mode != MODE_BINARY) // UDP 노드에는 응답하지 않음
+    {
+        return;
+    }
+    size_t len = proto_encode_decision(frame, sizeof(frame), conn->node->node_id, conn->seq, server_now_ms(), wbgt, decision, conn->node->site_id, conn->node->zone_id);
+    send_reply(conn, frame, len); // 응답은 측정용이므로 보내지 못하면 버림
+}
+
+// 새 샘플 시각의 WBGT를 계산하고 알람을 요청하는 함수 (판정하지 않았으면 -1, 임계치 이하 0, 알람 요청 1)
+// 두 스트림을 샘플이 속한 tick으로 보간해 묶으므로 판정은 같은 시각의 조건을 반영하고, 새 샘플마다 바로 나옴
+int cal_wbgt(struct site_state* site, uint16_t zone_id, uint64_t timestamp_ms, float* wbgt_out, uint64_t* tick_out)
+{
+    struct fusion_point pt; // 융합된 측정점
+
+    struct site_reading* w = site_write_begin(site);
+    if (!fusion_join(&w->fusion, timestamp_ms, &pt))
+    {
+        site_write_end(site);
+        return -1; // 다른 스트림 샘플이 없거나 너무 오래됨, 또는 이미 판정한 tick보다 이전 샘플
+    }
+
+    // WBGT 계산 (흑구 온도 측정값이 없으면 같은 시각의 온도와 조도로 계산)
+    float wet_bulb = wbgt_wet_bulb(pt.temperature, pt.humidity); // 습구 온도 계산 (Stull 근사식)
+    float tg = isnan(pt.globe) ? wbgt_globe(pt.temperature, pt.light) : pt.globe;
+    float wbgt = wbgt_index(wet_bulb, pt.temperature, tg);
+
+    // 계산 결과를 게시 (측정점 값과 WBGT를 같은 쓰기 구간에서 함께 바꿈)
+    int level = store_wbgt(site, w, pt.temperature, pt.humidity, wet_bulb, tg, wbgt, pt.tick_ms);
+    site_write_end(site);
+    announce_rate(site, level, wbgt);
+
+    log_printf("[Site %u @%llu%s] Temperature: %.1f, Wet-bulb: %.1f, Tg: %.1f\n", site->site_id, (unsigned long long)pt.tick_ms, (pt.temp_method == FUSION_HELD || pt.light_method == FUSION_HELD) ? " held" : "", pt.temperature, wet_bulb, tg);
+    log_printf("Calculated WBGT: %.1f\n", wbgt); // 계산된 WBGT 출력
+    persist(pt.tick_ms, 0, site->site_id, TSDB_WBGT, wbgt, pt.temperature, tg); // 계산 결과 이력 기록
+
+    // WBGT 값이 임계치를 초과할 경우 알람을 울림
+    int trigger = wbgt >= WBGT_LIMIT;
+    if (trigger)
+    {
+        log_printf("WBGT %.1f exceeds the threshold at site %u, triggering alarm\n", wbgt, site->site_id);
+        if (!replaying)
+        {
+            alert_raise(site->site_id, zone_id, wbgt); // 알람 스케줄러에 요청 (이미 울리는 알람은 스케줄러가 중복 제거 또는 단계 상승)
+        }
+        metrics_count(METRIC_ALERTS_RAISED);
+    }
+    *wbgt_out = wbgt;
+    *tick_out = pt.tick_ms;
+    return trigger;
+}
+
+// 현장의 WBGT 결과를 갱신하는 함수 (site_write_begin 구간 안에서 호출, 측정 속도 단계가 바뀌었으면 새 단계, 아니면 0 반환)
+static int store_wbgt(struct site_state* site, struct site_reading* w, float temperature, float humidity, float wet_bulb, float tg, float wbgt, uint64_t wbgt_ms)
+{
+    int owner = shard_of_site(site->site_id);
+    int was_over = w->wbgt_ms != 0 && w->wbgt >= WBGT_LIMIT; // 이전 판정이 임계치 이상이었는지 여부
+    if (w->wbgt_ms == 0)
+    {
+        shard_add(owner, SHARD_SITES, 1); // 처음 판정한 현장
+    }
+    if (was_over != (wbgt >= WBGT_LIMIT))
+    {
+        shard_add(owner, SHARD_SITES_OVER_LIMIT, was_over ? -1 : 1);
+    }
+    w->temperature = temperature;
+    w->humidity = humidity;
+    w->wet_bulb = wet_bulb;
+    w->tg = tg;
+    w->wbgt = wbgt;
+    w->wbgt_ms = wbgt_ms;
+
+    int level = atomic_load_explicit(&site->rate_level, memory_order_relaxed);
+    int new_level = rate_level(level, wbgt);
+    atomic_store_explicit(&site->rate_level, new_level, memory_order_relaxed);
+    return new_level != level ? new_level : 0;
+}
+
+// 바뀐 측정 속도 단계를 알리는 함수 (level이 0이면 바뀌지 않음)
+static void announce_rate(struct site_state* site, int level, float wbgt)
+{
+    if (level == 0)
+    {
+        return;
+    }
+    log_printf("Site %u sampling rate %s (WBGT %.1f)\n", site->site_id, level == PROTO_RATE_FAST ? "fast" : level == PROTO_RATE_RELAXED ? "relaxed" : "normal", wbgt);
+    push_rate(site->site_id);
+}
+
+// WBGT로 측정 속도 단계를 정하는 함수 (느린 단계로 내려갈 때만 RATE_HYSTERESIS만큼 더 내려가야 함)
+static int rate_level(int current, float wbgt)
+{
+    int level = wbgt >= WBGT_LIMIT - RATE_FAST_MARGIN ? PROTO_RATE_FAST : wbgt >= WBGT_LIMIT - RATE_RELAXED_MARGIN ? PROTO_RATE_NORMAL : PROTO_RATE_RELAXED;
+    if (current == 0 || level >= current)
+    {
+        return level;
+    }
+    int held = wbgt + RATE_HYSTERESIS >= WBGT_LIMIT - RATE_FAST_MARGIN ? PROTO_RATE_FAST : wbgt + RATE_HYSTERESIS >= WBGT_LIMIT - RATE_RELAXED_MARGIN ? PROTO_RATE_NORMAL : PROTO_RATE_RELAXED;
+    return held < current ? held : current;
+}
+
+// 연결을 현장 연결 목록에 넣는 함수 (현장을 소유한 shard의 바이너리 TCP 연결만)
+static void link_site(struct client_conn* conn)
+{
+    if (replaying || conn->site_linked || conn->node_count == 0 || conn->mode != MODE_BINARY || self_loop == NULL || shard_of_site(conn->nodes[0]->site_id) != self_loop->id)
+    {
+        return;
+    }
+    struct client_conn** head = &site_conns[conn->nodes[0]->site_id];
+    conn->site_prev = NULL;
+    conn->site_next = *head;
+    if (*head != NULL)
+    {
+        (*head)->site_prev = conn;
+    }
+    *head = conn;
+    conn->site_linked = 1;
+    sync_rate(conn);
+}
+
+// 연결을 현장 연결 목록에서 빼는 함수
+static void unlink_site(struct client_conn* conn)
+{
+    if (!conn->site_linked)
+    {
+        return;
+    }
+    if (conn->site_prev != NULL)
+    {
+        conn->site_prev->site_next = conn->site_next;
+    }
+    else
+    {
+        site_conns[conn->nodes[0]->site_id] = conn->site_next;
+    }
+    if (conn->site_next != NULL)
+    {
+        conn->site_next->site_prev = conn->site_prev;
+    }
+    conn->site_linked = 0;
+    conn->rate_sent = 0;
+}
+
+// 현장의 측정 속도 단계를 연결에 알리는 함수 (연결에 등록된 온습도/조도 노드마다, 이미 알린 단계면 보내지 않음)
+static void sync_rate(struct client_conn* conn)
+{
+    flush_reply(conn); // 수신 때마다 불리므로 보내다 만 응답도 여기서 마저 보냄
+    struct site_state* site = site_get(conn->nodes[0]->site_id);
+    int level = site ? atomic_load_explicit(&site->rate_level, memory_order_relaxed) : 0;
+    if (level == 0 || level == conn->rate_sent)
+    {
+        return;
+    }
+
+    // 노드별 지시를 한 번의 send로 보냄 (노드는 프레임의 node id로 자기 지시를 찾음)
+    uint8_t frames[CONN_NODES * PROTO_MAX_FRAME];
+    size_t len = 0;
+    for (int i = 0; i < conn->node_count; i++)
+    {
+        const struct proto_control* control;
+        switch (conn->nodes[i]->type)
+        {
+        case PROTO_TEMP:
+        case PROTO_WBGT: // 엣지 노드는 DHT11 측정 주기를 따름
+            control = &temp_rates[level];
+            break;
+        case PROTO_LIGHT:
+            control = &light_rates[level];
+            break;
+        default:
+            continue; // PIR 노드는 상태가 바뀔 때만 보내므로 조절할 것이 없음
+        }
+        len += proto_encode_control(frames + len, sizeof(frames) - len, conn->nodes[i]->node_id, conn->seq, server_now_ms(), control);
+    }
+    if (len == 0 || send_reply(conn, frames, len) == 0) // 하나도 보내지 못하면 다음 수신 때 다시 시도
+    {
+        conn->rate_sent = level;
+    }
+}
+
+// 보내다 만 응답의 나머지를 보내는 함수 (다 보냈으면 0, 아직 남았으면 -1)
+static int flush_reply(struct client_conn* conn)
+{
+    if (conn->out_len == 0)
+    {
+        return 0;
+    }
+    ssize_t n = send(conn->fd, conn->out, conn->out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0)
+    {
+        conn->out_len -= n;
+        memmove(conn->out, conn->out + n, conn->out_len);
+    }
+    return conn->out_len == 0 ? 0 : -1;
+}
+
+// 응답 프레임을 노드로 보내는 함수 (보냈거나 일부만 보내 나머지를 보관했으면 0, 하나도 보내지 못했으면 -1)
+// 막히지 않는 send가 프레임 중간에서 끊기면 나머지를 연결에 보관하고 다음 응답보다 먼저 보냄 (처음부터 다시 보내면 노드가 잘린 프레임을 받음)
+static int send_reply(struct client_conn* conn, const uint8_t* frames, size_t len)
+{
+    if (flush_reply(conn) == -1)
+    {
+        return -1; // 앞 응답이 아직 남았으면 뒤에 붙이지 않음
+    }
+    ssize_t n = send(conn->fd, frames, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    conn->out_len = len - n;
+    memcpy(conn->out, frames + n, conn->out_len);
+    return 0;
+}
+
+// 현장의 모든 연결에 측정 속도 단계를 알리는 함수
+// (연결 목록은 현장을 소유한 shard만 다루므로 다른 쓰레드에서 바뀐 단계는 각 연결의 다음 수신 때 알림)
+static void push_rate(uint16_t site_id)
+{
+    if (replaying || self_loop == NULL || shard_of_site(site_id) != self_loop->id)
+    {
+        return;
+    }
+    for (struct client_conn* conn = site_conns[site_id]; conn != NULL; conn = conn->site_next)
+    {
+        sync_rate(conn);
+    }
+}
@@ -0,0 +1,56 @@
+#include <stdatomic.h>
+#include "shard.h"
+
+// shard별 통계 (다른 shard와 캐시 라인을 공유하지 않도록 정렬)
+struct shard_slot
+{
+    _Alignas(64) atomic_int_least64_t stats[SHARD_STATS];
+};
+
+static struct shard_slot slots[SHARD_MAX];
+static int count = 1; // 설정된 shard 수 (쓰레드 시작 전에 한 번만 바뀜)
+
+// shard 수 설정 함수
+int shard_init(int n)
+{
+    count = n < 1 ? 1 : (n > SHARD_MAX ? SHARD_MAX : n);
+    return count;
+}
+
+// 설정된 shard 수 반환 함수
+int shard_count(void)
+{
+    return count;
+}
+
+// 현장을 소유한 shard 번호를 구하는 함수 (연속된 현장 ID가 고르게 흩어지도록 곱셈 해시 사용)
+int shard_of_site(uint16_t site_id)
+{
+    uint32_t h = (uint32_t)site_id * 2654435761u;
+    return (int)((h >> 16) % (uint32_t)count);
+}
+
+// 통계 값 변경 함수 (각 shard 쓰레드가 자기 칸만 바꾸지만 /metrics 조회가 다른 쓰레드에서 읽으므로 원자적으로 더함)
+void shard_add(int shard, enum shard_stat stat, int64_t delta)
+{
+    atomic_fetch_add_explicit(&slots[shard].stats[stat], delta, memory_order_relaxed);
+}
+
+// shard 하나의 통계 값 반환 함수
+int64_t shard_value(int shard, enum shard_stat stat)
+{
+    return atomic_load_explicit(&slots[shard].stats[stat], memory_order_relaxed);
+}
+
+// 모든 shard의 통계 합계 함수
+void shard_totals(int64_t totals[SHARD_STATS])
+{
+    for (int s = 0; s < SHARD_STATS; s++)
+    {
+        totals[s] = 0;
+        for (int i = 0; i < count; i++)
+        {
+            totals[s] += shard_value(i, s);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+
+/*
+ * 수신 shard 구성과 shard별 통계
+ * 서버는 shard마다 SO_REUSEPORT 리슨 소켓과 epoll 루프를 하나씩 두고 각 쓰레드를 코어 하나에 고정함
+ * 현장은 현장 ID 해시로 정해진 shard 하나가 소유하고, 노드가 등록되면 연결을 그 shard로 넘김
+ * (같은 현장의 측정은 항상 같은 쓰레드에서 처리되므로 현장 상태를 두고 쓰레드끼리 경쟁하지 않음)
+ * UDP 측정 프레임은 수신 쓰레드가 소유 shard의 inbox 단계로 넘김
+ * 통계는 shard별 캐시 라인에 따로 기록하고, 조회할 때만 모든 shard를 더함 (shard_totals)
+ */
+#define SHARD_MAX 64 // 최대 shard 수
+
+// shard별 통계 종류
+enum shard_stat
+{
+    SHARD_CONNECTIONS, // 현재 처리 중인 연결 수
+    SHARD_FRAMES, // 처리한 메시지 수
+    SHARD_HANDOFFS, // 현장을 소유한 shard로 넘긴 연결 수
+    SHARD_SITES, // WBGT를 계산한 적이 있는 소유 현장 수
+    SHARD_SITES_OVER_LIMIT, // 마지막 WBGT가 임계치 이상인 소유 현장 수
+    SHARD_STATS
+};
+
+// shard 수 설정 (1 ~ SHARD_MAX로 제한, 설정된 값 반환)
+int shard_init(int count);
+
+// 설정된 shard 수
+int shard_count(void);
+
+// 현장을 소유한 shard 번호
+int shard_of_site(uint16_t site_id);
+
+// 통계 값 변경 (delta는 음수 가능)
+void shard_add(int shard, enum shard_stat stat, int64_t delta);
+
+// shard 하나의 통계 값
+int64_t shard_value(int shard, enum shard_stat stat);
+
+// 모든 shard의 통계 합계 (현장 전체 보기)
+void shard_totals(int64_t totals[SHARD_STATS]);
+
+#endif
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "site.h"
+
+// 현장 ID로 바로 찾는 포인터 테이블 (처음 사용될 때 할당)
+static _Atomic(struct site_state*) sites[SITE_MAX];
+
+// 현장 상태를 가져오는 함수
+struct site_state* site_get(uint16_t site_id)
+{
+    struct site_state* site = atomic_load_explicit(&sites[site_id], memory_order_acquire);
+    if (site != NULL)
+    {
+        return site;
+    }
+
+    // 처음 보는 현장이면 새로 만들고, 다른 쓰레드가 먼저 등록했으면 그것을 사용
+    struct site_state* created = calloc(1, sizeof(*created));
+    if (created == NULL)
+    {
+        perror("site calloc failed");
+        return NULL;
+    }
+    created->site_id = site_id;
+    atomic_init(&created->seq, 0);
+    atomic_init(&created->rate_level, 0);
+
+    if (!atomic_compare_exchange_strong_explicit(&sites[site_id], &site, created, memory_order_acq_rel, memory_order_acquire))
+    {
+        free(created);
+        return site;
+    }
+    return created;
+}
+
+// 쓰기 시작 함수
+struct site_reading* site_write_begin(struct site_state* site)
+{
+    unsigned int seq = atomic_load_explicit(&site->seq, memory_order_relaxed);
+    while (1)
+    {
+        // 다른 쓰레드가 쓰는 중이면 양보
+        if (seq & 1)
+        {
+            sched_yield();
+            seq = atomic_load_explicit(&site->seq, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&site->seq, &seq, seq + 1, memory_order_acquire, memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    atomic_thread_fence(memory_order_release); // 값 변경이 seq 변경보다 먼저 보이지 않도록 함
+    return &site->data;
+}
+
+// 쓰기 완료 함수
+void site_write_end(struct site_state* site)
+{
+    atomic_fetch_add_explicit(&site->seq, 1, memory_order_release);
+}
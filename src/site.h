@@ -0,0 +1,45 @@
+#ifndef SITE_H
+#define SITE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "fusion.h"
+
+#define SITE_MAX 65536 // 현장 ID 범위 (uint16)
+
+// 현장별 센서 값 (쓰기 구간 하나에서 함께 바뀌는 단위)
+struct site_reading
+{
+    struct fusion_state fusion; // 온습도/조도 스트림의 최근 샘플 (측정 시각 포함)
+    float temperature; // 마지막 측정점의 건구 온도
+    float humidity; // 마지막 측정점의 상대 습도
+    float wet_bulb; // 마지막 측정점의 습구 온도
+    float tg; // 마지막 측정점의 흑구 온도
+    float wbgt; // 마지막으로 계산한 WBGT
+    int light; // 마지막으로 받은 조도 값
+    uint64_t wbgt_ms; // WBGT 측정점 시각 (0이면 아직 계산 전)
+};
+
+/*
+ * 현장별 상태 (seqlock으로 보호)
+ * 쓰기: seq를 홀수로 만든 뒤 값을 바꾸고 다시 짝수로 만듦 (쓰는 쪽끼리는 CAS로 직렬화)
+ * 현장은 소유 shard 쓰레드만 읽고 쓰므로 다른 쓰레드용 스냅샷 읽기는 두지 않음 (측정 속도 단계는 원자 변수로 읽음)
+ */
+struct site_state
+{
+    uint16_t site_id; // 현장 ID
+    atomic_uint seq; // seqlock 시퀀스 (홀수면 쓰는 중)
+    struct site_reading data; // 현재 값
+    atomic_int rate_level; // 노드에 지시한 측정 속도 단계 (enum proto_rate, 0이면 아직 정하지 않음, 쓰기 구간 안에서만 바꿈)
+};
+
+// 현장 상태를 가져오는 함수 (없으면 생성, 실패 시 NULL)
+struct site_state* site_get(uint16_t site_id);
+
+// 쓰기 시작 (반환된 포인터로 값을 수정한 뒤 반드시 site_write_end 호출)
+struct site_reading* site_write_begin(struct site_state* site);
+
+// 쓰기 완료
+void site_write_end(struct site_state* site);
+
+#endif
@@ -0,0 +1,159 @@
+#include <stddef.h>
+#include "timer_wheel.h"
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1) // 칸 번호 마스크
+
+// 리스트 머리를 빈 원형 리스트로 만드는 함수
+static void list_init(struct wheel_timer* head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+// 리스트 끝에 타이머를 붙이는 함수
+static void list_append(struct wheel_timer* head, struct wheel_timer* timer)
+{
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+// 리스트에서 타이머를 떼어내는 함수
+static void list_remove(struct wheel_timer* timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = timer->prev = NULL;
+}
+
+// 만료 tick에 맞는 단계와 칸에 타이머를 넣는 함수
+static void place_timer(struct timer_wheel* wheel, struct wheel_timer* timer)
+{
+    uint64_t delta = timer->expires - wheel->now;
+    int level = 0;
+
+    // 남은 tick 수가 들어가는 가장 낮은 단계 선택
+    while (level < WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    // 최대 범위(2^24 tick)를 넘는 지연은 최대 범위로 제한
+    if (delta >= ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)))
+    {
+        timer->expires = wheel->now + ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
+
+    size_t slot = (timer->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    list_append(&wheel->slots[level][slot], timer);
+}
+
+// 휠 초기화 함수
+void wheel_init(struct timer_wheel* wheel, uint64_t now)
+{
+    wheel->now = now;
+    wheel->count = 0;
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+        {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+}
+
+// 타이머 초기화 함수
+void wheel_timer_init(struct wheel_timer* timer, wheel_callback callback)
+{
+    timer->next = timer->prev = NULL;
+    timer->expires = 0;
+    timer->callback = callback;
+    timer->pending = 0;
+}
+
+// 타이머 등록 함수
+void wheel_add(struct timer_wheel* wheel, struct wheel_timer* timer, uint64_t delay)
+{
+    wheel_cancel(wheel, timer);
+    // 0 tick 지연은 다음 tick에 만료 (현재 칸은 이미 처리됨)
+    timer->expires = wheel->now + (delay ? delay : 1);
+    timer->pending = 1;
+    wheel->count++;
+    place_timer(wheel, timer);
+}
+
+// 타이머 취소 함수
+void wheel_cancel(struct timer_wheel* wheel, struct wheel_timer* timer)
+{
+    if (!timer->pending)
+    {
+        return;
+    }
+    list_remove(timer);
+    timer->pending = 0;
+    wheel->count--;
+}
+
+// 윗 단계의 한 칸을 아래 단계로 다시 배치하는 함수
+static void cascade(struct timer_wheel* wheel, int level, size_t slot)
+{
+    struct wheel_timer head;
+    list_init(&head);
+
+    // 칸의 리스트를 통째로 옮긴 뒤 하나씩 다시 배치
+    struct wheel_timer* src = &wheel->slots[level][slot];
+    if (src->next != src)
+    {
+        head.next = src->next;
+        head.prev = src->prev;
+        head.next->prev = &head;
+        head.prev->next = &head;
+        list_init(src);
+    }
+    while (head.next != &head)
+    {
+        struct wheel_timer* timer = head.next;
+        list_remove(timer);
+        place_timer(wheel, timer);
+    }
+}
+
+// 한 tick 진행하는 함수
+static void wheel_tick(struct timer_wheel* wheel)
+{
+    wheel->now++;
+
+    // 아래 단계가 한 바퀴 돌았으면 윗 단계의 해당 칸을 내려보냄
+    uint64_t t = wheel->now;
+    for (int level = 1; level < WHEEL_LEVELS && (t & WHEEL_MASK) == 0; level++)
+    {
+        t >>= WHEEL_BITS;
+        cascade(wheel, level, t & WHEEL_MASK);
+    }
+
+    // 현재 칸의 타이머를 모두 만료 처리 (callback 안에서 다시 등록해도 안전하도록 먼저 떼어냄)
+    struct wheel_timer* head = &wheel->slots[0][wheel->now & WHEEL_MASK];
+    while (head->next != head)
+    {
+        struct wheel_timer* timer = head->next;
+        list_remove(timer);
+        timer->pending = 0;
+        wheel->count--;
+        timer->callback(timer);
+    }
+}
+
+// target tick까지 진행하는 함수
+void wheel_advance(struct timer_wheel* wheel, uint64_t target)
+{
+    while (wheel->now < target)
+    {
+        // 등록된 타이머가 없으면 한 번에 건너뜀
+        if (wheel->count == 0)
+        {
+            wheel->now = target;
+            return;
+        }
+        wheel_tick(wheel);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+/*
+ * 계층형 타이머 휠 (4단계 x 64칸)
+ * 0단계 한 칸이 1 tick이고, 윗 단계 칸이 돌아올 때마다 아래 단계로 내려보냄(cascade)
+ * 등록/취소는 O(1), tick 당 처리 비용은 만료된 타이머 수에 비례
+ * 쓰레드 안전하지 않으므로 하나의 쓰레드에서만 사용해야 함
+ */
+#define WHEEL_BITS 6 // 단계별 칸 수 = 2^WHEEL_BITS
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // 단계별 칸 수
+#define WHEEL_LEVELS 4 // 단계 수 (최대 2^24 tick 까지 표현)
+
+struct wheel_timer;
+typedef void (*wheel_callback)(struct wheel_timer* timer); // 만료 시 호출되는 함수
+
+// 타이머 (사용하는 쪽 구조체에 포함시켜 사용)
+struct wheel_timer
+{
+    struct wheel_timer* next; // 같은 칸의 다음 타이머
+    struct wheel_timer* prev; // 같은 칸의 이전 타이머
+    uint64_t expires; // 만료 tick
+    wheel_callback callback; // 만료 시 호출할 함수
+    int pending; // 휠에 등록되어 있는지 여부
+};
+
+// 타이머 휠
+struct timer_wheel
+{
+    uint64_t now; // 현재 tick
+    unsigned int count; // 등록된 타이머 수
+    struct wheel_timer slots[WHEEL_LEVELS][WHEEL_SLOTS]; // 칸별 리스트의 머리 (원형 이중 연결 리스트)
+};
+
+// 휠 초기화
+void wheel_init(struct timer_wheel* wheel, uint64_t now);
+
+// 타이머 초기화
+void wheel_timer_init(struct wheel_timer* timer, wheel_callback callback);
+
+// 현재 tick에서 delay tick 뒤에 만료되도록 등록 (이미 등록된 타이머는 다시 등록)
+void wheel_add(struct timer_wheel* wheel, struct wheel_timer* timer, uint64_t delay);
+
+// 등록 취소 (등록되지 않은 타이머에도 안전)
+void wheel_cancel(struct timer_wheel* wheel, struct wheel_timer* timer);
+
+// target tick까지 진행하며 만료된 타이머의 callback 호출
+void wheel_advance(struct timer_wheel* wheel, uint64_t target);
+
+#endif
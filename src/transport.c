@@ -0,0 +1,608 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "protocol.h"
+#include "transport.h"
+
+#define SPOOL_VERSION 1 // spool 파일 형식 버전
+#define SPOOL_RECORD_HEADER 2 // 레코드 앞의 uint16 프레임 길이
+#define SPOOL_BATCH_BYTES 16384 // 재전송 시 한 번의 send로 보낼 최대 바이트 수
+#define BACKOFF_INITIAL_MS 500 // 첫 재연결 대기 시간
+#define BACKOFF_MAX_MS 30000 // 최대 재연결 대기 시간
+#define CONNECT_TIMEOUT_MS 2000 // 연결 시도 최대 시간
+#define SEND_TIMEOUT_S 5 // 서버가 응답하지 않을 때 send가 막혀 있을 최대 시간
+#define DATAGRAM_BYTES 1400 // UDP 모드에서 데이터그램 하나의 최대 크기 (IP 조각나지 않는 크기)
+#define HELLO_INTERVAL_MS 30000 // UDP 모드에서 HELLO를 다시 보내는 주기 (서버가 다시 시작되어도 노드를 알 수 있도록)
+
+// 단조 증가 시계 (ms)
+static uint64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 링 데이터 영역에 복사하는 함수 (끝을 넘으면 앞으로 이어서 씀)
+static void ring_write(struct transport* t, uint64_t pos, const void* src, size_t len)
+{
+    uint64_t cap = t->spool->capacity;
+    size_t off = pos % cap;
+    size_t first = len < cap - off ? len : cap - off;
+    memcpy(t->spool_data + off, src, first);
+    memcpy(t->spool_data, (const uint8_t*)src + first, len - first);
+}
+
+// 링 데이터 영역에서 읽는 함수
+static void ring_read(const struct transport* t, uint64_t pos, void* dst, size_t len)
+{
+    uint64_t cap = t->spool->capacity;
+    size_t off = pos % cap;
+    size_t first = len < cap - off ? len : cap - off;
+    memcpy(dst, t->spool_data + off, first);
+    memcpy((uint8_t*)dst + first, t->spool_data, len - first);
+}
+
+// pos에 있는 레코드의 프레임 길이 (0이면 손상된 레코드)
+static size_t record_length(const struct transport* t, uint64_t pos)
+{
+    uint8_t hdr[SPOOL_RECORD_HEADER + 1];
+    ring_read(t, pos, hdr, sizeof(hdr));
+    size_t len = hdr[0] | (hdr[1] << 8);
+    if (len < PROTO_HEADER_SIZE || len > PROTO_MAX_FRAME || hdr[2] != PROTO_MAGIC)
+    {
+        return 0;
+    }
+    return len;
+}
+
+// spool 파일을 열거나 새로 만드는 함수
+static int spool_open(struct transport* t, const char* path, size_t bytes)
+{
+    t->spool_fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (t->spool_fd == -1)
+    {
+        perror("spool open failed");
+        return -1;
+    }
+
+    struct stat st;
+    size_t size = sizeof(struct spool_header) + bytes;
+    int fresh = fstat(t->spool_fd, &st) == -1 || (size_t)st.st_size != size;
+    if (fresh && ftruncate(t->spool_fd, size) == -1)
+    {
+        perror("spool ftruncate failed");
+        close(t->spool_fd);
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, t->spool_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror("spool mmap failed");
+        close(t->spool_fd);
+        return -1;
+    }
+    t->spool = map;
+    t->spool_data = (uint8_t*)map + sizeof(struct spool_header);
+
+    struct spool_header* h = t->spool;
+    if (fresh || memcmp(h->magic, "SPOL", 4) != 0 || h->version != SPOOL_VERSION || h->capacity != bytes || h->head < h->tail || h->head - h->tail > bytes)
+    {
+        memset(h, 0, sizeof(*h)); // 크기가 바뀌었거나 처음 만든 파일
+        memcpy(h->magic, "SPOL", 4);
+        h->version = SPOOL_VERSION;
+        h->capacity = bytes;
+        return 0;
+    }
+
+    // 남은 레코드를 따라가며 확인하고, 쓰다가 멈춘 레코드가 있으면 그 앞에서 자름
+    uint64_t pos = h->tail;
+    while (pos < h->head)
+    {
+        size_t len = record_length(t, pos);
+        if (len == 0 || pos + SPOOL_RECORD_HEADER + len > h->head)
+        {
+            break;
+        }
+        pos += SPOOL_RECORD_HEADER + len;
+    }
+    h->head = pos;
+    if (h->head > h->tail)
+    {
+        printf("Spool has %llu bytes of unsent readings\n", (unsigned long long)(h->head - h->tail));
+    }
+    return 0;
+}
+
+// spool 끝에 프레임을 추가하는 함수 (공간이 없으면 가장 오래된 프레임부터 버림)
+static int spool_append(struct transport* t, const uint8_t* frame, size_t len)
+{
+    struct spool_header* h = t->spool;
+    uint64_t need = SPOOL_RECORD_HEADER + len;
+    if (need > h->capacity)
+    {
+        return -1;
+    }
+    while (h->capacity - (h->head - h->tail) < need)
+    {
+        h->tail += SPOOL_RECORD_HEADER + record_length(t, h->tail);
+        h->dropped++;
+    }
+    uint8_t hdr[SPOOL_RECORD_HEADER] = {len & 0xFF, (len >> 8) & 0xFF};
+    ring_write(t, h->head, hdr, sizeof(hdr));
+    ring_write(t, h->head + SPOOL_RECORD_HEADER, frame, len);
+    h->head += need; // 레코드를 다 쓴 뒤에 공개
+    return 0;
+}
+
+// 버퍼를 모두 보내는 함수 (보낸 바이트 수 반환, 끝까지 못 보냈으면 그때까지의 바이트 수)
+static size_t send_all(int sock, const uint8_t* buf, size_t len)
+{
+    size_t sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = send(sock, buf + sent, len - sent, MSG_NOSIGNAL); // 끊긴 연결에 보내도 SIGPIPE로 죽지 않음
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+// 연결을 끊고 재연결을 예약하는 함수
+static void disconnect(struct transport* t)
+{
+    if (t->sock >= 0)
+    {
+        perror("Server connection lost, spooling readings");
+        close(t->sock);
+        t->sock = -1;
+    }
+    t->retry_at_ms = monotonic_ms() + t->backoff_ms + rand() % (t->backoff_ms / 4 + 1); // 여러 노드가 동시에 몰리지 않도록 흔들기
+    t->backoff_ms = t->backoff_ms * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : t->backoff_ms * 2;
+}
+
+// 제한 시간 안에 서버에 연결하는 함수
+static int connect_with_timeout(const struct transport* t)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(t->port);
+    addr.sin_addr.s_addr = inet_addr(t->host);
+
+    int sock = socket(AF_INET, t->datagram ? SOCK_DGRAM : SOCK_STREAM, 0); // UDP는 connect로 목적지만 정해 둠
+    if (sock == -1)
+    {
+        return -1;
+    }
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK); // 연결 대기 시간을 제한하기 위해 잠시 논블로킹
+
+    int err = 0;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+    {
+        struct pollfd pfd = {.fd = sock, .events = POLLOUT};
+        socklen_t err_len = sizeof(err);
+        if (errno != EINPROGRESS || poll(&pfd, 1, CONNECT_TIMEOUT_MS) != 1 || getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &err_len) == -1)
+        {
+            err = err ? err : ETIMEDOUT;
+        }
+    }
+    if (err != 0)
+    {
+        close(sock);
+        errno = err;
+        return -1;
+    }
+
+    fcntl(sock, F_SETFL, flags);
+    struct timeval tv = {.tv_sec = SEND_TIMEOUT_S, .tv_usec = 0};
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)); // 서버가 멈춰도 측정 쓰레드가 무한히 막히지 않음
+    return sock;
+}
+
+// spool에 남은 프레임을 모두 보관 표시하는 함수 (연결된 채로 붙인 새 측정이 전송 실패로 남으면 재연결 후 밀린 기록으로 가도록)
+static void mark_spool(struct transport* t)
+{
+    struct spool_header* h = t->spool;
+    for (uint64_t pos = h->tail; pos < h->head;)
+    {
+        size_t len = record_length(t, pos);
+        if (len == 0)
+        {
+            return; // 손상된 레코드 이후는 다음 flush_spool이 버림
+        }
+        uint8_t head[3]; // 시작 바이트, 버전, 종류
+        ring_read(t, pos + SPOOL_RECORD_HEADER, head, sizeof(head));
+        proto_mark_spooled(head);
+        ring_write(t, pos + SPOOL_RECORD_HEADER, head, sizeof(head));
+        pos += SPOOL_RECORD_HEADER + len;
+    }
+}
+
+// 밀린 프레임을 묶어서 보내는 함수 (다 보내면 0, 연결이 끊기면 남은 프레임을 보관 표시하고 -1)
+static int flush_spool(struct transport* t)
+{
+    struct spool_header* h = t->spool;
+    uint8_t batch[SPOOL_BATCH_BYTES];
+    size_t limit = t->datagram ? DATAGRAM_BYTES : sizeof(batch); // UDP는 send 한 번이 데이터그램 하나
+    uint64_t total = 0;
+
+    while (h->tail < h->head)
+    {
+        // 배치 버퍼가 찰 때까지 레코드를 이어 붙임
+        uint64_t pos = h->tail;
+        size_t used = 0, frames = 0;
+        size_t ends[SPOOL_BATCH_BYTES / PROTO_HEADER_SIZE]; // 각 프레임이 끝나는 위치
+        while (pos < h->head)
+        {
+            size_t len = record_length(t, pos);
+            if (len == 0)
+            {
+                h->tail = h->head; // 손상된 레코드 이후는 믿을 수 없으므로 버림
+                return 0;
+            }
+            if (used + len > limit)
+            {
+                break;
+            }
+            ring_read(t, pos + SPOOL_RECORD_HEADER, batch + used, len);
+            used += len;
+            ends[frames++] = used;
+            pos += SPOOL_RECORD_HEADER + len;
+        }
+
+        size_t sent = send_all(t->sock, batch, used);
+        if (sent == used)
+        {
+            h->tail = pos;
+            total += used;
+            continue;
+        }
+
+        // 끝까지 보낸 프레임까지만 spool에서 제거
+        for (size_t i = 0; i < frames && ends[i] <= sent; i++)
+        {
+            h->tail += SPOOL_RECORD_HEADER + (ends[i] - (i ? ends[i - 1] : 0));
+        }
+        mark_spool(t);
+        disconnect(t);
+        return -1;
+    }
+    if (total > 0)
+    {
+        printf("Replayed %llu bytes of spooled readings\n", (unsigned long long)total);
+    }
+    return 0;
+}
+
+// HELLO 전송 함수 (노드가 여럿이면 한 번의 send로 모두 알림, 실패하면 -1)
+static int send_hello(struct transport* t, int first)
+{
+    uint8_t hello[TRANSPORT_NODES * PROTO_MAX_FRAME];
+    size_t hello_len = 0;
+    for (int i = first; i < t->node_count; i++)
+    {
+        hello_len += proto_encode_hello(hello + hello_len, sizeof(hello) - hello_len, t->nodes[i].node_id, proto_now_ms(), t->nodes[i].sensor_type, t->site_id, t->zone_id);
+    }
+    if (send_all(t->sock, hello, hello_len) != hello_len)
+    {
+        disconnect(t);
+        return -1;
+    }
+    t->hello_at_ms = monotonic_ms() + HELLO_INTERVAL_MS;
+    return 0;
+}
+
+// 재연결 시각이 지났으면 연결하고 HELLO를 보내는 함수
+static void try_reconnect(struct transport* t)
+{
+    if (t->sock >= 0 && t->datagram && monotonic_ms() >= t->hello_at_ms)
+    {
+        send_hello(t, 0); // UDP는 연결이 없으므로 서버 재시작을 알 수 없어 주기적으로 다시 알림
+        return;
+    }
+    if (t->sock >= 0 || monotonic_ms() < t->retry_at_ms)
+    {
+        return;
+    }
+    t->sock = connect_with_timeout(t);
+    if (t->sock == -1)
+    {
+        perror("Server connection failed, will retry");
+        disconnect(t);
+        return;
+    }
+
+    if (send_hello(t, 0) == -1)
+    {
+        return;
+    }
+    printf(t->datagram ? "Sending to server over UDP\n" : "Connected to server\n");
+    t->rx_len = 0; // 이전 연결에서 받다 만 프레임은 버림
+    t->backoff_ms = BACKOFF_INITIAL_MS;
+}
+
+// 전송 객체 초기화 함수
+int transport_open(struct transport* t, const char* host, int port, uint32_t node_id, uint8_t sensor_type, uint16_t site_id, uint16_t zone_id, const char* spool_path, size_t spool_bytes)
+{
+    memset(t, 0, sizeof(*t));
+    snprintf(t->host, sizeof(t->host), "%s", host);
+    t->port = port;
+    t->nodes[0].node_id = node_id;
+    t->nodes[0].sensor_type = sensor_type;
+    t->node_count = 1;
+    t->site_id = site_id;
+    t->zone_id = zone_id;
+    t->sock = -1;
+    t->spool_fd = -1;
+    t->backoff_ms = BACKOFF_INITIAL_MS;
+    srand((unsigned)(node_id ^ monotonic_ms()));
+    proto_batch_reset(&t->batch);
+    const char* batch = getenv("CLIENT_BATCH_MS"); // 묶음 전송 최대 지연
+    if (batch != NULL)
+    {
+        t->batch_ms = atoi(batch) > 0 ? atoi(batch) : 0;
+    }
+    const char* mode = getenv("CLIENT_TRANSPORT"); // "udp"이면 연결 없이 데이터그램으로 전송
+    t->datagram = mode != NULL && strcmp(mode, "udp") == 0;
+
+    if (spool_path != NULL && spool_open(t, spool_path, spool_bytes) == -1)
+    {
+        return -1;
+    }
+    transport_poll(t);
+    return 0;
+}
+
+// 노드 추가 함수
+int transport_add_node(struct transport* t, uint32_t node_id, uint8_t sensor_type)
+{
+    if (t->node_count == TRANSPORT_NODES)
+    {
+        return -1;
+    }
+    t->nodes[t->node_count].node_id = node_id;
+    t->nodes[t->node_count].sensor_type = sensor_type;
+    t->node_count++;
+    if (t->sock >= 0)
+    {
+        send_hello(t, t->node_count - 1); // 실패하면 연결을 끊으므로 재연결 때 모든 노드를 다시 알림
+    }
+    return 0;
+}
+
+// 재연결 및 밀린 프레임 전송 함수
+void transport_poll(struct transport* t)
+{
+    if (t->batch.count > 0 && monotonic_ms() >= t->batch_deadline_ms)
+    {
+        transport_flush(t); // 최대 대기 시간이 지난 묶음
+    }
+    try_reconnect(t);
+    if (t->sock >= 0 && t->spool != NULL)
+    {
+        flush_spool(t);
+    }
+}
+
+// 프레임 하나를 보내거나 spool에 저장하는 함수
+static int send_frame(struct transport* t, const uint8_t* frame, size_t len)
+{
+    try_reconnect(t);
+
+    // 밀린 프레임이 없으면 바로 전송
+    if (t->sock >= 0 && transport_backlog(t) == 0)
+    {
+        if (send_all(t->sock, frame, len) == len)
+        {
+            return 1;
+        }
+        disconnect(t);
+    }
+
+    // 연결이 없어 보관하는 프레임은 서버가 현재 상태 판단에 쓰지 않도록 표시
+    // (노드 시계는 부팅 직후 NTP 동기화 전까지 틀릴 수 있으므로 서버는 시각 대신 이 표시로 밀린 기록을 구분함,
+    //  연결된 채로 밀린 프레임 뒤에 붙는 새 측정은 표시하지 않고, 함께 보내지 못하면 flush_spool이 표시함)
+    uint8_t marked[PROTO_MAX_FRAME];
+    if (t->sock < 0 && len <= sizeof(marked))
+    {
+        memcpy(marked, frame, len);
+        proto_mark_spooled(marked);
+        frame = marked;
+    }
+
+    // 순서를 지키기 위해 밀린 프레임 뒤에 붙인 뒤 연결되어 있으면 함께 보냄
+    if (t->spool == NULL || spool_append(t, frame, len) == -1)
+    {
+        return -1;
+    }
+    if (t->sock >= 0 && flush_spool(t) == 0)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+// 모아 둔 측정 전송 함수
+void transport_flush(struct transport* t)
+{
+    uint8_t frame[PROTO_MAX_FRAME];
+    size_t len = proto_encode_batch(frame, sizeof(frame), &t->batch);
+    proto_batch_reset(&t->batch);
+    if (len > 0 && send_frame(t, frame, len) == -1)
+    {
+        printf("Batch dropped\n");
+    }
+}
+
+// 프레임 전송 함수
+int transport_send(struct transport* t, const uint8_t* frame, size_t len)
+{
+    if (t->batch_ms <= 0)
+    {
+        return send_frame(t, frame, len);
+    }
+
+    // 묶음에 넣을 수 없으면(가득 참, seq가 이어지지 않음 등) 모아 둔 것을 먼저 보냄
+    if (proto_batch_add(&t->batch, frame, len) == -1)
+    {
+        transport_flush(t);
+        if (proto_batch_add(&t->batch, frame, len) == -1)
+        {
+            return send_frame(t, frame, len); // 묶을 수 없는 프레임
+        }
+    }
+    if (t->batch.count == 1)
+    {
+        t->batch_deadline_ms = monotonic_ms() + t->batch_ms; // 첫 측정부터 최대 대기 시간 계산
+    }
+    if (monotonic_ms() >= t->batch_deadline_ms)
+    {
+        transport_flush(t);
+    }
+    return 0;
+}
+
+// 묶음 전송 설정 함수
+void transport_set_batch(struct transport* t, int max_latency_ms)
+{
+    if (t->batch.count > 0)
+    {
+        transport_flush(t);
+    }
+    t->batch_ms = max_latency_ms > 0 ? max_latency_ms : 0;
+}
+
+// 노드별 측정 속도 지시 수신 함수
+int transport_controls(struct transport* t, struct proto_control* out, uint32_t* node_ids, int max)
+{
+    int received = 0;
+    if (t->sock < 0 || t->datagram)
+    {
+        return 0; // UDP 노드는 서버에서 받는 것이 없음
+    }
+
+    while (1)
+    {
+        ssize_t n = recv(t->sock, t->rx + t->rx_len, sizeof(t->rx) - t->rx_len, MSG_DONTWAIT);
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            if (n == 0)
+            {
+                errno = ECONNRESET;
+            }
+            disconnect(t); // 서버가 연결을 닫음
+            return received;
+        }
+        if (n < 0)
+        {
+            return received; // 더 읽을 것이 없음
+        }
+        t->rx_len += n;
+
+        // 완성된 프레임만 처리 (판정 응답 등 다른 프레임은 건너뜀)
+        size_t off = 0;
+        while (off < t->rx_len)
+        {
+            struct proto_frame frame;
+            struct proto_control control;
+            int used = proto_decode(t->rx + off, t->rx_len - off, &frame);
+            if (used == PROTO_NEED_MORE)
+            {
+                break;
+            }
+            if (used == PROTO_BAD_FRAME)
+            {
+                off++; // 재동기화
+                continue;
+            }
+            off += used;
+            if (frame.type != PROTO_CONTROL || proto_parse_control(&frame, &control) == -1)
+            {
+                continue;
+            }
+
+            // 같은 노드에 온 지시는 마지막 것만 남김 (자리가 없으면 마지막 자리를 덮어씀)
+            int i = 0;
+            while (i < received && node_ids[i] != frame.node_id)
+            {
+                i++;
+            }
+            if (i == max)
+            {
+                i = max - 1;
+            }
+            else if (i == received)
+            {
+                received++;
+            }
+            out[i] = control;
+            node_ids[i] = frame.node_id;
+        }
+        t->rx_len -= off;
+        memmove(t->rx, t->rx + off, t->rx_len);
+    }
+}
+
+// 측정 속도 지시 수신 함수 (노드가 하나인 클라이언트용)
+int transport_control(struct transport* t, struct proto_control* out)
+{
+    struct proto_control controls[TRANSPORT_NODES];
+    uint32_t node_ids[TRANSPORT_NODES];
+    int count = transport_controls(t, controls, node_ids, TRANSPORT_NODES);
+    if (count == 0)
+    {
+        return 0;
+    }
+    *out = controls[count - 1];
+    return 1;
+}
+
+// spool에 남은 바이트 수 반환 함수
+uint64_t transport_backlog(const struct transport* t)
+{
+    return t->spool != NULL ? t->spool->head - t->spool->tail : 0;
+}
+
+// 종료 함수
+void transport_close(struct transport* t)
+{
+    if (t->batch.count > 0)
+    {
+        transport_flush(t); // 모아 둔 측정은 보내거나 spool에 남김
+    }
+    if (t->sock >= 0)
+    {
+        close(t->sock);
+        t->sock = -1;
+    }
+    if (t->spool != NULL)
+    {
+        size_t size = sizeof(struct spool_header) + t->spool->capacity;
+        msync(t->spool, size, MS_SYNC); // 남은 프레임을 디스크에 기록
+        munmap(t->spool, size);
+        t->spool = NULL;
+    }
+    if (t->spool_fd >= 0)
+    {
+        close(t->spool_fd);
+        t->spool_fd = -1;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "protocol.h"
+
+/*
+ * 센서 클라이언트 공용 전송 모듈
+ * - 연결이 끊기면 지수 백오프(0.5초부터 두 배씩, 최대 30초)로 다시 연결하고 연결마다 HELLO를 보냄
+ * - 연결이 없거나 전송에 실패한 프레임은 mmap 링 파일(spool)에 저장 (가득 차면 가장 오래된 것부터 버림)
+ * - 다시 연결되면 spool을 여러 프레임씩 묶어 한 번의 send로 보내고, 다 보낸 뒤에야 새 프레임을 바로 보냄
+ *   (순서 유지, 측정 시각은 프레임에 기록된 원래 시각 그대로)
+ * spool 파일은 프로세스가 다시 시작되어도 남아 있어 이어서 재전송함
+ * 묶음 전송을 켜면(transport_set_batch, 또는 CLIENT_BATCH_MS 환경 변수) 측정을 PROTO_BATCH 프레임에 모았다가
+ * 첫 측정 후 정해진 시간이 지나거나 프레임이 가득 차면 한 번에 보냄 (시간 확인은 transport_send/transport_poll에서)
+ * CLIENT_TRANSPORT=udp이면 같은 프레임을 UDP 데이터그램으로 보냄 (저전력 노드용, 연결 유지 없음)
+ * - HELLO는 30초마다 다시 보내고, 손실은 서버가 시퀀스 번호로 계산 (재전송 없음)
+ * - 전송 오류(ICMP 거부 등)가 나면 TCP와 같이 spool에 저장하고 백오프 후 다시 보냄
+ * TCP 연결로는 서버가 보내는 측정 속도 지시(PROTO_CONTROL)도 받음 (transport_control로 확인, 기다리지 않음)
+ * 센서 여러 개를 가진 에이전트는 transport_add_node로 노드를 더해 연결 하나와 spool 하나를 함께 씀
+ * - 연결마다 모든 노드의 HELLO를 보내고, 프레임은 각자의 node id로 보냄
+ * - 측정 속도 지시는 노드마다 오므로 transport_controls로 node id와 함께 받음
+ * 한 전송 객체는 한 쓰레드에서만 사용
+ */
+
+#define TRANSPORT_NODES 8 // 한 연결로 보낼 수 있는 최대 노드 수 (서버의 CONN_NODES와 같음)
+
+// 연결로 보내는 노드
+struct transport_node
+{
+    uint32_t node_id; // HELLO에 보낼 노드 ID
+    uint8_t sensor_type; // HELLO에 보낼 센서 종류
+};
+
+// spool 파일 머리 (파일 앞부분, 데이터 영역은 그 뒤)
+struct spool_header
+{
+    char magic[4]; // "SPOL"
+    uint32_t version; // 형식 버전
+    uint64_t capacity; // 데이터 영역 크기
+    uint64_t head; // 다음에 쓸 위치 (누적 바이트, capacity로 나눈 나머지가 실제 위치)
+    uint64_t tail; // 다음에 보낼 위치
+    uint64_t dropped; // 가득 차서 버린 프레임 수
+};
+
+// 서버 연결과 spool
+struct transport
+{
+    char host[64]; // 서버 주소
+    int port; // 서버 포트
+    struct transport_node nodes[TRANSPORT_NODES]; // HELLO에 보낼 노드 정보 (첫 번째는 transport_open의 노드)
+    int node_count; // 노드 수
+    uint16_t site_id; // 모든 노드가 같은 현장/구역
+    uint16_t zone_id;
+    int sock; // 연결된 소켓 (-1이면 연결 없음)
+    int backoff_ms; // 다음 재연결까지 기다릴 시간
+    uint64_t retry_at_ms; // 다음 재연결 시도 시각
+    int spool_fd; // spool 파일
+    struct spool_header* spool; // mmap한 spool (NULL이면 spool 없이 동작)
+    uint8_t* spool_data; // 데이터 영역
+    int batch_ms; // 측정을 모아 둘 최대 시간 (0이면 묶지 않음)
+    uint64_t batch_deadline_ms; // 모아 둔 측정을 보내야 하는 시각
+    struct proto_batch batch; // 모으는 중인 측정
+    int datagram; // UDP로 보내는지 여부
+    uint64_t hello_at_ms; // UDP 모드에서 다음 HELLO 시각
+    uint8_t rx[PROTO_MAX_FRAME * 2]; // 서버가 보낸 프레임 수신 버퍼
+    size_t rx_len; // 수신 버퍼에 쌓인 바이트 수
+};
+
+// 전송 객체 초기화 (spool_path가 NULL이면 spool 없음, 바로 연결을 시도하지만 실패해도 0 반환)
+int transport_open(struct transport* t, const char* host, int port, uint32_t node_id, uint8_t sensor_type, uint16_t site_id, uint16_t zone_id, const char* spool_path, size_t spool_bytes);
+
+// 같은 연결로 보낼 노드 추가 (연결되어 있으면 바로 HELLO를 보냄, 자리가 없으면 -1)
+int transport_add_node(struct transport* t, uint32_t node_id, uint8_t sensor_type);
+
+// 프레임 전송 (연결이 없으면 spool에 저장, 재연결 시각이 지났으면 재연결 후 밀린 프레임부터 전송)
+// 반환값: 1 바로 전송됨, 0 spool이나 묶음에 보관됨, -1 저장도 못 함
+int transport_send(struct transport* t, const uint8_t* frame, size_t len);
+
+// 연결이 없으면 재연결을 시도하고 밀린 프레임과 시간이 다 된 묶음을 보내는 함수 (보낼 프레임이 없을 때 주기적으로 호출)
+void transport_poll(struct transport* t);
+
+// 묶음 전송 설정 (max_latency_ms 0이면 측정마다 바로 전송)
+void transport_set_batch(struct transport* t, int max_latency_ms);
+
+// 모아 둔 측정을 바로 보내는 함수 (급한 측정을 보낸 직후 등)
+void transport_flush(struct transport* t);
+
+// 서버가 보낸 프레임을 읽어 새 측정 속도 지시가 있으면 *out에 채우고 1 반환 (없으면 0, 여러 개면 마지막 것)
+int transport_control(struct transport* t, struct proto_control* out);
+
+// 서버가 보낸 측정 속도 지시를 노드별로 최대 max개 받는 함수 (node_ids[i]가 out[i]를 받을 노드, 같은 노드는 마지막 것만, 받은 수 반환)
+int transport_controls(struct transport* t, struct proto_control* out, uint32_t* node_ids, int max);
+
+// spool에 남은 바이트 수
+uint64_t transport_backlog(const struct transport* t);
+
+// 연결 종료 및 spool 반납
+void transport_close(struct transport* t);
+
+#endif
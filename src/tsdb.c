@@ -0,0 +1,410 @@
+#define _GNU_SOURCE // scandir 사용을 위해 정의
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tsdb.h"
+
+#define TSDB_MAGIC "TSDB" // 세그먼트 파일 식별자
+#define TSDB_VERSION 1 // 세그먼트 형식 버전
+#define HEADER_SIZE 4096 // 헤더 영역 크기
+#define INDEX_BLOCKS (TSDB_SEGMENT_RECORDS / TSDB_BLOCK_RECORDS) // 세그먼트당 인덱스 블록 수
+#define INDEX_OFFSET HEADER_SIZE // 인덱스 시작 위치
+#define RECORDS_OFFSET (INDEX_OFFSET + INDEX_BLOCKS * sizeof(struct block_index)) // 레코드 시작 위치
+#define SEGMENT_SIZE (RECORDS_OFFSET + (size_t)TSDB_SEGMENT_RECORDS * sizeof(struct tsdb_record)) // 세그먼트 파일 크기
+#define PATH_MAX_LEN 512 // 경로 최대 길이
+#define SEGMENT_NAME_LEN 18 // 디렉터리 뒤에 붙는 "/seg-%08u.tsd"와 끝 NUL 길이
+
+// 세그먼트 헤더 (파일 맨 앞)
+struct segment_header
+{
+    char magic[4]; // "TSDB"
+    uint32_t version; // 형식 버전
+    uint32_t record_size; // 레코드 크기
+    uint32_t capacity; // 레코드 최대 수
+    uint32_t count; // 기록된 레코드 수 (복구 시 시작점으로만 사용)
+    uint32_t segment_no; // 세그먼트 번호
+    uint64_t min_ts; // 세그먼트 내 최소 시각
+    uint64_t max_ts; // 세그먼트 내 최대 시각
+};
+
+// 블록별 시간 인덱스
+struct block_index
+{
+    uint64_t min_ts; // 블록 내 최소 시각
+    uint64_t max_ts; // 블록 내 최대 시각
+};
+
+// mmap된 세그먼트
+struct segment
+{
+    int fd; // 파일 디스크립터
+    uint8_t* base; // mmap 시작 주소
+    struct segment_header* header; // 헤더
+    struct block_index* index; // 시간 인덱스
+    struct tsdb_record* records; // 레코드 배열
+};
+
+// 쓰기용 저장소 상태
+static struct
+{
+    int open; // 열려 있는지 여부
+    char dir[PATH_MAX_LEN]; // 저장 디렉터리
+    struct segment seg; // 현재 쓰는 세그먼트
+    uint32_t count; // 현재 세그먼트의 레코드 수
+    pthread_mutex_t lock; // 추가 작업 직렬화 (임계 구역은 레코드 복사뿐)
+} store = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+// 레코드 체크섬 계산 함수 (FNV-1a, 0은 빈 레코드 표시용으로 쓰지 않음)
+static uint32_t record_check(const struct tsdb_record* record)
+{
+    const uint8_t* p = (const uint8_t*)record;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(struct tsdb_record, check); i++)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// 레코드가 온전히 기록되었는지 확인하는 함수
+static int record_valid(const struct tsdb_record* record)
+{
+    return record->check != 0 && record->check == record_check(record);
+}
+
+// 세그먼트 파일 경로를 만드는 함수 (경로가 잘리면 -1)
+static int segment_path(char* path, const char* dir, uint32_t segment_no)
+{
+    int len = snprintf(path, PATH_MAX_LEN, "%s/seg-%08u.tsd", dir, segment_no);
+    if (len < 0 || len >= PATH_MAX_LEN)
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+// 세그먼트 파일을 mmap하는 함수
+static int map_segment(struct segment* seg, const char* path, int writable, int create)
+{
+    int flags = writable ? O_RDWR : O_RDONLY;
+    seg->fd = open(path, flags | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (seg->fd == -1)
+    {
+        return -1;
+    }
+    if (create && ftruncate(seg->fd, SEGMENT_SIZE) == -1) // 파일 크기만 잡아 두고 실제 블록은 쓸 때 할당
+    {
+        close(seg->fd);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(seg->fd, &st) == -1 || (size_t)st.st_size < SEGMENT_SIZE)
+    {
+        close(seg->fd);
+        return -1;
+    }
+
+    seg->base = mmap(NULL, SEGMENT_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, seg->fd, 0);
+    if (seg->base == MAP_FAILED)
+    {
+        close(seg->fd);
+        return -1;
+    }
+    seg->header = (struct segment_header*)seg->base;
+    seg->index = (struct block_index*)(seg->base + INDEX_OFFSET);
+    seg->records = (struct tsdb_record*)(seg->base + RECORDS_OFFSET);
+
+    if (!create && (memcmp(seg->header->magic, TSDB_MAGIC, 4) != 0 || seg->header->record_size != sizeof(struct tsdb_record)))
+    {
+        munmap(seg->base, SEGMENT_SIZE);
+        close(seg->fd);
+        return -1;
+    }
+    return 0;
+}
+
+// 세그먼트 mmap 해제 함수
+static void unmap_segment(struct segment* seg)
+{
+    munmap(seg->base, SEGMENT_SIZE);
+    close(seg->fd);
+}
+
+// 온전한 레코드 수를 세는 함수 (헤더 값부터 체크섬이 맞는 데까지)
+static uint32_t recover_count(const struct segment* seg)
+{
+    uint32_t count = seg->header->count;
+    if (count > TSDB_SEGMENT_RECORDS)
+    {
+        count = 0;
+    }
+    while (count < TSDB_SEGMENT_RECORDS && record_valid(&seg->records[count]))
+    {
+        count++;
+    }
+    return count;
+}
+
+// 새 세그먼트를 만드는 함수
+static int create_segment(uint32_t segment_no)
+{
+    char path[PATH_MAX_LEN];
+    if (segment_path(path, store.dir, segment_no) == -1 || map_segment(&store.seg, path, 1, 1) == -1)
+    {
+        fprintf(stderr, "Failed to create segment %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct segment_header* h = store.seg.header;
+    memcpy(h->magic, TSDB_MAGIC, 4);
+    h->version = TSDB_VERSION;
+    h->record_size = sizeof(struct tsdb_record);
+    h->capacity = TSDB_SEGMENT_RECORDS;
+    h->count = 0;
+    h->segment_no = segment_no;
+    store.count = 0;
+    return 0;
+}
+
+// 디렉터리에서 세그먼트 파일만 고르는 함수
+static int segment_filter(const struct dirent* entry)
+{
+    unsigned int no;
+    char tail;
+    return sscanf(entry->d_name, "seg-%8u.tsd%c", &no, &tail) == 1;
+}
+
+// 저장소 열기 함수
+int tsdb_open(const char* dir)
+{
+    struct dirent** names;
+    uint32_t last = 0;
+    int found = 0;
+
+    // 세그먼트 파일 이름을 붙여도 경로 최대 길이를 넘지 않아야 함
+    if (strlen(dir) > PATH_MAX_LEN - SEGMENT_NAME_LEN)
+    {
+        fprintf(stderr, "History directory path is too long: %s\n", dir);
+        return -1;
+    }
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+    {
+        fprintf(stderr, "Failed to create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    pthread_mutex_lock(&store.lock);
+    snprintf(store.dir, sizeof(store.dir), "%s", dir);
+
+    // 가장 마지막 세그먼트 찾기 (이름이 고정 폭이라 정렬 순서 = 번호 순서)
+    int n = scandir(dir, &names, segment_filter, alphasort);
+    if (n > 0)
+    {
+        sscanf(names[n - 1]->d_name, "seg-%8u.tsd", &last);
+        found = 1;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        free(names[i]);
+    }
+    if (n >= 0)
+    {
+        free(names);
+    }
+
+    int ret = -1;
+    char path[PATH_MAX_LEN];
+    if (found && segment_path(path, dir, last) == 0 && map_segment(&store.seg, path, 1, 0) == 0)
+    {
+        // 비정상 종료로 헤더가 늦게 갱신됐을 수 있으므로 체크섬으로 끝을 다시 찾음
+        store.count = recover_count(&store.seg);
+        store.seg.header->count = store.count;
+
+        // 마지막 블록 인덱스 재구성
+        uint32_t block = store.count / TSDB_BLOCK_RECORDS;
+        if (block < INDEX_BLOCKS)
+        {
+            struct block_index* idx = &store.seg.index[block];
+            idx->min_ts = idx->max_ts = 0;
+            for (uint32_t i = block * TSDB_BLOCK_RECORDS; i < store.count; i++)
+            {
+                uint64_t ts = store.seg.records[i].timestamp_ms;
+                if (i == block * TSDB_BLOCK_RECORDS || ts < idx->min_ts)
+                {
+                    idx->min_ts = ts;
+                }
+                if (ts > idx->max_ts)
+                {
+                    idx->max_ts = ts;
+                }
+            }
+        }
+        printf("Time-series store recovered %u records in segment %u\n", store.count, last);
+        ret = 0;
+    }
+    else
+    {
+        ret = create_segment(found ? last + 1 : 0);
+    }
+
+    store.open = (ret == 0);
+    pthread_mutex_unlock(&store.lock);
+    return ret;
+}
+
+// 레코드 추가 함수
+int tsdb_append(uint64_t timestamp_ms, uint32_t node_id, uint16_t site_id, uint8_t kind, float v0, float v1, float v2)
+{
+    pthread_mutex_lock(&store.lock);
+    if (!store.open)
+    {
+        pthread_mutex_unlock(&store.lock);
+        return -1;
+    }
+
+    // 세그먼트가 가득 차면 다음 세그먼트로 교체
+    if (store.count == TSDB_SEGMENT_RECORDS)
+    {
+        uint32_t next = store.seg.header->segment_no + 1;
+        msync(store.seg.base, SEGMENT_SIZE, MS_ASYNC);
+        unmap_segment(&store.seg);
+        if (create_segment(next) == -1)
+        {
+            store.open = 0;
+            pthread_mutex_unlock(&store.lock);
+            return -1;
+        }
+    }
+
+    struct tsdb_record* r = &store.seg.records[store.count];
+    r->timestamp_ms = timestamp_ms;
+    r->node_id = node_id;
+    r->site_id = site_id;
+    r->kind = kind;
+    r->reserved = 0;
+    r->value[0] = v0;
+    r->value[1] = v1;
+    r->value[2] = v2;
+    r->check = record_check(r); // 체크섬을 마지막에 써서 레코드 완성 표시
+
+    // 블록 인덱스와 세그먼트 범위 갱신
+    struct block_index* idx = &store.seg.index[store.count / TSDB_BLOCK_RECORDS];
+    struct segment_header* h = store.seg.header;
+    if (store.count % TSDB_BLOCK_RECORDS == 0 || timestamp_ms < idx->min_ts)
+    {
+        idx->min_ts = timestamp_ms;
+    }
+    if (timestamp_ms > idx->max_ts)
+    {
+        idx->max_ts = timestamp_ms;
+    }
+    if (store.count == 0 || timestamp_ms < h->min_ts)
+    {
+        h->min_ts = timestamp_ms;
+    }
+    if (timestamp_ms > h->max_ts)
+    {
+        h->max_ts = timestamp_ms;
+    }
+    h->count = ++store.count;
+
+    pthread_mutex_unlock(&store.lock);
+    return 0;
+}
+
+// 세그먼트 하나를 조회하는 함수
+static size_t query_segment(const struct segment* seg, uint64_t from_ms, uint64_t to_ms, uint32_t node_id, tsdb_visit visit, void* arg)
+{
+    size_t found = 0;
+    uint32_t count = recover_count(seg);
+
+    if (count == 0 || seg->header->max_ts < from_ms || seg->header->min_ts > to_ms)
+    {
+        return 0; // 세그먼트 전체가 구간 밖
+    }
+
+    for (uint32_t block = 0; block * TSDB_BLOCK_RECORDS < count; block++)
+    {
+        const struct block_index* idx = &seg->index[block];
+        if (idx->max_ts < from_ms || idx->min_ts > to_ms)
+        {
+            continue; // 블록 전체가 구간 밖
+        }
+
+        uint32_t end = (block + 1) * TSDB_BLOCK_RECORDS;
+        if (end > count)
+        {
+            end = count;
+        }
+        for (uint32_t i = block * TSDB_BLOCK_RECORDS; i < end; i++)
+        {
+            const struct tsdb_record* r = &seg->records[i];
+            if (r->timestamp_ms >= from_ms && r->timestamp_ms <= to_ms && (node_id == 0 || r->node_id == node_id) && record_valid(r))
+            {
+                visit(r, arg);
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+// 구간 조회 함수
+size_t tsdb_query(const char* dir, uint64_t from_ms, uint64_t to_ms, uint32_t node_id, tsdb_visit visit, void* arg)
+{
+    struct dirent** names;
+    size_t found = 0;
+
+    int n = scandir(dir, &names, segment_filter, alphasort);
+    if (n < 0)
+    {
+        return 0;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        char path[PATH_MAX_LEN];
+        struct segment seg;
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+        if (map_segment(&seg, path, 0, 0) == 0)
+        {
+            found += query_segment(&seg, from_ms, to_ms, node_id, visit, arg);
+            unmap_segment(&seg);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return found;
+}
+
+// 디스크 반영 요청 함수
+void tsdb_flush(void)
+{
+    pthread_mutex_lock(&store.lock);
+    if (store.open)
+    {
+        msync(store.seg.base, SEGMENT_SIZE, MS_ASYNC);
+    }
+    pthread_mutex_unlock(&store.lock);
+}
+
+// 저장소 닫기 함수
+void tsdb_close(void)
+{
+    pthread_mutex_lock(&store.lock);
+    if (store.open)
+    {
+        msync(store.seg.base, SEGMENT_SIZE, MS_SYNC);
+        unmap_segment(&store.seg);
+        store.open = 0;
+    }
+    pthread_mutex_unlock(&store.lock);
+}
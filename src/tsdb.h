@@ -0,0 +1,55 @@
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 측정값 이력을 저장하는 append-only 시계열 저장소
+ * 고정 크기 레코드를 mmap된 세그먼트 파일에 이어 쓰고, 가득 차면 새 세그먼트로 넘어감
+ * 세그먼트마다 256개 레코드 단위의 시간 인덱스(최소/최대 시각)를 두어 구간 조회 시 필요한 블록만 읽음
+ * 레코드마다 체크섬이 있어 비정상 종료 후 다시 열면 마지막으로 온전한 레코드까지 복구함
+ */
+#define TSDB_SEGMENT_RECORDS (1 << 20) // 세그먼트당 레코드 수 (32MB)
+#define TSDB_BLOCK_RECORDS 256 // 시간 인덱스 블록 크기
+
+// 레코드 종류
+enum tsdb_kind
+{
+    TSDB_TEMP = 1, // value: 온도, 습도, 습구 온도
+    TSDB_LIGHT = 2, // value: 조도, 흑구 온도
+    TSDB_PIR = 3, // value: 모션 감지 여부
+    TSDB_WBGT = 4 // value: WBGT, 건구 온도, 흑구 온도 (node_id는 0)
+};
+
+// 저장 레코드 (32바이트)
+struct tsdb_record
+{
+    uint64_t timestamp_ms; // 측정 시각
+    uint32_t node_id; // 노드 ID
+    uint16_t site_id; // 현장 ID
+    uint8_t kind; // 레코드 종류 (enum tsdb_kind)
+    uint8_t reserved; // 예약
+    float value[3]; // 측정값
+    uint32_t check; // 체크섬 (0이면 기록되지 않은 레코드)
+};
+
+// 조회 결과를 받는 함수
+typedef void (*tsdb_visit)(const struct tsdb_record* record, void* arg);
+
+// 저장소 열기 (디렉터리가 없으면 생성, 마지막 세그먼트는 복구 후 이어 씀)
+int tsdb_open(const char* dir);
+
+// 레코드 추가 (저장소가 열려 있지 않으면 아무것도 하지 않음)
+int tsdb_append(uint64_t timestamp_ms, uint32_t node_id, uint16_t site_id, uint8_t kind, float v0, float v1, float v2);
+
+// [from_ms, to_ms] 구간 레코드 조회 (node_id가 0이면 모든 노드, 반환값은 찾은 레코드 수)
+size_t tsdb_query(const char* dir, uint64_t from_ms, uint64_t to_ms, uint32_t node_id, tsdb_visit visit, void* arg);
+
+// 기록된 내용을 디스크에 비동기로 반영 요청
+void tsdb_flush(void);
+
+// 저장소 닫기
+void tsdb_close(void);
+
+#endif
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tsdb.h"
+
+// 조회한 레코드를 CSV 한 줄로 출력하는 함수
+static void print_record(const struct tsdb_record* record, void* arg)
+{
+    (void)arg;
+    printf("%llu,%u,%u,%u,%.2f,%.2f,%.2f\n", (unsigned long long)record->timestamp_ms, record->node_id, record->site_id, record->kind, record->value[0], record->value[1], record->value[2]);
+}
+
+// 시계열 저장소 구간 조회 도구
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: %s <dir> <from_ms> <to_ms> [node_id]\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t from_ms = strtoull(argv[2], NULL, 10); // 조회 시작 시각
+    uint64_t to_ms = strtoull(argv[3], NULL, 10); // 조회 끝 시각
+    uint32_t node_id = argc > 4 ? strtoul(argv[4], NULL, 10) : 0; // 노드 필터 (0이면 전체)
+
+    printf("timestamp_ms,node_id,site_id,kind,v0,v1,v2\n");
+    size_t found = tsdb_query(argv[1], from_ms, to_ms, node_id, print_record, NULL);
+    fprintf(stderr, "%zu records\n", found);
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include <math.h>
+#include "wbgt.h"
+
+// 컴파일 대상에 맞는 벡터 명령 선택
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define WBGT_NEON
+#define VEC_WIDTH 4
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define WBGT_AVX
+#define VEC_WIDTH 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define WBGT_SSE
+#define VEC_WIDTH 4
+#endif
+
+// Stull 습구 온도 식 상수 (기존 계산과 같은 값)
+#define STULL_A 0.152f
+#define STULL_B 8.3136f
+#define STULL_C 1.67633f
+#define STULL_D 0.00391838f
+#define STULL_E 0.0231f
+#define STULL_F 4.686f
+
+// 흑구 온도, WBGT 가중치
+#define GLOBE_GAIN 0.0002f // 조도 1당 흑구 온도 증가분 (0.02 * light / 100)
+#define W_WET 0.7f // 습구 온도 가중치
+#define W_DRY 0.2f // 건구 온도 가중치
+#define W_GLOBE 0.1f // 흑구 온도 가중치
+
+// atan 다항식 계수 ([0, 1]에서 atan(x) ~= x * (A1 + A3 x^2 + A5 x^4 + A7 x^6 + A9 x^8))
+#define ATAN_A1 0.9998660f
+#define ATAN_A3 -0.3302995f
+#define ATAN_A5 0.1801410f
+#define ATAN_A7 -0.0851330f
+#define ATAN_A9 0.0208351f
+#define HALF_PI 1.57079632679f
+
+/* ---------- 스칼라 ---------- */
+
+// 다항식 atan 근사 함수
+static float atan_approx(float x)
+{
+    float ax = fabsf(x);
+    int big = ax > 1.0f;
+    float r = big ? 1.0f / ax : ax;
+    float r2 = r * r;
+    float p = r * (ATAN_A1 + r2 * (ATAN_A3 + r2 * (ATAN_A5 + r2 * (ATAN_A7 + r2 * ATAN_A9))));
+    if (big)
+    {
+        p = HALF_PI - p;
+    }
+    return copysignf(p, x);
+}
+
+// 습구 온도 계산 함수
+float wbgt_wet_bulb(float temperature, float humidity)
+{
+    return temperature * atan_approx(STULL_A * sqrtf(humidity + STULL_B)) + atan_approx(temperature + humidity) - atan_approx(humidity - STULL_C) + STULL_D * humidity * sqrtf(humidity) * atan_approx(STULL_E * humidity) - STULL_F;
+}
+
+// 흑구 온도 계산 함수
+float wbgt_globe(float temperature, float light)
+{
+    return temperature + GLOBE_GAIN * light;
+}
+
+// WBGT 계산 함수
+float wbgt_index(float wet_bulb, float temperature, float globe)
+{
+    return W_WET * wet_bulb + W_DRY * temperature + W_GLOBE * globe;
+}
+
+/* ---------- 벡터 연산 ---------- */
+
+#if defined(WBGT_NEON)
+typedef float32x4_t vf; // float 벡터
+typedef uint32x4_t vm; // 비교 결과 마스크
+static inline vf v_set(float x) { return vdupq_n_f32(x); }
+static inline vf v_load(const float* p) { return vld1q_f32(p); }
+static inline void v_store(float* p, vf x) { vst1q_f32(p, x); }
+static inline vf v_add(vf a, vf b) { return vaddq_f32(a, b); }
+static inline vf v_sub(vf a, vf b) { return vsubq_f32(a, b); }
+static inline vf v_mul(vf a, vf b) { return vmulq_f32(a, b); }
+static inline vf v_abs(vf x) { return vabsq_f32(x); }
+static inline vm v_gt(vf a, vf b) { return vcgtq_f32(a, b); }
+static inline vf v_select(vm m, vf a, vf b) { return vbslq_f32(m, a, b); }
+static inline vf v_copysign(vf mag, vf sign) { return vbslq_f32(vdupq_n_u32(0x80000000u), sign, mag); }
+#if defined(__aarch64__)
+static inline vf v_div(vf a, vf b) { return vdivq_f32(a, b); }
+static inline vf v_sqrt(vf x) { return vsqrtq_f32(x); }
+#else
+// ARMv7 NEON: 역수 추정 후 Newton 반복 2회 (상대 오차 약 1e-7)
+static inline vf v_div(vf a, vf b)
+{
+    vf r = vrecpeq_f32(b);
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    return vmulq_f32(a, r);
+}
+static inline vf v_sqrt(vf x)
+{
+    vf r = vrsqrteq_f32(x);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    return vbslq_f32(vceqq_f32(x, vdupq_n_f32(0.0f)), x, vmulq_f32(x, r)); // sqrt(0) = 0 * inf 방지
+}
+#endif
+#elif defined(WBGT_AVX)
+typedef __m256 vf;
+typedef __m256 vm;
+static inline vf v_set(float x) { return _mm256_set1_ps(x); }
+static inline vf v_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void v_store(float* p, vf x) { _mm256_storeu_ps(p, x); }
+static inline vf v_add(vf a, vf b) { return _mm256_add_ps(a, b); }
+static inline vf v_sub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+static inline vf v_mul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+static inline vf v_div(vf a, vf b) { return _mm256_div_ps(a, b); }
+static inline vf v_sqrt(vf x) { return _mm256_sqrt_ps(x); }
+static inline vf v_abs(vf x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+static inline vm v_gt(vf a, vf b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vf v_select(vm m, vf a, vf b) { return _mm256_blendv_ps(b, a, m); }
+static inline vf v_copysign(vf mag, vf sign)
+{
+    vf s = _mm256_set1_ps(-0.0f);
+    return _mm256_or_ps(_mm256_andnot_ps(s, mag), _mm256_and_ps(s, sign));
+}
+#elif defined(WBGT_SSE)
+typedef __m128 vf;
+typedef __m128 vm;
+static inline vf v_set(float x) { return _mm_set1_ps(x); }
+static inline vf v_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void v_store(float* p, vf x) { _mm_storeu_ps(p, x); }
+static inline vf v_add(vf a, vf b) { return _mm_add_ps(a, b); }
+static inline vf v_sub(vf a, vf b) { return _mm_sub_ps(a, b); }
+static inline vf v_mul(vf a, vf b) { return _mm_mul_ps(a, b); }
+static inline vf v_div(vf a, vf b) { return _mm_div_ps(a, b); }
+static inline vf v_sqrt(vf x) { return _mm_sqrt_ps(x); }
+static inline vf v_abs(vf x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+static inline vm v_gt(vf a, vf b) { return _mm_cmpgt_ps(a, b); }
+static inline vf v_select(vm m, vf a, vf b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); } // SSE2에는 blend가 없음
+static inline vf v_copysign(vf mag, vf sign)
+{
+    vf s = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_andnot_ps(s, mag), _mm_and_ps(s, sign));
+}
+#endif
+
+#ifdef VEC_WIDTH
+// 다항식 atan 근사 (벡터)
+static inline vf v_atan(vf x)
+{
+    vf one = v_set(1.0f);
+    vf ax = v_abs(x);
+    vm big = v_gt(ax, one);
+    vf r = v_select(big, v_div(one, ax), ax);
+    vf r2 = v_mul(r, r);
+    vf p = v_add(v_set(ATAN_A7), v_mul(r2, v_set(ATAN_A9)));
+    p = v_add(v_set(ATAN_A5), v_mul(r2, p));
+    p = v_add(v_set(ATAN_A3), v_mul(r2, p));
+    p = v_add(v_set(ATAN_A1), v_mul(r2, p));
+    p = v_mul(r, p);
+    p = v_select(big, v_sub(v_set(HALF_PI), p), p);
+    return v_copysign(p, x);
+}
+#endif
+
+// 배치 계산 함수
+void wbgt_batch(const float* temperature, const float* humidity, const float* light, float* wet_bulb, float* globe, float* wbgt, size_t count)
+{
+    size_t i = 0;
+
+#ifdef VEC_WIDTH
+    for (; i + VEC_WIDTH <= count; i += VEC_WIDTH)
+    {
+        vf t = v_load(temperature + i);
+        vf rh = v_load(humidity + i);
+        vf lx = v_load(light + i);
+
+        // 습구 온도
+        vf tw = v_mul(t, v_atan(v_mul(v_set(STULL_A), v_sqrt(v_add(rh, v_set(STULL_B))))));
+        tw = v_add(tw, v_atan(v_add(t, rh)));
+        tw = v_sub(tw, v_atan(v_sub(rh, v_set(STULL_C))));
+        vf rh15 = v_mul(rh, v_sqrt(rh)); // pow(RH, 1.5)
+        tw = v_add(tw, v_mul(v_mul(v_set(STULL_D), rh15), v_atan(v_mul(v_set(STULL_E), rh))));
+        tw = v_sub(tw, v_set(STULL_F));
+
+        // 흑구 온도와 WBGT
+        vf tg = v_add(t, v_mul(v_set(GLOBE_GAIN), lx));
+        vf w = v_add(v_add(v_mul(v_set(W_WET), tw), v_mul(v_set(W_DRY), t)), v_mul(v_set(W_GLOBE), tg));
+
+        v_store(wet_bulb + i, tw);
+        v_store(globe + i, tg);
+        v_store(wbgt + i, w);
+    }
+#endif
+
+    // 벡터 폭에 맞지 않는 나머지
+    for (; i < count; i++)
+    {
+        wet_bulb[i] = wbgt_wet_bulb(temperature[i], humidity[i]);
+        globe[i] = wbgt_globe(temperature[i], light[i]);
+        wbgt[i] = wbgt_index(wet_bulb[i], temperature[i], globe[i]);
+    }
+}
+
+// 사용 중인 커널 이름 반환 함수
+const char* wbgt_kernel_name(void)
+{
+#if defined(WBGT_NEON)
+    return "neon";
+#elif defined(WBGT_AVX)
+    return "avx";
+#elif defined(WBGT_SSE)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef WBGT_H
+#define WBGT_H
+
+#include <stddef.h>
+
+/*
+ * WBGT 계산 커널
+ * 습구 온도는 Stull(2011) 근사식, 흑구 온도는 조도 보정식, WBGT는 0.7 습구 + 0.2 건구 + 0.1 흑구
+ *
+ * 여러 현장을 한 번에 계산할 때는 배열 구조(SoA) 입력을 받는 wbgt_batch를 사용
+ * (컴파일 대상에 따라 NEON 4개, AVX 8개, SSE2 4개씩 계산하고 나머지는 스칼라로 계산)
+ *
+ * 근사 방법
+ *  - atan: |x| > 1이면 pi/2 - atan(1/x)로 [0, 1]에 가져온 뒤 9차 홀수 다항식 (최대 오차 1.0e-5 rad)
+ *  - pow(RH, 1.5): RH * sqrt(RH)로 바꿔 하드웨어 sqrt 사용 (근사 아님)
+ *  - ARMv7 NEON은 나눗셈/sqrt 명령이 없어 역수 추정 후 Newton 반복 2회 사용
+ *
+ * 기존 libm(double) 계산과의 차이 (-20~60 C, 0~100 %RH를 0.1 간격으로, 조도 0~4095에서 측정)
+ *  - 습구 온도: 최대 7.1e-4 C
+ *  - WBGT: 최대 5.0e-4 C
+ * DHT11의 분해능(1 C)과 표시 단위(0.1 C)보다 충분히 작음
+ */
+
+#define WBGT_LIMIT 15 // WBGT 임계치 (서버와 엣지 노드가 같은 값으로 판정)
+
+// 습구 온도, 흑구 온도, WBGT를 한 번에 계산 (light는 조도 ADC 값)
+void wbgt_batch(const float* temperature, const float* humidity, const float* light, float* wet_bulb, float* globe, float* wbgt, size_t count);
+
+// 한 건 계산 (배치 커널과 같은 근사식, 오차 범위도 같음)
+float wbgt_wet_bulb(float temperature, float humidity);
+float wbgt_globe(float temperature, float light);
+float wbgt_index(float wet_bulb, float temperature, float globe);
+
+// 사용 중인 커널 이름 ("neon", "avx", "sse2", "scalar")
+const char* wbgt_kernel_name(void);
+
+#endif
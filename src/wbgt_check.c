@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "wbgt.h"
+
+// 검사 범위 (wbgt.h에 적은 오차 측정 범위와 같음)
+#define T_MIN -20.0 // 건구 온도 최소 (C)
+#define T_MAX 60.0 // 건구 온도 최대 (C)
+#define RH_MAX 100.0 // 상대 습도 최대 (%)
+#define GRID_STEP 0.1 // 온도, 습도 간격
+#define LIGHT_MAX 4096 // 조도 ADC 값 범위 (0~4095)
+
+// wbgt.h에 적은 최대 오차 (이보다 크면 실패)
+#define WET_BULB_BOUND 7.1e-4 // 습구 온도 (C)
+#define WBGT_BOUND 5.0e-4 // WBGT (C)
+
+#define BENCH_ROUNDS 5 // 속도 측정 반복 횟수
+
+// 기존 서버의 libm(double) 계산 (근사 전 기준값)
+static void reference(double t, double rh, double light, double* wet_bulb, double* wbgt)
+{
+    *wet_bulb = t * atan(0.152 * sqrt(rh + 8.3136)) + atan(t + rh) - atan(rh - 1.67633) + 0.00391838 * pow(rh, 1.5) * atan(0.0231 * rh) - 4.686;
+    double tg = t + (0.02 * light) / 100.0;
+    *wbgt = 0.7 * *wet_bulb + 0.2 * t + 0.1 * tg;
+}
+
+// 경과 시간을 측정점 하나당 ns로 바꾸는 함수
+static double per_site_ns(const struct timespec* t0, const struct timespec* t1, size_t count)
+{
+    return ((t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec)) / ((double)BENCH_ROUNDS * count);
+}
+
+// WBGT 커널 검사 도구 (wbgt_batch와 한 건 계산을 libm 기준값과 비교하고 속도를 측정)
+int main(void)
+{
+    size_t temps = (size_t)((T_MAX - T_MIN) / GRID_STEP + 0.5) + 1;
+    size_t hums = (size_t)(RH_MAX / GRID_STEP + 0.5) + 1;
+    size_t count = temps * hums; // 측정점 하나를 현장 하나로 보고 한 번에 계산
+
+    float* in = malloc(sizeof(float) * count * 6);
+    if (in == NULL)
+    {
+        perror("malloc failed");
+        return 1;
+    }
+    float *temperature = in, *humidity = in + count, *light = in + 2 * count;
+    float *wet_bulb = in + 3 * count, *globe = in + 4 * count, *wbgt = in + 5 * count;
+    for (size_t i = 0; i < temps; i++)
+    {
+        for (size_t j = 0; j < hums; j++)
+        {
+            size_t k = i * hums + j;
+            temperature[k] = (float)(T_MIN + i * GRID_STEP);
+            humidity[k] = (float)(j * GRID_STEP);
+            light[k] = (float)(k % LIGHT_MAX); // 조도는 측정점마다 돌아가며 전체 범위를 씀
+        }
+    }
+
+    // 기준값과 비교 (배치 커널과 한 건 계산 모두)
+    wbgt_batch(temperature, humidity, light, wet_bulb, globe, wbgt, count);
+    double batch_wet = 0.0, batch_wbgt = 0.0, scalar_wet = 0.0, scalar_wbgt = 0.0;
+    for (size_t k = 0; k < count; k++)
+    {
+        double ref_wet, ref_wbgt;
+        reference(temperature[k], humidity[k], light[k], &ref_wet, &ref_wbgt);
+        batch_wet = fmax(batch_wet, fabs(wet_bulb[k] - ref_wet));
+        batch_wbgt = fmax(batch_wbgt, fabs(wbgt[k] - ref_wbgt));
+
+        float tw = wbgt_wet_bulb(temperature[k], humidity[k]);
+        float w = wbgt_index(tw, temperature[k], wbgt_globe(temperature[k], light[k]));
+        scalar_wet = fmax(scalar_wet, fabs(tw - ref_wet));
+        scalar_wbgt = fmax(scalar_wbgt, fabs(w - ref_wbgt));
+    }
+
+    // 속도 측정 (배치 커널, 한 건 계산, libm 기준)
+    struct timespec t0, t1;
+    volatile double sink = 0.0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        wbgt_batch(temperature, humidity, light, wet_bulb, globe, wbgt, count);
+        sink += wbgt[r];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double batch_ns = per_site_ns(&t0, &t1, count);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            float tw = wbgt_wet_bulb(temperature[k], humidity[k]);
+            wbgt[k] = wbgt_index(tw, temperature[k], wbgt_globe(temperature[k], light[k]));
+        }
+        sink += wbgt[r];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double scalar_ns = per_site_ns(&t0, &t1, count);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            double ref_wet, ref_wbgt;
+            reference(temperature[k], humidity[k], light[k], &ref_wet, &ref_wbgt);
+            sink += ref_wbgt;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double libm_ns = per_site_ns(&t0, &t1, count);
+    free(in);
+
+    int ok = batch_wet <= WET_BULB_BOUND && batch_wbgt <= WBGT_BOUND && scalar_wet <= WET_BULB_BOUND && scalar_wbgt <= WBGT_BOUND;
+    printf("%zu points (%.0f..%.0f C, 0..%.0f %%RH by %.1f, light 0..%d)\n", count, T_MIN, T_MAX, RH_MAX, GRID_STEP, LIGHT_MAX - 1);
+    printf("%s kernel: max error %.1e C wet-bulb, %.1e C WBGT\n", wbgt_kernel_name(), batch_wet, batch_wbgt);
+    printf("scalar: max error %.1e C wet-bulb, %.1e C WBGT\n", scalar_wet, scalar_wbgt);
+    printf("%.1f ns/site %s batch, %.1f ns/site scalar, %.1f ns/site libm\n", batch_ns, wbgt_kernel_name(), scalar_ns, libm_ns);
+    printf("%s (bounds %.1e C wet-bulb, %.1e C WBGT)\n", ok ? "Within bounds" : "Bounds exceeded", WET_BULB_BOUND, WBGT_BOUND);
+    return ok ? 0 : 2;
+}